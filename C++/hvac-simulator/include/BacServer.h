@@ -1,6 +1,9 @@
 #ifndef	BACSERVER_H
 #define	BACSERVER_H
 
+#include "RpmCache.h"
+
+#include <bacnet/bacdef.h>
 #include <bacnet/bacenum.h>
 
 #include <nlohmann/json.hpp>
@@ -8,14 +11,17 @@
 #include <memory>
 #include <thread>
 #include <variant>
+#include <vector>
 
 namespace hvac {
 	//! Helper data structure to deal with object with multiple priorities (AO, BO etc.).
 	struct ValueWithPriority {
-		typedef std::variant<BACNET_BINARY_PV> Types;
+		typedef std::variant<BACNET_BINARY_PV, float, uint32_t> Types;
 		
 		ValueWithPriority();
 		explicit ValueWithPriority(bool val);
+		explicit ValueWithPriority(float val);
+		explicit ValueWithPriority(uint32_t val);
 		
 		//! Object value associated with priority.
 		Types value;
@@ -24,9 +30,20 @@ namespace hvac {
 	};
 	
 	//! Possible value types for various BACnet object and connector types.
-	typedef std::variant<std::string, bool, ValueWithPriority> ValueTypes;
+	typedef std::variant<std::string, bool, ValueWithPriority, float, uint32_t> ValueTypes;
+	
+	//! BACnet object identification, for bulk provisioning.
+	struct ObjectSpec {
+		uint32_t devId;												//!< Own or virtual device instance ID.
+		BACNET_OBJECT_TYPE objType;
+		uint32_t objId;
+	};
 	
-	//! BACnet object population and server. Only supports single BACnet device (for now).
+	class CovManager;
+	class DevRouter;
+	
+	//! BACnet object population and server. Hosts own BACnet device, plus optional virtual devices routed
+	//! behind it (see \ref DevRouter).
 	class BacServer {
 	public:
 		~BacServer();
@@ -36,6 +53,7 @@ namespace hvac {
 		static bool Stop();
 		
 		static bool CreateObject(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId);
+		static size_t CreateObjects(const std::vector<ObjectSpec> &objects);
 		static bool DeleteObject(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId);
 		template<BACNET_OBJECT_TYPE objType, class T> static bool GetObjectValue(uint32_t devId,
 			uint32_t objId, T &val);
@@ -46,13 +64,30 @@ namespace hvac {
 			uint32_t objId, T &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &errCode);
 		template<BACNET_OBJECT_TYPE objType, class T> static bool SetObjectValueBS(uint32_t devId,
 			uint32_t objId, const T &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &errCode);
+		
+		static int SubscribeCov(uint32_t devId, const BACNET_ADDRESS &src, uint8_t invokeId, uint8_t service,
+			uint8_t *req, uint16_t reqLen, uint8_t *resp);
+		static int ReadPropertyMultiple(uint32_t devId, uint8_t invokeId, uint8_t *req, uint16_t reqLen,
+			uint8_t *resp, unsigned respSz, const RpmCache::ReadFunc &readProp);
+		static void PropertiesWritten(uint32_t devId);
+		static bool SendApdu(uint32_t devId, const BACNET_ADDRESS &dest, uint8_t *apdu, unsigned apduLen,
+			bool confirmed);
 	private:
 		BacServer(const nlohmann::json &config);
 		
 		void Process();
+		bool RecvDatagrams();
+		void ServiceTimers();
+		
+		static void ValueChanged(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId, bool isCov);
+		static DevRouter* VirtualRouter(uint32_t devId);
 		
+		std::unique_ptr<CovManager> cov;
+		std::unique_ptr<DevRouter> router;
+		RpmCache rpmCache;
 		std::thread thd;
-		bool stop;
+		uint64_t addrElapsedMs, timerTs, timerDueTs;
+		int epollFd, stopFd, timerFd;
 		
 		static std::unique_ptr<BacServer> server;
 	};
@@ -0,0 +1,88 @@
+#ifndef	COVMANAGER_H
+#define	COVMANAGER_H
+
+#include <bacnet/bacdef.h>
+#include <bacnet/cov.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace hvac {
+	//! COV subscriptions of own and virtual devices. Object changes can be marked from any thread, while
+	//! subscriptions and notifications are handled in BACnet server thread only. Changes are coalesced per
+	//! tick, so each subscriber gets latest value once per tick at most.
+	class CovManager {
+	public:
+		explicit CovManager(size_t maxSubs);
+		~CovManager();
+		
+		int HandleSubscribe(uint32_t devId, const BACNET_ADDRESS &src, uint8_t invokeId, uint8_t service,
+			uint8_t *req, uint16_t reqLen, uint8_t *resp);
+		void MarkChanged(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId);
+		uint64_t Service(uint64_t nowMs);
+		
+		int GetWakeFd() const;
+	private:
+		//! Monitored object.
+		struct ObjectRef {
+			uint32_t devId;
+			BACNET_OBJECT_TYPE objType;
+			uint32_t objId;
+			
+			bool operator==(const ObjectRef &other) const;
+		};
+		
+		//! Hash function for \ref ObjectRef.
+		struct ObjectRefHash {
+			size_t operator()(const ObjectRef &ref) const;
+		};
+		
+		//! Present value reader of single object type, see \ref ReadPresentValue().
+		typedef bool (*ReadFunc)(const ObjectRef &obj, BACNET_APPLICATION_DATA_VALUE &value);
+		
+		//! Single subscription.
+		struct Subscription {
+			BACNET_ADDRESS subscriber;
+			ObjectRef obj;
+			ReadFunc read;											//!< Picked at subscribe time.
+			uint64_t expirySec;										//!< Zero if subscription never expires.
+			uint32_t processId;
+			BACNET_PROPERTY_ID property;							//!< PROP_ALL for SubscribeCOV.
+			bool confirmed;
+		};
+		
+		//! Timer wheel slot count, one slot per second.
+		constexpr static size_t WHEEL_SLOTS = 256u;
+		
+		static bool IsSameAddress(const BACNET_ADDRESS &addr1, const BACNET_ADDRESS &addr2);
+		template<BACNET_OBJECT_TYPE objType> static bool ReadPresentValue(const ObjectRef &obj,
+			BACNET_APPLICATION_DATA_VALUE &value);
+		static ReadFunc PresentValueReader(BACNET_OBJECT_TYPE objType);
+		static bool ReadValues(const ObjectRef &obj, ReadFunc read, BACNET_PROPERTY_VALUE (&values)[2]);
+		
+		void ExpireSubscriptions(uint64_t nowSec);
+		uint64_t NextExpiryDelay(uint64_t nowMs) const;
+		void Notify(const Subscription &sub, BACNET_PROPERTY_VALUE *values, uint64_t nowSec);
+		void RemoveSubscription(uint32_t subId);
+		
+		std::unordered_map<uint32_t, Subscription> subs;			//!< Key is subscription ID.
+		std::unordered_map<ObjectRef, std::vector<uint32_t>, ObjectRefHash> objSubs;	//!< Subscription IDs.
+		//! Expiry timer wheel, with subscription ID and expiry per entry.
+		std::array<std::vector<std::pair<uint32_t, uint64_t>>, WHEEL_SLOTS> wheel;
+		std::vector<uint32_t> initial;								//!< Subscriptions due initial notification.
+		std::unordered_set<ObjectRef, ObjectRefHash> changed;		//!< Objects changed since last tick.
+		std::mutex changedGuard;
+		std::atomic<size_t> subQt;									//!< For \ref MarkChanged() outside thread.
+		size_t maxSubs;
+		uint64_t pendingMs, wheelSec;
+		uint32_t nextSubId;
+		int wakeFd;
+		uint8_t invokeId;
+	};
+}
+
+#endif
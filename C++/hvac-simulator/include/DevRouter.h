@@ -0,0 +1,65 @@
+#ifndef	DEVROUTER_H
+#define	DEVROUTER_H
+
+#include "BacServer.h"
+
+#include <bacnet/bacdef.h>
+#include <bacnet/npdu.h>
+#include <bacnet/rp.h>
+#include <bacnet/wp.h>
+
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace hvac {
+	//! Virtual BACnet devices hosted behind BACnet server port, on virtual network that BACnet server routes
+	//! to. Each device has its own object table, and is addressed by its index on virtual network (3 byte MAC).
+	class DevRouter {
+	public:
+		explicit DevRouter(uint16_t network);
+		
+		bool AddDevice(uint32_t devId, const std::string &devName);
+		bool HasDevice(uint32_t devId) const;
+		
+		bool CreateObject(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId);
+		size_t CreateObjects(const std::vector<ObjectSpec> &objects);
+		bool DeleteObject(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId);
+		bool GetObjectValue(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId, ValueTypes &val) const;
+		bool SetObjectValue(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId, const ValueTypes &val);
+		
+		void AnnounceRouter() const;
+		bool HandleNpdu(const BACNET_ADDRESS &src, uint8_t *pdu, uint16_t pduLen);
+		bool SendFrom(uint32_t devId, const BACNET_ADDRESS &dest, const uint8_t *apdu, unsigned apduLen,
+			bool expectReply) const;
+	private:
+		//! Single virtual device.
+		struct Device {
+			uint32_t id;
+			std::string name;
+			std::unordered_map<uint64_t, ValueTypes> objects;		//!< Key from \ref ObjectKey().
+			std::vector<uint64_t> objectList;						//!< Sorted object keys, for Object_List.
+		};
+		
+		static uint64_t ObjectKey(BACNET_OBJECT_TYPE objType, uint32_t objId);
+		static int EncodeObjectList(const Device &dev, BACNET_READ_PROPERTY_DATA &rpData, uint8_t *apdu);
+		template<class T> static int EncodeValue(uint8_t *apdu, const T &val);
+		
+		const Device* FindDevice(uint32_t devId) const;
+		Device* FindDevice(uint32_t devId);
+		int EncodeProperty(const Device &dev, BACNET_READ_PROPERTY_DATA &rpData, uint8_t *apdu) const;
+		void HandleConfirmed(const BACNET_ADDRESS &src, uint32_t devIdx, uint8_t *apdu, uint16_t apduLen);
+		void HandleWhoIs(uint8_t *apdu, uint16_t apduLen) const;
+		bool HandleWriteProperty(uint32_t devId, BACNET_WRITE_PROPERTY_DATA &wpData);
+		bool Send(const BACNET_ADDRESS &dest, uint32_t devIdx, const uint8_t *apdu, unsigned apduLen,
+			bool expectReply) const;
+		
+		std::vector<Device> devices;								//!< Index is MAC on virtual network.
+		std::vector<std::pair<uint32_t, uint32_t>> devIndex;		//!< Sorted device ID to device index.
+		mutable std::shared_mutex guard;
+		uint16_t network;
+	};
+}
+
+#endif
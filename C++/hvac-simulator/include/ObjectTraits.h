@@ -0,0 +1,212 @@
+#ifndef	OBJECTTRAITS_H
+#define	OBJECTTRAITS_H
+
+#include "BacServer.h"
+
+#include <bacnet/basic/object/ai.h>
+#include <bacnet/basic/object/ao.h>
+#include <bacnet/basic/object/av.h>
+#include <bacnet/basic/object/bi.h>
+#include <bacnet/basic/object/bo.h>
+#include <bacnet/basic/object/ms-input.h>
+#include <bacnet/basic/object/mso.h>
+#include <bacnet/basic/object/msv.h>
+
+#include <type_traits>
+#include <utility>
+
+namespace hvac {
+	//! Traits of BACnet object type supported by BACnet server. Left undefined for unsupported types, so using
+	//! them fails at compile time. Each specialization provides:
+	//! - ValueType: user value type of present value getter.
+	//! - SetType: user value type of present value setter, \ref ValueWithPriority if object is commandable.
+	//! - PvType: BACnet stack present value type, as held by \ref ValueWithPriority.
+	//! - PV_TAG: BACnet application tag of present value.
+	//! - IS_WRITABLE: whether present value is writable by BACnet clients.
+	//! - Create(), Delete(), Get() and Set(): BACnet stack object table access.
+	//! - ToValue(): conversion from BACnet stack present value to user value.
+	//! - InitValue(): present value of newly created object.
+	//! @tparam objType BACnet object type.
+	template<BACNET_OBJECT_TYPE objType> struct ObjectTraits;
+	
+	template<> struct ObjectTraits<OBJECT_ANALOG_INPUT> {
+		typedef float ValueType;
+		typedef float SetType;
+		typedef float PvType;
+		constexpr static BACNET_APPLICATION_TAG PV_TAG = BACNET_APPLICATION_TAG_REAL;
+		constexpr static bool IS_WRITABLE = false;
+		
+		static bool Create(uint32_t objId) { return Analog_Input_Create(objId); }
+		static bool Delete(uint32_t objId) { return Analog_Input_Delete(objId); }
+		static ValueType Get(uint32_t objId) { return Analog_Input_Present_Value(objId); }
+		static bool Set(uint32_t objId, const SetType &val) {
+			if (!Analog_Input_Valid_Instance(objId)) {					//setter itself returns nothing
+				return false;
+			}
+			
+			Analog_Input_Present_Value_Set(objId, val);
+			return true;
+		}
+		static ValueType ToValue(PvType pv) { return pv; }
+		static SetType InitValue() { return 0.0f; }
+	};
+	
+	template<> struct ObjectTraits<OBJECT_ANALOG_OUTPUT> {
+		typedef float ValueType;
+		typedef ValueWithPriority SetType;
+		typedef float PvType;
+		constexpr static BACNET_APPLICATION_TAG PV_TAG = BACNET_APPLICATION_TAG_REAL;
+		constexpr static bool IS_WRITABLE = true;
+		
+		static bool Create(uint32_t objId) { return Analog_Output_Create(objId); }
+		static bool Delete(uint32_t objId) { return Analog_Output_Delete(objId); }
+		static ValueType Get(uint32_t objId) { return Analog_Output_Present_Value(objId); }
+		static bool Set(uint32_t objId, const SetType &val) {
+			return std::holds_alternative<PvType>(val.value) &&
+				Analog_Output_Present_Value_Set(objId, std::get<PvType>(val.value), val.priority);
+		}
+		static ValueType ToValue(PvType pv) { return pv; }
+		static SetType InitValue() { return ValueWithPriority(0.0f); }
+	};
+	
+	template<> struct ObjectTraits<OBJECT_ANALOG_VALUE> {
+		typedef float ValueType;
+		typedef ValueWithPriority SetType;
+		typedef float PvType;
+		constexpr static BACNET_APPLICATION_TAG PV_TAG = BACNET_APPLICATION_TAG_REAL;
+		constexpr static bool IS_WRITABLE = true;
+		
+		static bool Create(uint32_t objId) { return Analog_Value_Create(objId); }
+		static bool Delete(uint32_t objId) { return Analog_Value_Delete(objId); }
+		static ValueType Get(uint32_t objId) { return Analog_Value_Present_Value(objId); }
+		static bool Set(uint32_t objId, const SetType &val) {
+			return std::holds_alternative<PvType>(val.value) &&
+				Analog_Value_Present_Value_Set(objId, std::get<PvType>(val.value), val.priority);
+		}
+		static ValueType ToValue(PvType pv) { return pv; }
+		static SetType InitValue() { return ValueWithPriority(0.0f); }
+	};
+	
+	template<> struct ObjectTraits<OBJECT_BINARY_INPUT> {
+		typedef bool ValueType;
+		typedef bool SetType;
+		typedef BACNET_BINARY_PV PvType;
+		constexpr static BACNET_APPLICATION_TAG PV_TAG = BACNET_APPLICATION_TAG_ENUMERATED;
+		constexpr static bool IS_WRITABLE = false;
+		
+		static bool Create(uint32_t objId) { return Binary_Input_Create(objId); }
+		static bool Delete(uint32_t objId) { return Binary_Input_Delete(objId); }
+		static ValueType Get(uint32_t objId) { return ToValue(Binary_Input_Present_Value(objId)); }
+		static bool Set(uint32_t objId, const SetType &val) {
+			return Binary_Input_Present_Value_Set(objId, val ? BINARY_ACTIVE : BINARY_INACTIVE);
+		}
+		static ValueType ToValue(PvType pv) { return pv == BINARY_ACTIVE; }
+		static SetType InitValue() { return false; }
+	};
+	
+	template<> struct ObjectTraits<OBJECT_BINARY_OUTPUT> {
+		typedef bool ValueType;
+		typedef ValueWithPriority SetType;
+		typedef BACNET_BINARY_PV PvType;
+		constexpr static BACNET_APPLICATION_TAG PV_TAG = BACNET_APPLICATION_TAG_ENUMERATED;
+		constexpr static bool IS_WRITABLE = true;
+		
+		static bool Create(uint32_t objId) { return Binary_Output_Create(objId); }
+		static bool Delete(uint32_t objId) { return Binary_Output_Delete(objId); }
+		static ValueType Get(uint32_t objId) { return ToValue(Binary_Output_Present_Value(objId)); }
+		static bool Set(uint32_t objId, const SetType &val) {
+			return std::holds_alternative<PvType>(val.value) &&
+				Binary_Output_Present_Value_Set(objId, std::get<PvType>(val.value), val.priority);
+		}
+		static ValueType ToValue(PvType pv) { return pv == BINARY_ACTIVE; }
+		static SetType InitValue() { return ValueWithPriority(false); }
+	};
+	
+	template<> struct ObjectTraits<OBJECT_MULTI_STATE_INPUT> {
+		typedef uint32_t ValueType;
+		typedef uint32_t SetType;
+		typedef uint32_t PvType;
+		constexpr static BACNET_APPLICATION_TAG PV_TAG = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+		constexpr static bool IS_WRITABLE = false;
+		
+		static bool Create(uint32_t objId) { return Multistate_Input_Create(objId); }
+		static bool Delete(uint32_t objId) { return Multistate_Input_Delete(objId); }
+		static ValueType Get(uint32_t objId) { return Multistate_Input_Present_Value(objId); }
+		static bool Set(uint32_t objId, const SetType &val) {
+			return Multistate_Input_Present_Value_Set(objId, val);
+		}
+		static ValueType ToValue(PvType pv) { return pv; }
+		static SetType InitValue() { return 1u; }						//states are numbered from 1
+	};
+	
+	template<> struct ObjectTraits<OBJECT_MULTI_STATE_OUTPUT> {
+		typedef uint32_t ValueType;
+		typedef ValueWithPriority SetType;
+		typedef uint32_t PvType;
+		constexpr static BACNET_APPLICATION_TAG PV_TAG = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+		constexpr static bool IS_WRITABLE = true;
+		
+		static bool Create(uint32_t objId) { return Multistate_Output_Create(objId); }
+		static bool Delete(uint32_t objId) { return Multistate_Output_Delete(objId); }
+		static ValueType Get(uint32_t objId) { return Multistate_Output_Present_Value(objId); }
+		static bool Set(uint32_t objId, const SetType &val) {
+			return std::holds_alternative<PvType>(val.value) &&
+				Multistate_Output_Present_Value_Set(objId, std::get<PvType>(val.value), val.priority);
+		}
+		static ValueType ToValue(PvType pv) { return pv; }
+		static SetType InitValue() { return ValueWithPriority(1u); }
+	};
+	
+	template<> struct ObjectTraits<OBJECT_MULTI_STATE_VALUE> {
+		typedef uint32_t ValueType;
+		typedef uint32_t SetType;
+		typedef uint32_t PvType;
+		constexpr static BACNET_APPLICATION_TAG PV_TAG = BACNET_APPLICATION_TAG_UNSIGNED_INT;
+		constexpr static bool IS_WRITABLE = true;
+		
+		static bool Create(uint32_t objId) { return Multistate_Value_Create(objId); }
+		static bool Delete(uint32_t objId) { return Multistate_Value_Delete(objId); }
+		static ValueType Get(uint32_t objId) { return Multistate_Value_Present_Value(objId); }
+		static bool Set(uint32_t objId, const SetType &val) {
+			return Multistate_Value_Present_Value_Set(objId, val);
+		}
+		static ValueType ToValue(PvType pv) { return pv; }
+		static SetType InitValue() { return 1u; }
+	};
+	
+	//! Compile-time list of BACnet object types.
+	template<BACNET_OBJECT_TYPE... objTypes> struct ObjectTypeList {};
+	
+	//! All object types with \ref ObjectTraits specialization.
+	typedef ObjectTypeList<OBJECT_ANALOG_INPUT, OBJECT_ANALOG_OUTPUT, OBJECT_ANALOG_VALUE, OBJECT_BINARY_INPUT,
+		OBJECT_BINARY_OUTPUT, OBJECT_MULTI_STATE_INPUT, OBJECT_MULTI_STATE_OUTPUT, OBJECT_MULTI_STATE_VALUE>
+		SupportedObjectTypes;
+	
+	//! Calls generic function with object type known at run time only, as compile-time constant. Meant for
+	//! code paths where object type comes from config or BACnet request, not for present value access.
+	//! @tparam F Function type, taking std::integral_constant<BACNET_OBJECT_TYPE, objType> and returning bool.
+	//! @tparam objTypes Candidate object types.
+	//! @param[in] objType BACnet object type.
+	//! @param[in] fn Function to be called.
+	//! @return Function result, false if object type is not among candidates.
+	template<class F, BACNET_OBJECT_TYPE... objTypes> bool VisitObjectType(BACNET_OBJECT_TYPE objType, F &&fn,
+	ObjectTypeList<objTypes...>) {
+		bool result = false;
+		
+		((objType == objTypes ? (result = fn(std::integral_constant<BACNET_OBJECT_TYPE, objTypes>()), true) :
+			false) || ...);
+		
+		return result;
+	}
+	
+	//! Calls generic function with supported object type, see \ref VisitObjectType() above.
+	//! @tparam F Function type, taking std::integral_constant<BACNET_OBJECT_TYPE, objType> and returning bool.
+	//! @param[in] objType BACnet object type.
+	//! @param[in] fn Function to be called.
+	//! @return Function result, false if object type is not supported.
+	template<class F> bool VisitObjectType(BACNET_OBJECT_TYPE objType, F &&fn) {
+		return VisitObjectType(objType, std::forward<F>(fn), SupportedObjectTypes());
+	}
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef	RPMCACHE_H
+#define	RPMCACHE_H
+
+#include <bacnet/bacdef.h>
+#include <bacnet/rp.h>
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace hvac {
+	//! ReadPropertyMultiple responder with encoded response cache. Each object result is cached per requested
+	//! property list, and is dropped once object value changes, so polling unchanged objects is served by copy.
+	//! Only present value and status flags of non-device objects are cached, as other properties (e.g. object
+	//! list) may change without value change notification.
+	class RpmCache {
+	public:
+		//! Property encoder, as BACnet stack's Device_Read_Property(). Returns encoded length, or negative
+		//! value with error class/code set.
+		typedef std::function<int(BACNET_READ_PROPERTY_DATA &rpData, uint8_t *apdu)> ReadFunc;
+		
+		RpmCache();
+		
+		int Encode(uint32_t devId, uint8_t invokeId, uint8_t *req, uint16_t reqLen, uint8_t *resp,
+			unsigned respSz, const ReadFunc &readProp);
+		void Invalidate(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId);
+		void InvalidateAll();
+		void InvalidateDevice(uint32_t devId);
+	private:
+		//! Encoded object result for single property list.
+		struct Fragment {
+			std::vector<uint8_t> spec;								//!< Property list, as encoded in request.
+			std::vector<uint8_t> data;								//!< Encoded object result.
+		};
+		
+		//! Cached results of single object.
+		struct Entry {
+			std::vector<Fragment> fragments;
+			uint8_t nextSlot;										//!< Fragment to be replaced when full.
+		};
+		
+		static bool IsCacheable(BACNET_OBJECT_TYPE objType,
+			const std::vector<std::pair<BACNET_PROPERTY_ID, uint32_t>> &props);
+		static uint64_t ObjectKey(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId);
+		
+		int EncodeObject(BACNET_OBJECT_TYPE objType, uint32_t objId,
+			const std::vector<std::pair<BACNET_PROPERTY_ID, uint32_t>> &props, uint8_t *frag, unsigned fragSz,
+			const ReadFunc &readProp, bool &hasError) const;
+		
+		std::unordered_map<uint64_t, Entry> entries;				//!< Key from \ref ObjectKey().
+		uint64_t generation;										//!< Bumped on every invalidation.
+		std::mutex guard;
+	};
+}
+
+#endif
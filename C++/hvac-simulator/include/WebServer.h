@@ -1,14 +1,18 @@
 #ifndef	WEBSERVER_H
 #define	WEBSERVER_H
 
+#include "WwwCache.h"
+
 #include <nlohmann/json.hpp>
 #include <uWebSockets/App.h>
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <unordered_map>
-#include <vector>
+#include <unordered_set>
 
 namespace hvac {
 	//! REST/WebSocket web server.
@@ -19,21 +23,34 @@ namespace hvac {
 		static bool Stop();
 		
 		static bool SendMessage(std::string_view msg, uWS::OpCode opcode = uWS::OpCode::TEXT);
+		static bool UpdateValue(std::string_view connector, const nlohmann::json &value);
 	private:
 		WebServer(const nlohmann::json &config);
 		
-		bool GetWwwFile(std::string_view filePath,
-			std::unordered_map<std::string, std::string> &headers, std::string &resp) const;
+		bool Defer(std::function<void()> &&fn);
+		bool Publish(std::string_view topic, std::string_view msg, uWS::OpCode opcode);
 		void PingClients();
 		void Process();
 		
 		us_listen_socket_t *token = nullptr;
-		std::vector<void*> wsSocks;
-		std::recursive_mutex wsSocksGuard;
+		uWS::Loop *loop = nullptr;									//!< Server loop, while running.
+		std::mutex loopGuard;
+		//! Connector values changed since last delta tick, latest value only.
+		std::unordered_map<std::string, nlohmann::json> pendingValues;
+		std::mutex pendingGuard;
+		std::atomic<unsigned> deltaClients = 0;						//!< Clients with connector subscription.
+		//! Members below are accessed on server loop thread only.
+		std::function<void(std::string_view topic, std::string_view msg, uWS::OpCode opcode)> publish;
+		std::function<void()> sendDeltas;
+		std::unordered_set<void*> wsSocks;
+		nlohmann::json polledValues;								//!< Connector values as of last delta tick.
+		us_timer_t *deltaTimer = nullptr;
+		
+		std::unique_ptr<WwwCache> wwwCache;
 		std::thread thdMain, thdPing;
 		std::string certKeyPath, certPass, certPath, wwwPath;
 		int port;
-		bool stop, useSsl;
+		bool fullSnapshot, stop, useSsl;
 		
 		static std::unique_ptr<WebServer> server;
 	};
@@ -0,0 +1,57 @@
+#ifndef	WWWCACHE_H
+#define	WWWCACHE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace hvac {
+	//! In-memory copy of website tree, so serving file takes no disk access, except for files too big to cache.
+	//! Built at construction, and rebuilt in background whenever tree changes (as reported by inotify).
+	class WwwCache {
+	public:
+		//! File content with single content coding.
+		struct Variant {
+			std::string data;
+			std::string etag;										//!< Strong ETag, quoted.
+		};
+		
+		//! Single cached file.
+		struct File {
+			Variant raw;											//!< Only ETag if file is too big to cache.
+			Variant gzip;											//!< Empty if not smaller than raw.
+			Variant br;												//!< From precompressed '.br' file, if any.
+			std::string_view mime;
+			std::string diskPath;									//!< Set if file is too big to cache.
+		};
+		
+		explicit WwwCache(const std::string &rootPath);
+		~WwwCache();
+		
+		std::shared_ptr<const File> Find(std::string_view urlPath) const;
+		
+		static bool ReadFromDisk(const File &file, std::string &data);
+		static const Variant& SelectVariant(const File &file, std::string_view acceptEncoding,
+			std::string_view &encoding);
+		static bool MatchesETag(std::string_view ifNoneMatch, std::string_view etag);
+	private:
+		typedef std::unordered_map<std::string, std::shared_ptr<const File>> Files;
+		
+		static bool AcceptsEncoding(std::string_view acceptEncoding, std::string_view encoding);
+		static std::string MakeETag(std::string_view data, std::string_view suffix);
+		
+		std::shared_ptr<const Files> Build() const;
+		void Watch();
+		
+		std::shared_ptr<const Files> files;							//!< Key is URL path, e.g. '/index.html'.
+		mutable std::mutex guard;
+		std::string rootPath;
+		std::thread thd;
+		int inotifyFd, stopFd;
+	};
+}
+
+#endif
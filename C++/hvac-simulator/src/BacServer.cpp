@@ -1,26 +1,144 @@
 #include "main.h"
 #include "BacServer.h"
+#include "CovManager.h"
 #include "DevManager.h"
+#include "DevRouter.h"
+#include "ObjectTraits.h"
 
 #include <Commons.h>
 
+#include <bacnet/abort.h>
 #include <bacnet/bacdef.h>
-#include <bacnet/basic/object/bi.h>
-#include <bacnet/basic/object/bo.h>
 #include <bacnet/basic/object/device.h>
+#include <bacnet/basic/bbmd/h_bbmd.h>
 #include <bacnet/basic/services.h>
 #include <bacnet/basic/tsm/tsm.h>
+#include <bacnet/datalink/bvlc.h>
 #include <bacnet/datalink/datalink.h>
 
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <string_view>
 
+//! Datagrams received per recvmmsg() call.
+constexpr static unsigned RECV_BATCH_SZ = 32u;
+//! TSM timer period while there's active transaction, in ms.
+constexpr static unsigned TSM_TIMER_MS = 50u;
+//! Address cache aging period, in ms.
+constexpr static uint64_t ADDR_CACHE_TIMER_MS = 60000u;
+//! Default COV subscription count limit, over own and virtual devices.
+constexpr static size_t COV_MAX_SUBSCRIPTIONS = 1024u;
+
+//! Helper function to get current CLOCK_MONOTONIC time.
+//! @return Current time, in ms.
+static uint64_t MonotonicMs() {
+	timespec now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return (uint64_t) now.tv_sec * 1000u + now.tv_nsec / 1000000u;
+}
+
+//! BACnet stack handler for SubscribeCOV and SubscribeCOVProperty to own device.
+//! @tparam service Service choice.
+//! @param[in] req Service request.
+//! @param[in] reqLen Service request length, in bytes.
+//! @param[in] src Subscriber address.
+//! @param[in] svcData Confirmed service header.
+template<BACNET_CONFIRMED_SERVICE service> static void HandleSubscribeCov(uint8_t *req, uint16_t reqLen,
+BACNET_ADDRESS *src, BACNET_CONFIRMED_SERVICE_DATA *svcData) {
+	uint8_t resp[MAX_APDU];
+	int respLen;
+	
+	if (svcData->segmented_message) {
+		respLen = abort_encode_apdu(resp, svcData->invoke_id, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
+	}
+	else {
+		respLen = hvac::BacServer::SubscribeCov(Device_Object_Instance_Number(), *src, svcData->invoke_id,
+			service, req, reqLen, resp);
+	}
+	
+	if (respLen > 0) {
+		hvac::BacServer::SendApdu(Device_Object_Instance_Number(), *src, resp, respLen, false);
+	}
+	
+	return;
+}
+
+//! BACnet stack handler for ReadPropertyMultiple to own device, served from \ref hvac::RpmCache. Requests it
+//! doesn't handle are passed on to BACnet stack's own handler.
+//! @param[in] req Service request.
+//! @param[in] reqLen Service request length, in bytes.
+//! @param[in] src Requester address.
+//! @param[in] svcData Confirmed service header.
+static void HandleReadPropertyMultiple(uint8_t *req, uint16_t reqLen, BACNET_ADDRESS *src,
+BACNET_CONFIRMED_SERVICE_DATA *svcData) {
+	uint8_t resp[MAX_APDU];
+	int respLen = -1;
+	
+	if (!svcData->segmented_message) {
+		respLen = hvac::BacServer::ReadPropertyMultiple(Device_Object_Instance_Number(), svcData->invoke_id,
+			req, reqLen, resp, std::min<unsigned>(svcData->max_resp, sizeof(resp)),
+			[](BACNET_READ_PROPERTY_DATA &rpData, uint8_t*) { return Device_Read_Property(&rpData); });
+	}
+	
+	if (respLen > 0) {
+		hvac::BacServer::SendApdu(Device_Object_Instance_Number(), *src, resp, respLen, false);
+	}
+	else {															//segmented, property group or too big
+		handler_read_property_multiple(req, reqLen, src, svcData);
+	}
+	
+	return;
+}
+
+//! BACnet stack handler for WriteProperty and WritePropertyMultiple to own device. Passed on to BACnet stack's
+//! own handler, then cached ReadPropertyMultiple results are dropped as property other than present value
+//! (e.g. Out_Of_Service) may have changed.
+//! @tparam handler BACnet stack's own handler.
+//! @param[in] req Service request.
+//! @param[in] reqLen Service request length, in bytes.
+//! @param[in] src Requester address.
+//! @param[in] svcData Confirmed service header.
+template<void (*handler)(uint8_t*, uint16_t, BACNET_ADDRESS*, BACNET_CONFIRMED_SERVICE_DATA*)>
+static void HandleWriteProperty(uint8_t *req, uint16_t reqLen, BACNET_ADDRESS *src,
+BACNET_CONFIRMED_SERVICE_DATA *svcData) {
+	handler(req, reqLen, src, svcData);
+	hvac::BacServer::PropertiesWritten(Device_Object_Instance_Number());
+	
+	return;
+}
+
+//! BACnet stack handler for confirmed request from own device that has run out of retries, i.e. COV
+//! notification. Nothing waits for its result, so TSM slot is freed here, or it would be held for good.
+//! @param[in] invokeId Request invoke ID.
+static void HandleTsmTimeout(uint8_t invokeId) {
+	SPDLOG_DEBUG("BACnet confirmed request with invoke ID '{}' timed out.", invokeId);
+	tsm_free_invoke_id(invokeId);
+	
+	return;
+}
+
 //! Enforce \ref hvac::ValueWithPriority::Types variant type ordering via static_assert.
 static_assert(std::is_same<BACNET_BINARY_PV,
 	std::variant_alternative_t<0, hvac::ValueWithPriority::Types>>::value,
 	"Expecting index 0 for 'BACNET_BINARY_PV' type.");
+static_assert(std::is_same<float, std::variant_alternative_t<1, hvac::ValueWithPriority::Types>>::value,
+	"Expecting index 1 for 'float' type.");
+static_assert(std::is_same<uint32_t, std::variant_alternative_t<2, hvac::ValueWithPriority::Types>>::value,
+	"Expecting index 2 for 'uint32_t' type.");
 
 //! Enforce \ref hvac::ValueTypes variant type ordering via static_assert.
 static_assert(std::is_same<std::string, std::variant_alternative_t<0, hvac::ValueTypes>>::value,
@@ -33,22 +151,50 @@ static_assert(std::is_same<hvac::ValueWithPriority,
 	std::variant_alternative_t<2, hvac::ValueTypes>>::value,
 	"Expecting index 2 for 'ValueWithPriority' type."
 );
+static_assert(std::is_same<float, std::variant_alternative_t<3, hvac::ValueTypes>>::value,
+	"Expecting index 3 for 'float' type."
+);
+static_assert(std::is_same<uint32_t, std::variant_alternative_t<4, hvac::ValueTypes>>::value,
+	"Expecting index 4 for 'uint32_t' type."
+);
+
+//! Checks whether type is one of variant alternatives.
+//! @tparam T Type to be checked.
+//! @tparam V Variant type.
+template<class T, class V> struct IsAlternative;
+template<class T, class... Types> struct IsAlternative<T, std::variant<Types...>> :
+	std::disjunction<std::is_same<T, Types>...> {};
+
+//! Checks (with static_assert) whether value types of every \ref hvac::ObjectTraits specialization can be held
+//! by value variants.
+//! @tparam objTypes Supported object types.
+template<BACNET_OBJECT_TYPE... objTypes> constexpr static bool CheckObjectTraits(
+hvac::ObjectTypeList<objTypes...>) {
+	static_assert((IsAlternative<typename hvac::ObjectTraits<objTypes>::ValueType, hvac::ValueTypes>::value &&
+		...), "Object getter value type must be one of 'ValueTypes'.");
+	static_assert((IsAlternative<typename hvac::ObjectTraits<objTypes>::SetType, hvac::ValueTypes>::value &&
+		...), "Object setter value type must be one of 'ValueTypes'.");
+	static_assert((IsAlternative<typename hvac::ObjectTraits<objTypes>::PvType,
+		hvac::ValueWithPriority::Types>::value && ...), "Object present value type must be one of 'Types'.");
+	
+	return true;
+}
+static_assert(CheckObjectTraits(hvac::SupportedObjectTypes()));
 
 //! Checks (with static_assert) whether BACnet object present value type matches user variable type.
 //! @tparam objType BACnet object type.
 //! @tparam T User variable type.
 //! @tparam doGet Whether it's called from getter function.
 template<BACNET_OBJECT_TYPE objType, class T, bool doGet> constexpr static void CheckObjectValueType() {
-	static_assert((objType != OBJECT_BINARY_INPUT) || std::is_same_v<T, bool>,
-		"Object type requires boolean value.");
+	typedef hvac::ObjectTraits<objType> Traits;
 	
 	if constexpr (doGet) {
-		static_assert((objType != OBJECT_BINARY_OUTPUT) || std::is_same_v<T, bool>,
-			"Object type requires boolean value.");
+		static_assert(std::is_same_v<T, typename Traits::ValueType>,
+			"Object type requires different value type.");
 	}
 	else {
-		static_assert((objType != OBJECT_BINARY_OUTPUT) || std::is_same_v<T, hvac::ValueWithPriority>,
-			"Object type requires value with priority.");
+		static_assert(std::is_same_v<T, typename Traits::SetType>,
+			"Object type requires different value type, or value with priority if it's commandable.");
 	}
 	
 	return;
@@ -64,8 +210,28 @@ hvac::ValueWithPriority::ValueWithPriority(bool val) {
 	priority = 1;													//custom value will have highest priority
 }
 
+//! Constructor for float type (analog objects).
+//! @param[in] val User value.
+hvac::ValueWithPriority::ValueWithPriority(float val) {
+	value.emplace<float>(val);
+	priority = 1;
+}
+
+//! Constructor for uint32_t type (multi-state objects).
+//! @param[in] val User value, state number starting from 1.
+hvac::ValueWithPriority::ValueWithPriority(uint32_t val) {
+	value.emplace<uint32_t>(val);
+	priority = 1;
+}
+
 //! Deconstructor.
 hvac::BacServer::~BacServer() {
+	for (const int fd : {epollFd, stopFd, timerFd}) {
+		if (fd != -1) {
+			close(fd);
+		}
+	}
+	
 	bip_cleanup();
 	return;
 }
@@ -99,8 +265,12 @@ bool hvac::BacServer::Run() {
 		result = false;
 	}
 	else if (!server->thd.joinable()) {
+		uint64_t val;
+		
 		SPDLOG_INFO("BACnet server starting up.");
-		server->stop = false;
+		if ((read(server->stopFd, &val, sizeof(val)) < 0) && (errno != EAGAIN)) {	//clears previous Stop()
+			SPDLOG_WARN("Error clearing BACnet server stop notification: '{}'", std::strerror(errno));
+		}
 		server->thd = std::thread(&BacServer::Process, server.get());
 	}
 	
@@ -117,8 +287,12 @@ bool hvac::BacServer::Stop() {
 		result = false;
 	}
 	else if (server->thd.joinable()) {
+		const uint64_t val = 1u;
+		
 		SPDLOG_INFO("BACnet server shutting down.");
-		server->stop = true;
+		if (write(server->stopFd, &val, sizeof(val)) != sizeof(val)) {
+			SPDLOG_ERROR("Error notifying BACnet server to stop: '{}'", std::strerror(errno));
+		}
 		server->thd.join();
 	}
 	
@@ -126,80 +300,142 @@ bool hvac::BacServer::Stop() {
 }
 
 //! Creates BACnet object.
-//! @param[in] devId BACnet device instance ID. Currently ignored.
+//! @param[in] devId BACnet device instance ID, either own or virtual device.
 //! @param[in] objType BACnet object type.
 //! @param[in] objId BACnet object instance ID. Must be lower than BACNET_MAX_INSTANCE.
 //! @return True if BACnet object already exists or is created successfully.
-bool hvac::BacServer::CreateObject(uint32_t, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+bool hvac::BacServer::CreateObject(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+	DevRouter *router = VirtualRouter(devId);
 	bool result = false;
 	
-	if (Device_Valid_Object_Type(objType)) {
-		switch (objType) {
-		case OBJECT_BINARY_INPUT:
-			result = Binary_Input_Create(objId);
-			break;
-		case OBJECT_BINARY_OUTPUT:
-			result = Binary_Output_Create(objId);
-			break;
-		default:
-			break;
+	if (router) {
+		result = router->CreateObject(devId, objType, objId);
+	}
+	else if (Device_Valid_Object_Type(objType)) {
+		result = VisitObjectType(objType, [objId](auto type) {
+			return ObjectTraits<decltype(type)::value>::Create(objId);
+		});
+	}
+	
+	if (result) {
+		ValueChanged(devId, objType, objId, false);
+	}
+	
+	return result;
+}
+
+//! Creates BACnet objects in bulk, e.g. whole site at startup. Own device objects are created in ascending
+//! type and instance order, so BACnet stack object lists are appended to instead of being shifted, and virtual
+//! device objects are handed over to router in single batch.
+//! @param[in] objects BACnet objects to be created, in any order.
+//! @return Count of BACnet objects that already exist or are created successfully.
+size_t hvac::BacServer::CreateObjects(const std::vector<ObjectSpec> &objects) {
+	if (!server) {
+		SPDLOG_ERROR("BACnet server not initialized, can't create objects.");
+		return 0;
+	}
+	
+	const auto startTs = std::chrono::steady_clock::now();
+	std::vector<ObjectSpec> ownObjs, virtObjs;
+	size_t result = 0;
+	
+	for (const ObjectSpec &obj : objects) {
+		(VirtualRouter(obj.devId) ? virtObjs : ownObjs).push_back(obj);
+	}
+	
+	std::sort(ownObjs.begin(), ownObjs.end(), [](const ObjectSpec &lhs, const ObjectSpec &rhs) {
+		return (lhs.objType < rhs.objType) || ((lhs.objType == rhs.objType) && (lhs.objId < rhs.objId));
+	});
+	
+	for (auto first = ownObjs.begin(); first != ownObjs.end();) {		//one run per object type
+		const auto last = std::find_if(first, ownObjs.end(), [first](const ObjectSpec &obj) {
+			return obj.objType != first->objType;
+		});
+		
+		if (Device_Valid_Object_Type(first->objType)) {
+			VisitObjectType(first->objType, [first, last, &result](auto type) {
+				for (auto obj = first; obj != last; ++obj) {
+					result += ObjectTraits<decltype(type)::value>::Create(obj->objId);
+				}
+				return true;
+			});
 		}
+		
+		first = last;
+	}
+	
+	if (!virtObjs.empty()) {
+		result += server->router->CreateObjects(virtObjs);
 	}
 	
+	server->rpmCache.InvalidateAll();
+	
+	const auto elapsed = std::chrono::steady_clock::now() - startTs;
+	SPDLOG_INFO("Created {} of {} BACnet object(s) in {} ms.", result, objects.size(),
+		std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+	
 	return result;
 }
 
 //! Deletes BACnet object.
-//! @param[in] devId Target BACnet device instance ID. Currently ignored.
+//! @param[in] devId Target BACnet device instance ID, either own or virtual device.
 //! @param[in] objType Target BACnet object type.
 //! @param[in] objId Target BACnet object instance ID.
 //! @return True if target BACnet object doesn't exists or is deleted successfully.
-bool hvac::BacServer::DeleteObject(uint32_t, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+bool hvac::BacServer::DeleteObject(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+	DevRouter *router = VirtualRouter(devId);
 	bool result = true;
 	
-	if (Device_Valid_Object_Type(objType)) {
-		switch (objType) {
-		case OBJECT_BINARY_INPUT:
-			result = Binary_Input_Delete(objId);
-			break;
-		case OBJECT_BINARY_OUTPUT:
-			result = Binary_Output_Delete(objId);
-			break;
-		default:
-			break;
-		}
+	if (router) {
+		result = router->DeleteObject(devId, objType, objId);
+	}
+	else if (Device_Valid_Object_Type(objType)) {
+		VisitObjectType(objType, [objId, &result](auto type) {
+			result = ObjectTraits<decltype(type)::value>::Delete(objId);
+			return true;
+		});
 	}
 	
+	ValueChanged(devId, objType, objId, false);
+	
 	return result;
 }
 
 //! Getter for BACnet object present value.
 //! @tparam objType Target BACnet object type.
 //! @tparam T User variable type. Deductible from \b val.
-//! @param[in] devId Target BACnet device instance ID. Currently ignored.
+//! @param[in] devId Target BACnet device instance ID, either own or virtual device.
 //! @param[in] objId Target BACnet object instance ID.
 //! @param[out] val User variable reference for output. Its type must match target object present value type.
 //! @return True if target BACnet object exists.
-template<BACNET_OBJECT_TYPE objType, class T> bool hvac::BacServer::GetObjectValue(uint32_t, uint32_t objId,
-T &val) {
+template<BACNET_OBJECT_TYPE objType, class T> bool hvac::BacServer::GetObjectValue(uint32_t devId,
+uint32_t objId, T &val) {
 	CheckObjectValueType<objType, T, true>();
 	
+	typedef typename ObjectTraits<objType>::PvType PvType;
+	DevRouter *router = VirtualRouter(devId);
 	bool result = false;
 	
-	if (Device_Valid_Object_Id(objType, objId)) {
-		switch (objType) {
-		case OBJECT_BINARY_INPUT:
-			val = (Binary_Input_Present_Value(objId) == BINARY_ACTIVE);
-			result = true;
-			break;
-		case OBJECT_BINARY_OUTPUT:
-			val = (Binary_Output_Present_Value(objId) == BINARY_ACTIVE);
-			result = true;
-			break;
-		default:
-			break;
+	if (router) {
+		ValueTypes tmpVal;
+		
+		if (router->GetObjectValue(devId, objType, objId, tmpVal)) {
+			if (std::holds_alternative<T>(tmpVal)) {
+				val = std::get<T>(tmpVal);
+				result = true;
+			}
+			else if (std::holds_alternative<ValueWithPriority>(tmpVal) &&
+			std::holds_alternative<PvType>(std::get<ValueWithPriority>(tmpVal).value)) {
+				val = ObjectTraits<objType>::ToValue(
+					std::get<PvType>(std::get<ValueWithPriority>(tmpVal).value));
+				result = true;
+			}
 		}
 	}
+	else if (Device_Valid_Object_Id(objType, objId)) {
+		val = ObjectTraits<objType>::Get(objId);
+		result = true;
+	}
 	
 	return result;
 }
@@ -207,30 +443,29 @@ T &val) {
 //! Setter for BACnet object present value.
 //! @tparam objType Target BACnet object type.
 //! @tparam T User variable type. Deductible from \b val.
-//! @param[in] devId Target BACnet device instance ID. Currently ignored.
+//! @param[in] devId Target BACnet device instance ID, either own or virtual device.
 //! @param[in] objId Target BACnet object instance ID.
 //! @param[out] val User variable reference for output. Its type must match target object present value type.
 //! @return True if target BACnet object exists and its value is set successfully.
-template<BACNET_OBJECT_TYPE objType, class T> bool hvac::BacServer::SetObjectValue(uint32_t, uint32_t objId,
-const T &val) {
+template<BACNET_OBJECT_TYPE objType, class T> bool hvac::BacServer::SetObjectValue(uint32_t devId,
+uint32_t objId, const T &val) {
 	CheckObjectValueType<objType, T, false>();
 	
+	DevRouter *router = VirtualRouter(devId);
+	typename ObjectTraits<objType>::ValueType oldVal{}, newVal{};
+	const bool hasOldVal = GetObjectValue<objType>(devId, objId, oldVal);	//only actual change notifies COV
 	bool result;
 	
-	if constexpr (objType == OBJECT_BINARY_INPUT) {
-		result = Binary_Input_Present_Value_Set(objId, val ? BINARY_ACTIVE : BINARY_INACTIVE);
-	}
-	else if constexpr (objType == OBJECT_BINARY_OUTPUT) {
-		if (std::holds_alternative<BACNET_BINARY_PV>(val.value)) {
-			result = Binary_Output_Present_Value_Set(objId, std::get<BACNET_BINARY_PV>(val.value),
-				val.priority);
-		}
-		else {
-			result = false;
-		}
+	if (router) {
+		result = router->SetObjectValue(devId, objType, objId, ValueTypes(val));
 	}
 	else {
-		result = false;
+		result = ObjectTraits<objType>::Set(objId, val);
+	}
+	
+	if (result) {
+		ValueChanged(devId, objType, objId,
+			!hasOldVal || !GetObjectValue<objType>(devId, objId, newVal) || (newVal != oldVal));
 	}
 	
 	return result;
@@ -290,7 +525,8 @@ uint32_t objId, T &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &errCode
 	return result;
 }
 
-//! Bridge from BACnet stack to device manager to set BACnet object present value.
+//! Bridge from BACnet stack to device manager to set BACnet object present value. Cached responses are dropped
+//! and COV subscribers are notified on success, as value is changed by BACnet stack right after.
 //! @tparam objType Target BACnet object type.
 //! @tparam T New BACnet object value type. Deductible from \b val.
 //! @param[in] devId Target BACnet device instance ID.
@@ -307,6 +543,7 @@ uint32_t objId, const T &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &e
 	bool result;
 	
 	if (status == 200u) {
+		ValueChanged(devId, objType, objId, true);
 		result = true;
 	}
 	else {
@@ -339,7 +576,9 @@ uint32_t objId, const T &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &e
 //! @param config Configuration object.
 //! @throw invalid_argument If configuration JSON type is not object.
 //!							If error setting device ID/name and network interface name/port.
-hvac::BacServer::BacServer(const nlohmann::json &config) {
+//! @throw runtime_error If error creating epoll, eventfd or timerfd instance.
+hvac::BacServer::BacServer(const nlohmann::json &config) : addrElapsedMs(0), timerTs(0), timerDueTs(0),
+epollFd(-1), stopFd(-1), timerFd(-1) {
 	if (!config.is_object()) {
 		throw std::invalid_argument("Invalid configuration JSON type.");
 	}
@@ -347,16 +586,23 @@ hvac::BacServer::BacServer(const nlohmann::json &config) {
 	nlohmann::json jsonVal;
 	std::string deviceName = "HVAC Device 0", nicName = "eth0";
 	uint32_t deviceId = 0, nicPort = 47808;
+	size_t covMaxSubs = COV_MAX_SUBSCRIPTIONS;
 	
 	address_init();
 	Device_Init(NULL);
 	apdu_set_unconfirmed_handler(SERVICE_UNCONFIRMED_WHO_IS, handler_who_is);
 	apdu_set_unconfirmed_handler(SERVICE_UNCONFIRMED_WHO_HAS, handler_who_has);
 	apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROPERTY, handler_read_property);
-	apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE, handler_read_property_multiple);
-	apdu_set_confirmed_handler(SERVICE_CONFIRMED_WRITE_PROPERTY, handler_write_property);
-	apdu_set_confirmed_handler(SERVICE_CONFIRMED_WRITE_PROP_MULTIPLE, handler_write_property_multiple);
+	apdu_set_confirmed_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE, HandleReadPropertyMultiple);
+	apdu_set_confirmed_handler(SERVICE_CONFIRMED_WRITE_PROPERTY, HandleWriteProperty<handler_write_property>);
+	apdu_set_confirmed_handler(SERVICE_CONFIRMED_WRITE_PROP_MULTIPLE,
+		HandleWriteProperty<handler_write_property_multiple>);
+	apdu_set_confirmed_handler(SERVICE_CONFIRMED_SUBSCRIBE_COV,
+		HandleSubscribeCov<SERVICE_CONFIRMED_SUBSCRIBE_COV>);
+	apdu_set_confirmed_handler(SERVICE_CONFIRMED_SUBSCRIBE_COV_PROPERTY,
+		HandleSubscribeCov<SERVICE_CONFIRMED_SUBSCRIBE_COV_PROPERTY>);
 	apdu_set_unrecognized_service_handler_handler(handler_unrecognized_service);
+	tsm_set_timeout_handler(HandleTsmTimeout);
 	
 	if (!Private::JsonExtract(config, "device_id", nlohmann::json::value_t::number_unsigned, jsonVal)) {
 		SPDLOG_WARN("Missing or invalid 'device_id' configuration, defaulting to '{}'.", deviceId);
@@ -396,16 +642,72 @@ hvac::BacServer::BacServer(const nlohmann::json &config) {
 		throw std::invalid_argument("Error initializing BACnet IP service with NIC '" + nicName + "'.");
 	}
 	
+	if (Private::JsonExtract(config, "cov_max_subscriptions", nlohmann::json::value_t::number_unsigned,
+	jsonVal)) {
+		covMaxSubs = jsonVal.get<size_t>();
+	}
+	cov.reset(new CovManager(covMaxSubs));
+	
+	if (Private::JsonExtract(config, "virtual_network", nlohmann::json::value_t::number_unsigned, jsonVal)) {
+		const uint32_t network = jsonVal.get<uint32_t>();
+		size_t devQt = 0;
+		
+		if (!network || (network >= BACNET_BROADCAST_NETWORK)) {
+			throw std::invalid_argument("Invalid virtual network number '" + std::to_string(network) + "'.");
+		}
+		router.reset(new DevRouter(network));
+		
+		if (Private::JsonExtract(config, "virtual_devices", nlohmann::json::value_t::array, jsonVal)) {
+			for (const auto &device : jsonVal) {
+				nlohmann::json devVal;
+				uint32_t devId;
+				
+				if (!Private::JsonExtract(device, "device_id", nlohmann::json::value_t::number_unsigned,
+				devVal)) {
+					throw std::invalid_argument("Missing or invalid virtual device 'device_id' configuration.");
+				}
+				devId = devVal.get<uint32_t>();
+				
+				if (!Private::JsonExtract(device, "device_name", nlohmann::json::value_t::string, devVal)) {
+					devVal = "HVAC Device " + std::to_string(devId);
+				}
+				
+				if (!router->AddDevice(devId, devVal.get<std::string>())) {
+					throw std::invalid_argument("Error adding virtual device with ID '" +
+						std::to_string(devId) + "'.");
+				}
+				++devQt;
+			}
+		}
+		
+		SPDLOG_INFO("BACnet server routing to {} virtual device(s) at network '{}'.", devQt, network);
+	}
+	
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if ((epollFd == -1) || (stopFd == -1) || (timerFd == -1)) {
+		throw std::runtime_error("Error creating BACnet server event handles: " +
+			std::string(std::strerror(errno)));
+	}
+	
+	for (const int fd : {bip_socket(), stopFd, timerFd, cov->GetWakeFd()}) {
+		epoll_event event = {};
+		
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event)) {
+			throw std::runtime_error("Error adding BACnet server event handle: " +
+				std::string(std::strerror(errno)));
+		}
+	}
+	
 	return;
 }
 
-//! Server process that is intended to run on separate thread.
+//! Server process that is intended to run on separate thread. Sleeps in epoll until datagram arrives, timer
+//! expires or \ref Stop() is called, so it doesn't wake up at all when idle.
 void hvac::BacServer::Process() {
-	const std::unique_ptr<uint8_t> recvBuf(new uint8_t[MAX_MPDU]);
-	const std::unique_ptr<BACNET_ADDRESS> recvSrc(new BACNET_ADDRESS());
-	time_t prevSec = time(NULL);
-	uint32_t addrElapsedSec = 0;
-	
 	{																//for reporting purpose only
 		BACNET_CHARACTER_STRING bacName;
 		BACNET_IP_ADDRESS bacAddr;
@@ -419,25 +721,47 @@ void hvac::BacServer::Process() {
 		}
 	}
 	
-	while (!stop) {
-		const time_t curSec = time(NULL);
-		const uint32_t elapsedSec = (uint32_t)(curSec - prevSec);
-		const uint16_t recvLen = bip_receive(recvSrc.get(), recvBuf.get(), MAX_MPDU, 10);
+	if (router) {
+		router->AnnounceRouter();
+	}
+	
+	timerTs = MonotonicMs();
+	
+	while (true) {
+		epoll_event events[4];
+		const int eventQt = epoll_wait(epollFd, events, sizeof(events) / sizeof(*events), -1);
+		bool stop = false;
 		
-		if (recvLen) {												//returns 0 bytes on timeout
-			npdu_handler(recvSrc.get(), recvBuf.get(), recvLen);
+		if (eventQt < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			
+			SPDLOG_ERROR("Error waiting for BACnet server events: '{}'", std::strerror(errno));
+			break;
 		}
 		
-		if (elapsedSec) {											//at least one second has passed
-			prevSec = curSec;
-			tsm_timer_milliseconds(elapsedSec * 1000u);
+		for (int i = 0; i < eventQt; ++i) {
+			if (events[i].data.fd == stopFd) {
+				stop = true;
+			}
+			else if ((events[i].data.fd == timerFd) || (events[i].data.fd == cov->GetWakeFd())) {
+				uint64_t count;
+				
+				if (read(events[i].data.fd, &count, sizeof(count)) < 0) {	//only to re-arm edge, count unused
+					SPDLOG_TRACE("BACnet server timer read: '{}'", std::strerror(errno));
+				}
+			}
+			else if (!RecvDatagrams()) {
+				stop = true;
+			}
 		}
 		
-		addrElapsedSec += elapsedSec;
-		if (addrElapsedSec >= 60) {									//manage cached address
-			address_cache_timer(addrElapsedSec);
-			addrElapsedSec = 0;
+		if (stop) {
+			break;
 		}
+		
+		ServiceTimers();											//after whole batch is handled
 	}
 	
 	SPDLOG_INFO("BACnet server shut down.");
@@ -445,21 +769,242 @@ void hvac::BacServer::Process() {
 	return;
 }
 
+//! Helper function to drain BACnet/IP socket in batches, and pass each datagram to BACnet stack.
+//! @return False if socket error has occurred.
+bool hvac::BacServer::RecvDatagrams() {
+	static uint8_t recvBufs[RECV_BATCH_SZ][MAX_MPDU];
+	mmsghdr msgs[RECV_BATCH_SZ];
+	iovec iovs[RECV_BATCH_SZ];
+	sockaddr_in srcAddrs[RECV_BATCH_SZ];
+	BACNET_IP_ADDRESS ownAddr;
+	int recvQt;
+	
+	bip_get_addr(&ownAddr);
+	
+	do {
+		for (unsigned i = 0; i < RECV_BATCH_SZ; ++i) {
+			iovs[i] = {recvBufs[i], MAX_MPDU};
+			msgs[i] = {};
+			msgs[i].msg_hdr.msg_name = &srcAddrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(srcAddrs[i]);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		
+		recvQt = recvmmsg(bip_socket(), msgs, RECV_BATCH_SZ, MSG_DONTWAIT, nullptr);
+		if (recvQt < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+				return true;
+			}
+			
+			SPDLOG_ERROR("Error receiving BACnet datagram: '{}'", std::strerror(errno));
+			return false;
+		}
+		
+		for (int i = 0; i < recvQt; ++i) {							//same as bip_receive(), minus select()
+			const uint16_t recvLen = msgs[i].msg_len;
+			BACNET_IP_ADDRESS srcAddr;
+			BACNET_ADDRESS src = {};
+			
+			if ((recvLen < 4) || (recvBufs[i][0] != BVLL_TYPE_BACNET_IP)) {
+				continue;
+			}
+			
+			memcpy(srcAddr.address, &srcAddrs[i].sin_addr.s_addr, sizeof(srcAddr.address));
+			srcAddr.port = ntohs(srcAddrs[i].sin_port);
+			if (!memcmp(srcAddr.address, ownAddr.address, sizeof(srcAddr.address)) &&
+			(srcAddr.port == ownAddr.port)) {						//own broadcast
+				continue;
+			}
+			
+			const int offset = bvlc_handler(&srcAddr, &src, recvBufs[i], recvLen);
+			if ((offset > 0) && (!router || !router->HandleNpdu(src, recvBufs[i] + offset, recvLen - offset))) {
+				npdu_handler(&src, recvBufs[i] + offset, recvLen - offset);
+			}
+		}
+	} while (recvQt == RECV_BATCH_SZ);								//partial batch means socket is drained
+	
+	return true;
+}
+
+//! Helper function to advance TSM and address cache timers by actual elapsed time, and to send due COV
+//! notifications. Timer is only armed while there's active TSM transaction or pending COV tick, address cache
+//! is aged lazily on next wake up otherwise.
+void hvac::BacServer::ServiceTimers() {
+	const uint64_t now = MonotonicMs();
+	uint64_t elapsedMs = now - timerTs;
+	
+	addrElapsedMs += elapsedMs;
+	timerTs = now;
+	
+	while (elapsedMs) {												//tsm_timer_milliseconds() takes 16 bits
+		const uint16_t stepMs = (elapsedMs > UINT16_MAX) ? UINT16_MAX : elapsedMs;
+		
+		tsm_timer_milliseconds(stepMs);
+		elapsedMs -= stepMs;
+	}
+	
+	if (addrElapsedMs >= ADDR_CACHE_TIMER_MS) {						//manage cached address
+		address_cache_timer(addrElapsedMs / 1000u);
+		addrElapsedMs %= 1000u;
+	}
+	
+	uint64_t delayMs = cov->Service(now);
+	if (tsm_transaction_idle_count() < MAX_TSM_TRANSACTIONS) {
+		delayMs = std::min<uint64_t>(delayMs, TSM_TIMER_MS);
+	}
+	
+	const uint64_t dueTs = (delayMs == UINT64_MAX) ? 0u : (now + std::max<uint64_t>(delayMs, 1u));
+	if (dueTs != timerDueTs) {										//one-shot, zero disarms
+		itimerspec spec = {};
+		
+		if (dueTs) {
+			spec.it_value.tv_sec = (dueTs - now) / 1000u;
+			spec.it_value.tv_nsec = ((dueTs - now) % 1000u) * 1000000l;
+		}
+		
+		if (timerfd_settime(timerFd, 0, &spec, nullptr)) {
+			SPDLOG_ERROR("Error setting BACnet server timer: '{}'", std::strerror(errno));
+		}
+		else {
+			timerDueTs = dueTs;
+		}
+	}
+	
+	return;
+}
+
+//! Handles SubscribeCOV or SubscribeCOVProperty request to own or virtual device. Called from BACnet server
+//! thread only.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in] src Subscriber address.
+//! @param[in] invokeId Request invoke ID.
+//! @param[in] service Request service choice.
+//! @param[in] req Service request, after service choice.
+//! @param[in] reqLen Service request length, in bytes.
+//! @param[out] resp Response APDU buffer, at least MAX_APDU bytes.
+//! @return Response APDU length, in bytes.
+int hvac::BacServer::SubscribeCov(uint32_t devId, const BACNET_ADDRESS &src, uint8_t invokeId, uint8_t service,
+uint8_t *req, uint16_t reqLen, uint8_t *resp) {
+	return server->cov->HandleSubscribe(devId, src, invokeId, service, req, reqLen, resp);
+}
+
+//! Encodes ReadPropertyMultiple-ACK for own or virtual device, from \ref RpmCache. Called from BACnet server
+//! thread only.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in] invokeId Request invoke ID.
+//! @param[in] req Service request, after service choice.
+//! @param[in] reqLen Service request length, in bytes.
+//! @param[out] resp Response APDU buffer.
+//! @param[in] respSz Response size limit, in bytes.
+//! @param[in] readProp Property encoder of target device, for cache miss.
+//! @return Response APDU length, in bytes. Negative if request isn't handled.
+int hvac::BacServer::ReadPropertyMultiple(uint32_t devId, uint8_t invokeId, uint8_t *req, uint16_t reqLen,
+uint8_t *resp, unsigned respSz, const RpmCache::ReadFunc &readProp) {
+	return server->rpmCache.Encode(devId, invokeId, req, reqLen, resp, respSz, readProp);
+}
+
+//! Drops cached ReadPropertyMultiple results of device, after BACnet stack has handled property write. Called
+//! from BACnet server thread only.
+//! @param[in] devId BACnet device instance ID.
+void hvac::BacServer::PropertiesWritten(uint32_t devId) {
+	if (server) {
+		server->rpmCache.InvalidateDevice(devId);
+	}
+}
+
+//! Sends APDU from own or virtual device. Confirmed request from own device is handed over to TSM for retries,
+//! so its invoke ID must come from tsm_next_free_invokeID(), and is freed by TSM timeout handler if unanswered.
+//! @param[in] devId Source BACnet device instance ID.
+//! @param[in] dest Destination address.
+//! @param[in] apdu APDU to be sent.
+//! @param[in] apduLen APDU length, in bytes.
+//! @param[in] confirmed True if APDU is confirmed request, expecting reply.
+//! @return True if APDU is sent successfully.
+bool hvac::BacServer::SendApdu(uint32_t devId, const BACNET_ADDRESS &dest, uint8_t *apdu, unsigned apduLen,
+bool confirmed) {
+	DevRouter *router = VirtualRouter(devId);
+	
+	if (router) {
+		return router->SendFrom(devId, dest, apdu, apduLen, confirmed);
+	}
+	
+	uint8_t pdu[MAX_PDU];
+	BACNET_ADDRESS sendDest = dest, src;
+	BACNET_NPDU_DATA npduData;
+	
+	datalink_get_my_address(&src);
+	npdu_encode_npdu_data(&npduData, confirmed, MESSAGE_PRIORITY_NORMAL);
+	const int pduLen = npdu_encode_pdu(pdu, &sendDest, &src, &npduData);
+	
+	if ((pduLen + apduLen) > sizeof(pdu)) {
+		SPDLOG_WARN("BACnet APDU of {} bytes is too big.", apduLen);
+		return false;
+	}
+	
+	memcpy(pdu + pduLen, apdu, apduLen);
+	if (confirmed) {
+		tsm_set_confirmed_unsegmented_transaction(apdu[2], &sendDest, &npduData, pdu, pduLen + apduLen);
+	}
+	
+	return datalink_send_pdu(&sendDest, &npduData, pdu, pduLen + apduLen) > 0;
+}
+
+//! Helper function to drop cached responses of changed object, and to notify its COV subscribers.
+//! @param[in] devId BACnet device instance ID. Any ID other than virtual device's refers to own device.
+//! @param[in] objType BACnet object type.
+//! @param[in] objId BACnet object instance ID.
+//! @param[in] isCov True if present value has changed.
+void hvac::BacServer::ValueChanged(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId, bool isCov) {
+	if (server) {
+		if (!VirtualRouter(devId)) {								//same key as own device requests use
+			devId = Device_Object_Instance_Number();
+		}
+		
+		server->rpmCache.Invalidate(devId, objType, objId);
+		
+		if (isCov && server->cov) {
+			server->cov->MarkChanged(devId, objType, objId);
+		}
+	}
+	
+	return;
+}
+
+//! Helper function to get router hosting virtual device.
+//! @param[in] devId BACnet device instance ID.
+//! @return Router, nullptr if target is own device (or server not initialized).
+hvac::DevRouter* hvac::BacServer::VirtualRouter(uint32_t devId) {
+	DevRouter *result = nullptr;
+	
+	if (server && server->router && (devId != Device_Object_Instance_Number()) &&
+	server->router->HasDevice(devId)) {
+		result = server->router.get();
+	}
+	
+	return result;
+}
+
 std::unique_ptr<hvac::BacServer> hvac::BacServer::server;
 
-//explicit template instantiation
-template bool hvac::BacServer::GetObjectValue<OBJECT_BINARY_INPUT>(uint32_t devId, uint32_t objId, bool &val);
-template bool hvac::BacServer::GetObjectValue<OBJECT_BINARY_OUTPUT>(uint32_t devId, uint32_t objId,
-	bool &val);
-template bool hvac::BacServer::SetObjectValue<OBJECT_BINARY_INPUT>(uint32_t devId, uint32_t objId,
-	const bool &val);
-template bool hvac::BacServer::SetObjectValue<OBJECT_BINARY_OUTPUT>(uint32_t devId, uint32_t objId,
-	const hvac::ValueWithPriority &val);
-template bool hvac::BacServer::GetObjectValueBS<OBJECT_BINARY_INPUT>(uint32_t devId, uint32_t objId,
-	bool &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &errCode);
-template bool hvac::BacServer::GetObjectValueBS<OBJECT_BINARY_OUTPUT>(uint32_t devId, uint32_t objId,
-	bool &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &errCode);
-template bool hvac::BacServer::SetObjectValueBS<OBJECT_BINARY_INPUT>(uint32_t devId, uint32_t objId,
-	const bool &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &errCode);
-template bool hvac::BacServer::SetObjectValueBS<OBJECT_BINARY_OUTPUT>(uint32_t devId, uint32_t objId,
-	const hvac::ValueWithPriority &val, BACNET_ERROR_CLASS &errClass, BACNET_ERROR_CODE &errCode);
+//explicit template instantiation, for every type in hvac::SupportedObjectTypes
+#define INSTANTIATE_OBJECT_TYPE(objType) \
+	template bool hvac::BacServer::GetObjectValue<objType>(uint32_t devId, uint32_t objId, \
+		hvac::ObjectTraits<objType>::ValueType &val); \
+	template bool hvac::BacServer::SetObjectValue<objType>(uint32_t devId, uint32_t objId, \
+		const hvac::ObjectTraits<objType>::SetType &val); \
+	template bool hvac::BacServer::GetObjectValueBS<objType>(uint32_t devId, uint32_t objId, \
+		hvac::ObjectTraits<objType>::ValueType &val, BACNET_ERROR_CLASS &errClass, \
+		BACNET_ERROR_CODE &errCode); \
+	template bool hvac::BacServer::SetObjectValueBS<objType>(uint32_t devId, uint32_t objId, \
+		const hvac::ObjectTraits<objType>::SetType &val, BACNET_ERROR_CLASS &errClass, \
+		BACNET_ERROR_CODE &errCode);
+
+INSTANTIATE_OBJECT_TYPE(OBJECT_ANALOG_INPUT)
+INSTANTIATE_OBJECT_TYPE(OBJECT_ANALOG_OUTPUT)
+INSTANTIATE_OBJECT_TYPE(OBJECT_ANALOG_VALUE)
+INSTANTIATE_OBJECT_TYPE(OBJECT_BINARY_INPUT)
+INSTANTIATE_OBJECT_TYPE(OBJECT_BINARY_OUTPUT)
+INSTANTIATE_OBJECT_TYPE(OBJECT_MULTI_STATE_INPUT)
+INSTANTIATE_OBJECT_TYPE(OBJECT_MULTI_STATE_OUTPUT)
+INSTANTIATE_OBJECT_TYPE(OBJECT_MULTI_STATE_VALUE)
@@ -0,0 +1,443 @@
+#include "main.h"
+#include "BacServer.h"
+#include "CovManager.h"
+#include "ObjectTraits.h"
+
+#include <Commons.h>
+
+#include <bacnet/bacdcode.h>
+#include <bacnet/bacerror.h>
+#include <bacnet/basic/object/device.h>
+#include <bacnet/basic/tsm/tsm.h>
+#include <bacnet/reject.h>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+//! Notification tick, changes within same tick are coalesced into single notification, in ms.
+constexpr static uint64_t COV_TICK_MS = 100u;
+
+//! Helper function to get current CLOCK_MONOTONIC time.
+//! @return Current time, in seconds.
+static uint64_t MonotonicSec() {
+	timespec now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	
+	return now.tv_sec;
+}
+
+//! Constructor.
+//! @param[in] maxSubs Subscription count limit, over all devices.
+//! @throw runtime_error If error creating eventfd instance.
+hvac::CovManager::CovManager(size_t maxSubs) : subQt(0), maxSubs(maxSubs), pendingMs(0),
+wheelSec(MonotonicSec()), nextSubId(0), invokeId(0) {
+	wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (wakeFd == -1) {
+		throw std::runtime_error("Error creating COV event handle: " + std::string(std::strerror(errno)));
+	}
+}
+
+//! Deconstructor.
+hvac::CovManager::~CovManager() {
+	close(wakeFd);
+}
+
+//! Handles SubscribeCOV and SubscribeCOVProperty request, for own or virtual device. Subscriber gets initial
+//! notification on next \ref Service() call.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in] src Subscriber address.
+//! @param[in] invokeId Request invoke ID.
+//! @param[in] service Request service choice.
+//! @param[in] req Service request, after service choice.
+//! @param[in] reqLen Service request length, in bytes.
+//! @param[out] resp Response APDU buffer, at least MAX_APDU bytes.
+//! @return Response APDU length, in bytes.
+int hvac::CovManager::HandleSubscribe(uint32_t devId, const BACNET_ADDRESS &src, uint8_t invokeId,
+uint8_t service, uint8_t *req, uint16_t reqLen, uint8_t *resp) {
+	BACNET_SUBSCRIBE_COV_DATA covData = {};
+	BACNET_PROPERTY_VALUE values[2];
+	int reqResult;
+	
+	if (service == SERVICE_CONFIRMED_SUBSCRIBE_COV) {
+		reqResult = cov_subscribe_decode_service_request(req, reqLen, &covData);
+		covData.monitoredProperty.propertyIdentifier = PROP_ALL;
+	}
+	else {
+		reqResult = cov_subscribe_property_decode_service_request(req, reqLen, &covData);
+	}
+	
+	if (reqResult <= 0) {
+		return reject_encode_apdu(resp, invokeId, REJECT_REASON_MISSING_REQUIRED_PARAMETER);
+	}
+	
+	const ObjectRef obj = {devId, covData.monitoredObjectIdentifier.type,
+		covData.monitoredObjectIdentifier.instance};
+	const BACNET_PROPERTY_ID property = covData.monitoredProperty.propertyIdentifier;
+	auto objPos = objSubs.find(obj);
+	uint32_t subId = 0;
+	bool isFound = false;
+	
+	if (objPos != objSubs.end()) {									//same subscriber, process and property
+		for (const uint32_t id : objPos->second) {
+			const Subscription &sub = subs.at(id);
+			
+			if ((sub.processId == covData.subscriberProcessIdentifier) && (sub.property == property) &&
+			IsSameAddress(sub.subscriber, src)) {
+				subId = id;
+				isFound = true;
+				break;
+			}
+		}
+	}
+	
+	if (covData.cancellationRequest) {
+		if (isFound) {
+			RemoveSubscription(subId);
+		}
+		
+		return encode_simple_ack(resp, invokeId, service);
+	}
+	
+	const ReadFunc read = PresentValueReader(obj.objType);
+	if (!read || !ReadValues(obj, read, values)) {
+		return bacerror_encode_apdu(resp, invokeId, (BACNET_CONFIRMED_SERVICE) service, ERROR_CLASS_OBJECT,
+			ERROR_CODE_UNKNOWN_OBJECT);
+	}
+	if ((property != PROP_ALL) && (property != PROP_PRESENT_VALUE) && (property != PROP_STATUS_FLAGS)) {
+		return bacerror_encode_apdu(resp, invokeId, (BACNET_CONFIRMED_SERVICE) service, ERROR_CLASS_PROPERTY,
+			ERROR_CODE_NOT_COV_PROPERTY);
+	}
+	
+	if (!isFound) {
+		if (subs.size() >= maxSubs) {								//expired ones may not be swept yet
+			ExpireSubscriptions(MonotonicSec());
+		}
+		if (subs.size() >= maxSubs) {
+			return bacerror_encode_apdu(resp, invokeId, (BACNET_CONFIRMED_SERVICE) service,
+				ERROR_CLASS_RESOURCES, ERROR_CODE_NO_SPACE_TO_ADD_LIST_ELEMENT);
+		}
+		
+		do {														//skips IDs still in use after wrap around
+			subId = nextSubId++;
+		} while (subs.count(subId));
+		
+		subs.emplace(subId, Subscription{src, obj, read, 0, covData.subscriberProcessIdentifier, property,
+			false});
+		objSubs[obj].push_back(subId);
+		++subQt;
+	}
+	
+	Subscription &sub = subs.at(subId);								//resubscription only refreshes lifetime
+	sub.confirmed = covData.issueConfirmedNotifications;
+	sub.expirySec = covData.lifetime ? (MonotonicSec() + covData.lifetime) : 0u;
+	if (sub.expirySec) {
+		wheel[sub.expirySec % WHEEL_SLOTS].emplace_back(subId, sub.expirySec);
+	}
+	initial.push_back(subId);
+	
+	SPDLOG_DEBUG("COV subscription {} for device '{}' object '{}:{}' with lifetime {}s.",
+		isFound ? "renewed" : "added", devId, obj.objType, obj.objId, covData.lifetime);
+	
+	return encode_simple_ack(resp, invokeId, service);
+}
+
+//! Marks object present value as changed, to notify its subscribers on next tick. Thread-safe.
+//! @param[in] devId BACnet device instance ID.
+//! @param[in] objType BACnet object type.
+//! @param[in] objId BACnet object instance ID.
+void hvac::CovManager::MarkChanged(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+	if (!subQt.load(std::memory_order_relaxed)) {					//nobody to notify
+		return;
+	}
+	
+	bool doWake;
+	{
+		std::lock_guard<decltype(changedGuard)> lock(changedGuard);
+		
+		doWake = changed.empty();
+		changed.insert({devId, objType, objId});
+	}
+	
+	if (doWake) {													//only first change of tick wakes server up
+		const uint64_t val = 1u;
+		
+		if (write(wakeFd, &val, sizeof(val)) != sizeof(val)) {
+			SPDLOG_WARN("Error notifying BACnet server of COV: '{}'", std::strerror(errno));
+		}
+	}
+}
+
+//! Sends due notifications and expires subscriptions. Must be called from BACnet server thread, after every
+//! wake up.
+//! @param[in] nowMs Current CLOCK_MONOTONIC time, in ms.
+//! @return Delay until next call is needed (next tick or subscription expiry), in ms. UINT64_MAX if there's
+//! nothing pending.
+uint64_t hvac::CovManager::Service(uint64_t nowMs) {
+	const uint64_t nowSec = nowMs / 1000u;
+	BACNET_PROPERTY_VALUE values[2];
+	decltype(changed) dueObjs;
+	
+	ExpireSubscriptions(nowSec);
+	const uint64_t expiryMs = NextExpiryDelay(nowMs);
+	
+	for (const uint32_t subId : initial) {
+		const auto &sub = subs.find(subId);
+		
+		if ((sub != subs.end()) && ReadValues(sub->second.obj, sub->second.read, values)) {
+			Notify(sub->second, values, nowSec);
+		}
+	}
+	initial.clear();
+	
+	{
+		std::lock_guard<decltype(changedGuard)> lock(changedGuard);
+		
+		if (changed.empty()) {
+			pendingMs = 0;
+			return expiryMs;
+		}
+		
+		if (!pendingMs) {											//tick starts at first change seen
+			pendingMs = nowMs;
+		}
+		if ((nowMs - pendingMs) < COV_TICK_MS) {
+			return std::min(pendingMs + COV_TICK_MS - nowMs, expiryMs);
+		}
+		
+		dueObjs.swap(changed);
+		pendingMs = 0;
+	}
+	
+	for (const ObjectRef &obj : dueObjs) {							//value is read once for all subscribers
+		const auto &objPos = objSubs.find(obj);
+		
+		if ((objPos != objSubs.end()) && ReadValues(obj, subs.at(objPos->second.front()).read, values)) {
+			for (const uint32_t subId : objPos->second) {
+				Notify(subs.at(subId), values, nowSec);
+			}
+		}
+	}
+	
+	return expiryMs;
+}
+
+//! Getter for eventfd that becomes readable when \ref Service() should be called.
+//! @return Eventfd file descriptor. Must be read by caller to clear it.
+int hvac::CovManager::GetWakeFd() const {
+	return wakeFd;
+}
+
+//! Equality operator.
+//! @param[in] other Other object reference.
+//! @return True if both refer to same object.
+bool hvac::CovManager::ObjectRef::operator==(const ObjectRef &other) const {
+	return (devId == other.devId) && (objType == other.objType) && (objId == other.objId);
+}
+
+//! Hash function.
+//! @param[in] ref Object reference.
+//! @return Hash value.
+size_t hvac::CovManager::ObjectRefHash::operator()(const ObjectRef &ref) const {
+	return std::hash<uint64_t>()(((uint64_t) ref.devId << 32u) ^ ((uint64_t) ref.objType << 22u) ^ ref.objId);
+}
+
+//! Helper function to compare BACnet addresses.
+//! @param[in] addr1 First address.
+//! @param[in] addr2 Second address.
+//! @return True if both addresses are same.
+bool hvac::CovManager::IsSameAddress(const BACNET_ADDRESS &addr1, const BACNET_ADDRESS &addr2) {
+	return (addr1.mac_len == addr2.mac_len) && !memcmp(addr1.mac, addr2.mac, addr1.mac_len) &&
+		(addr1.net == addr2.net) && (addr1.len == addr2.len) && !memcmp(addr1.adr, addr2.adr, addr1.len);
+}
+
+//! Helper function to read present value of object with type known at compile time.
+//! @tparam objType BACnet object type, same as \b obj has.
+//! @param[in] obj Target object.
+//! @param[out] value Present value.
+//! @return False if object doesn't exist.
+template<BACNET_OBJECT_TYPE objType> bool hvac::CovManager::ReadPresentValue(const ObjectRef &obj,
+BACNET_APPLICATION_DATA_VALUE &value) {
+	typedef ObjectTraits<objType> Traits;
+	typename Traits::ValueType val;
+	
+	if (!BacServer::GetObjectValue<objType>(obj.devId, obj.objId, val)) {
+		return false;
+	}
+	
+	value.tag = Traits::PV_TAG;
+	if constexpr (std::is_same_v<typename Traits::ValueType, bool>) {
+		value.type.Enumerated = val ? BINARY_ACTIVE : BINARY_INACTIVE;
+	}
+	else if constexpr (std::is_same_v<typename Traits::ValueType, float>) {
+		value.type.Real = val;
+	}
+	else {
+		value.type.Unsigned_Int = val;
+	}
+	
+	return true;
+}
+
+//! Helper function to pick present value reader of object type. Done once at subscribe time, so notifications
+//! don't go through object type lookup.
+//! @param[in] objType BACnet object type.
+//! @return Present value reader, nullptr if object type isn't supported.
+hvac::CovManager::ReadFunc hvac::CovManager::PresentValueReader(BACNET_OBJECT_TYPE objType) {
+	ReadFunc result = nullptr;
+	
+	VisitObjectType(objType, [&](auto type) {
+		result = &ReadPresentValue<decltype(type)::value>;
+		return true;
+	});
+	
+	return result;
+}
+
+//! Helper function to read present value and status flags of object, as COV notification value list.
+//! @param[in] obj Target object.
+//! @param[in] read Present value reader of object type, from \ref PresentValueReader().
+//! @param[out] values Value list, linked in order.
+//! @return False if object doesn't exist.
+bool hvac::CovManager::ReadValues(const ObjectRef &obj, ReadFunc read, BACNET_PROPERTY_VALUE (&values)[2]) {
+	values[0] = {};
+	
+	const bool result = read(obj, values[0].value);
+	if (result) {
+		values[0].propertyIdentifier = PROP_PRESENT_VALUE;
+		values[0].propertyArrayIndex = BACNET_ARRAY_ALL;
+		values[0].priority = BACNET_NO_PRIORITY;
+		values[0].next = &values[1];
+		
+		values[1] = {};
+		values[1].propertyIdentifier = PROP_STATUS_FLAGS;
+		values[1].propertyArrayIndex = BACNET_ARRAY_ALL;
+		values[1].value.tag = BACNET_APPLICATION_TAG_BIT_STRING;
+		bitstring_init(&values[1].value.type.Bit_String);
+		bitstring_set_bit(&values[1].value.type.Bit_String, STATUS_FLAG_IN_ALARM, false);
+		bitstring_set_bit(&values[1].value.type.Bit_String, STATUS_FLAG_FAULT, false);
+		bitstring_set_bit(&values[1].value.type.Bit_String, STATUS_FLAG_OVERRIDDEN, false);
+		bitstring_set_bit(&values[1].value.type.Bit_String, STATUS_FLAG_OUT_OF_SERVICE, false);
+		values[1].priority = BACNET_NO_PRIORITY;
+		values[1].next = nullptr;
+	}
+	
+	return result;
+}
+
+//! Helper function to expire subscriptions in timer wheel slots passed since last call. Entries of renewed or
+//! cancelled subscriptions are stale, and dropped without effect.
+//! @param[in] nowSec Current CLOCK_MONOTONIC time, in seconds.
+void hvac::CovManager::ExpireSubscriptions(uint64_t nowSec) {
+	const uint64_t slotQt = std::min<uint64_t>(nowSec - wheelSec, WHEEL_SLOTS);
+	
+	for (uint64_t i = 1; i <= slotQt; ++i) {
+		auto &slot = wheel[(wheelSec + i) % WHEEL_SLOTS];
+		
+		slot.erase(std::remove_if(slot.begin(), slot.end(), [&](const std::pair<uint32_t, uint64_t> &entry) {
+			if (entry.second > nowSec) {							//due on later wheel round
+				return false;
+			}
+			
+			const auto &sub = subs.find(entry.first);
+			if ((sub != subs.end()) && (sub->second.expirySec == entry.second)) {
+				SPDLOG_DEBUG("COV subscription for device '{}' object '{}:{}' expired.", sub->second.obj.devId,
+					sub->second.obj.objType, sub->second.obj.objId);
+				RemoveSubscription(entry.first);
+			}
+			
+			return true;
+		}), slot.end());
+	}
+	
+	wheelSec = nowSec;
+}
+
+//! Helper function to get delay until first non-empty timer wheel slot is due. Slot may only hold entries due
+//! on later wheel round or stale entries, which costs a spurious wake up at most.
+//! @param[in] nowMs Current CLOCK_MONOTONIC time, in ms. Must be after \ref ExpireSubscriptions() call.
+//! @return Delay, in ms. UINT64_MAX if timer wheel is empty.
+uint64_t hvac::CovManager::NextExpiryDelay(uint64_t nowMs) const {
+	for (uint64_t i = 1; i <= WHEEL_SLOTS; ++i) {
+		if (!wheel[(wheelSec + i) % WHEEL_SLOTS].empty()) {
+			return (wheelSec + i) * 1000u - nowMs;
+		}
+	}
+	
+	return UINT64_MAX;
+}
+
+//! Helper function to send COV notification to subscriber.
+//! @param[in] sub Target subscription.
+//! @param[in] values Value list from \ref ReadValues().
+//! @param[in] nowSec Current CLOCK_MONOTONIC time, in seconds.
+void hvac::CovManager::Notify(const Subscription &sub, BACNET_PROPERTY_VALUE *values, uint64_t nowSec) {
+	BACNET_COV_DATA covData = {};
+	uint8_t apdu[MAX_APDU];
+	int apduLen;
+	
+	if (sub.expirySec && (sub.expirySec <= nowSec)) {				//not yet swept from timer wheel
+		return;
+	}
+	
+	covData.subscriberProcessIdentifier = sub.processId;
+	covData.initiatingDeviceIdentifier = sub.obj.devId;
+	covData.monitoredObjectIdentifier.type = sub.obj.objType;
+	covData.monitoredObjectIdentifier.instance = sub.obj.objId;
+	covData.timeRemaining = sub.expirySec ? (sub.expirySec - nowSec) : 0u;
+	covData.listOfValues = (sub.property == PROP_STATUS_FLAGS) ? &values[1] : values;
+	
+	uint8_t tsmId = 0;												//TSM slot to be freed if not sent
+	
+	if (sub.confirmed) {
+		uint8_t id;
+		
+		if (sub.obj.devId == Device_Object_Instance_Number()) {		//own device goes through TSM for retries
+			id = tsmId = tsm_next_free_invokeID();
+			if (!id) {
+				SPDLOG_DEBUG("No free invoke ID for COV notification.");
+				return;
+			}
+		}
+		else {
+			id = invokeId++;
+		}
+		
+		apduLen = ccov_notify_encode_apdu(apdu, sizeof(apdu), id, &covData);
+	}
+	else {
+		apduLen = ucov_notify_encode_apdu(apdu, sizeof(apdu), &covData);
+	}
+	
+	if (((apduLen <= 0) || !BacServer::SendApdu(sub.obj.devId, sub.subscriber, apdu, apduLen, sub.confirmed)) &&
+	tsmId) {
+		tsm_free_invoke_id(tsmId);
+	}
+}
+
+//! Helper function to remove subscription. Its timer wheel entries are left to go stale.
+//! @param[in] subId Subscription ID.
+void hvac::CovManager::RemoveSubscription(uint32_t subId) {
+	const auto &sub = subs.find(subId);
+	
+	if (sub == subs.end()) {
+		return;
+	}
+	
+	const auto &objPos = objSubs.find(sub->second.obj);
+	if (objPos != objSubs.end()) {
+		objPos->second.erase(std::remove(objPos->second.begin(), objPos->second.end(), subId),
+			objPos->second.end());
+		if (objPos->second.empty()) {
+			objSubs.erase(objPos);
+		}
+	}
+	
+	subs.erase(sub);
+	--subQt;
+}
@@ -0,0 +1,792 @@
+#include "main.h"
+#include "DevRouter.h"
+#include "ObjectTraits.h"
+
+#include <Commons.h>
+
+#include <bacnet/abort.h>
+#include <bacnet/bacapp.h>
+#include <bacnet/bacdcode.h>
+#include <bacnet/bacerror.h>
+#include <bacnet/bactext.h>
+#include <bacnet/basic/object/device.h>
+#include <bacnet/datalink/datalink.h>
+#include <bacnet/iam.h>
+#include <bacnet/reject.h>
+#include <bacnet/whois.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+//! MAC address length of virtual device, enough for 16M devices.
+constexpr static uint8_t VIRTUAL_MAC_LEN = 3u;
+//! Number_Of_States of virtual multi-state object, same as BACnet stack's multi-state objects.
+constexpr static uint32_t VIRTUAL_STATE_COUNT = 254u;
+//! Encoded object identifier size, in bytes.
+constexpr static int OBJECT_ID_ENCODED_LEN = 5;
+
+//! Constructor.
+//! @param[in] network Virtual network number, must be unique within BACnet internetwork.
+hvac::DevRouter::DevRouter(uint16_t network) : network(network) {}
+
+//! Adds virtual device, and indexes it for Who-Is lookup.
+//! @param[in] devId BACnet device instance ID. Must be lower than BACNET_MAX_INSTANCE.
+//! @param[in] devName BACnet device name.
+//! @return True if device is added successfully, false if device ID is invalid or already in use.
+bool hvac::DevRouter::AddDevice(uint32_t devId, const std::string &devName) {
+	std::unique_lock<decltype(guard)> lock(guard);
+	const auto &pos = std::lower_bound(devIndex.begin(), devIndex.end(), std::make_pair(devId, 0u));
+	
+	if ((devId >= BACNET_MAX_INSTANCE) || (devId == Device_Object_Instance_Number()) ||
+	((pos != devIndex.end()) && (pos->first == devId)) || (devices.size() >= (1u << (VIRTUAL_MAC_LEN * 8u)))) {
+		return false;
+	}
+	
+	devIndex.emplace(pos, devId, devices.size());
+	devices.push_back({devId, devName, {}, {}});
+	
+	return true;
+}
+
+//! Checks whether virtual device exists.
+//! @param[in] devId BACnet device instance ID.
+//! @return True if virtual device exists.
+bool hvac::DevRouter::HasDevice(uint32_t devId) const {
+	std::shared_lock<decltype(guard)> lock(guard);
+	
+	return FindDevice(devId);
+}
+
+//! Creates BACnet object in virtual device.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in] objType BACnet object type.
+//! @param[in] objId BACnet object instance ID. Must be lower than BACNET_MAX_INSTANCE.
+//! @return True if BACnet object already exists or is created successfully.
+bool hvac::DevRouter::CreateObject(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+	std::unique_lock<decltype(guard)> lock(guard);
+	Device *dev = FindDevice(devId);
+	bool result = true;
+	
+	if (!dev || (objId >= BACNET_MAX_INSTANCE)) {
+		result = false;
+	}
+	else {
+		const uint64_t key = ObjectKey(objType, objId);
+		
+		result = VisitObjectType(objType, [&](auto type) {
+			if (dev->objects.try_emplace(key, ObjectTraits<decltype(type)::value>::InitValue()).second) {
+				dev->objectList.insert(std::lower_bound(dev->objectList.begin(), dev->objectList.end(), key),
+					key);
+			}
+			return true;
+		});
+	}
+	
+	return result;
+}
+
+//! Creates BACnet objects in bulk. Target devices are looked up once, and their object tables are sized for
+//! the whole batch up front, so they aren't rehashed while growing.
+//! @param[in] objects BACnet objects to be created, in any order. Each must target virtual device.
+//! @return Count of objects that already exist or are created successfully.
+size_t hvac::DevRouter::CreateObjects(const std::vector<ObjectSpec> &objects) {
+	std::unique_lock<decltype(guard)> lock(guard);
+	std::vector<Device*> targets(objects.size(), nullptr);
+	std::unordered_map<Device*, size_t> counts;
+	size_t result = 0;
+	
+	for (size_t i = 0; i < objects.size(); ++i) {
+		Device *dev = FindDevice(objects[i].devId);
+		
+		if (dev && (objects[i].objId < BACNET_MAX_INSTANCE)) {
+			targets[i] = dev;
+			++counts[dev];
+		}
+	}
+	
+	for (const auto &count : counts) {
+		count.first->objects.reserve(count.first->objects.size() + count.second);
+		count.first->objectList.reserve(count.first->objectList.size() + count.second);
+	}
+	
+	for (size_t i = 0; i < objects.size(); ++i) {
+		const ObjectSpec &obj = objects[i];
+		const uint64_t key = ObjectKey(obj.objType, obj.objId);
+		
+		if (targets[i] && VisitObjectType(obj.objType, [&](auto type) {
+			if (targets[i]->objects.try_emplace(key, ObjectTraits<decltype(type)::value>::InitValue()).second) {
+				targets[i]->objectList.push_back(key);
+			}
+			return true;
+		})) {
+			++result;
+		}
+	}
+	
+	for (const auto &count : counts) {								//sorted once for whole batch
+		std::sort(count.first->objectList.begin(), count.first->objectList.end());
+	}
+	
+	return result;
+}
+
+//! Deletes BACnet object from virtual device.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in] objType Target BACnet object type.
+//! @param[in] objId Target BACnet object instance ID.
+//! @return True if target BACnet object doesn't exists or is deleted successfully.
+bool hvac::DevRouter::DeleteObject(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+	std::unique_lock<decltype(guard)> lock(guard);
+	Device *dev = FindDevice(devId);
+	
+	if (dev) {
+		const uint64_t key = ObjectKey(objType, objId);
+		
+		if (dev->objects.erase(key)) {
+			dev->objectList.erase(std::lower_bound(dev->objectList.begin(), dev->objectList.end(), key));
+		}
+	}
+	
+	return true;
+}
+
+//! Getter for BACnet object present value in virtual device.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in] objType Target BACnet object type.
+//! @param[in] objId Target BACnet object instance ID.
+//! @param[out] val Stored object value.
+//! @return True if target BACnet object exists.
+bool hvac::DevRouter::GetObjectValue(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId,
+ValueTypes &val) const {
+	std::shared_lock<decltype(guard)> lock(guard);
+	const Device *dev = FindDevice(devId);
+	bool result = false;
+	
+	if (dev) {
+		const auto &obj = dev->objects.find(ObjectKey(objType, objId));
+		
+		if (obj != dev->objects.end()) {
+			val = obj->second;
+			result = true;
+		}
+	}
+	
+	return result;
+}
+
+//! Setter for BACnet object present value in virtual device.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in] objType Target BACnet object type.
+//! @param[in] objId Target BACnet object instance ID.
+//! @param[in] val New object value. Its type must match stored object value type.
+//! @return True if target BACnet object exists and its value is set successfully.
+bool hvac::DevRouter::SetObjectValue(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId,
+const ValueTypes &val) {
+	std::unique_lock<decltype(guard)> lock(guard);
+	Device *dev = FindDevice(devId);
+	bool result = false;
+	
+	if (dev) {
+		const auto &obj = dev->objects.find(ObjectKey(objType, objId));
+		
+		if ((obj != dev->objects.end()) && (obj->second.index() == val.index())) {
+			obj->second = val;
+			result = true;
+		}
+	}
+	
+	return result;
+}
+
+//! Broadcasts I-Am-Router-To-Network for virtual network, so that clients know where to send routed requests.
+void hvac::DevRouter::AnnounceRouter() const {
+	uint8_t pdu[MAX_PDU];
+	BACNET_ADDRESS dest, src = {};
+	BACNET_NPDU_DATA npduData;
+	int pduLen;
+	
+	datalink_get_broadcast_address(&dest);
+	npdu_encode_npdu_network(&npduData, NETWORK_MESSAGE_I_AM_ROUTER_TO_NETWORK, false, MESSAGE_PRIORITY_NORMAL);
+	pduLen = npdu_encode_pdu(pdu, &dest, &src, &npduData);
+	pdu[pduLen++] = network >> 8u;
+	pdu[pduLen++] = network & 0xFFu;
+	
+	if (datalink_send_pdu(&dest, &npduData, pdu, pduLen) <= 0) {
+		SPDLOG_WARN("Error announcing route to virtual network '{}'.", network);
+	}
+}
+
+//! Handles NPDU that involves virtual network, before it's passed to BACnet stack for own device.
+//! @param[in] src Source address, as decoded by BVLC layer.
+//! @param[in] pdu Received NPDU.
+//! @param[in] pduLen NPDU length, in bytes.
+//! @return True if NPDU is meant for virtual network only, and shouldn't be passed to BACnet stack.
+bool hvac::DevRouter::HandleNpdu(const BACNET_ADDRESS &src, uint8_t *pdu, uint16_t pduLen) {
+	BACNET_ADDRESS dest = {}, reqSrc = src;
+	BACNET_NPDU_DATA npduData = {};
+	const int offset = npdu_decode(pdu, &dest, &reqSrc, &npduData);
+	
+	if ((offset <= 0) || (offset >= pduLen)) {
+		return false;
+	}
+	
+	if (npduData.network_layer_message) {
+		if ((npduData.network_message_type == NETWORK_MESSAGE_WHO_IS_ROUTER_TO_NETWORK) &&
+		(((pduLen - offset) < 2) || ((((uint16_t) pdu[offset] << 8u) | pdu[offset + 1]) == network))) {
+			AnnounceRouter();
+		}
+		
+		return false;
+	}
+	
+	uint8_t *apdu = pdu + offset;
+	const uint16_t apduLen = pduLen - offset;
+	const bool isBroadcast = !dest.net || (dest.net == BACNET_BROADCAST_NETWORK) ||
+		((dest.net == network) && !dest.len);
+	
+	if (isBroadcast) {
+		if ((apduLen >= 2) && (apdu[0] == PDU_TYPE_UNCONFIRMED_SERVICE_REQUEST) &&
+		(apdu[1] == SERVICE_UNCONFIRMED_WHO_IS)) {
+			HandleWhoIs(apdu + 2, apduLen - 2);
+		}
+	}
+	else if ((dest.net == network) && (dest.len == VIRTUAL_MAC_LEN)) {
+		const uint32_t devIdx = ((uint32_t) dest.adr[0] << 16u) | ((uint32_t) dest.adr[1] << 8u) | dest.adr[2];
+		
+		if ((apdu[0] & 0xF0u) == PDU_TYPE_CONFIRMED_SERVICE_REQUEST) {
+			HandleConfirmed(reqSrc, devIdx, apdu, apduLen);
+		}
+	}
+	
+	return dest.net == network;
+}
+
+//! Helper function to build object table key.
+//! @param[in] objType BACnet object type.
+//! @param[in] objId BACnet object instance ID.
+//! @return Object table key.
+uint64_t hvac::DevRouter::ObjectKey(BACNET_OBJECT_TYPE objType, uint32_t objId) {
+	return ((uint64_t) objType << 32u) | objId;
+}
+
+//! Helper function to find virtual device. Caller must hold \ref guard.
+//! @param[in] devId BACnet device instance ID.
+//! @return Virtual device, nullptr if not found.
+const hvac::DevRouter::Device* hvac::DevRouter::FindDevice(uint32_t devId) const {
+	const auto &pos = std::lower_bound(devIndex.begin(), devIndex.end(), std::make_pair(devId, 0u));
+	
+	return ((pos != devIndex.end()) && (pos->first == devId)) ? &devices[pos->second] : nullptr;
+}
+
+//! Helper function to find virtual device. Caller must hold \ref guard.
+//! @param[in] devId BACnet device instance ID.
+//! @return Virtual device, nullptr if not found.
+hvac::DevRouter::Device* hvac::DevRouter::FindDevice(uint32_t devId) {
+	return const_cast<Device*>(std::as_const(*this).FindDevice(devId));
+}
+
+//! Helper function to encode ReadProperty value of virtual device or its object. Caller must hold \ref guard.
+//! @param[in] dev Target virtual device.
+//! @param[in,out] rpData Decoded request. Error class/code is set if error has occurred.
+//! @param[out] apdu Encoding buffer.
+//! @return Encoded length, in bytes. Negative if error has occurred.
+int hvac::DevRouter::EncodeProperty(const Device &dev, BACNET_READ_PROPERTY_DATA &rpData, uint8_t *apdu) const {
+	BACNET_CHARACTER_STRING charStr;
+	BACNET_BIT_STRING bitStr;
+	int result = -1;
+	
+	rpData.error_class = ERROR_CLASS_PROPERTY;
+	rpData.error_code = ERROR_CODE_UNKNOWN_PROPERTY;
+	
+	if (rpData.object_type == OBJECT_DEVICE) {
+		if (rpData.object_instance != dev.id) {
+			rpData.error_class = ERROR_CLASS_OBJECT;
+			rpData.error_code = ERROR_CODE_UNKNOWN_OBJECT;
+			return result;
+		}
+		
+		switch (rpData.object_property) {
+		case PROP_OBJECT_IDENTIFIER:
+			result = encode_application_object_id(apdu, OBJECT_DEVICE, dev.id);
+			break;
+		case PROP_OBJECT_NAME:
+			characterstring_init_ansi(&charStr, dev.name.c_str());
+			result = encode_application_character_string(apdu, &charStr);
+			break;
+		case PROP_OBJECT_TYPE:
+			result = encode_application_enumerated(apdu, OBJECT_DEVICE);
+			break;
+		case PROP_SYSTEM_STATUS:
+			result = encode_application_enumerated(apdu, STATUS_OPERATIONAL);
+			break;
+		case PROP_VENDOR_IDENTIFIER:
+			result = encode_application_unsigned(apdu, Device_Vendor_Identifier());
+			break;
+		case PROP_OBJECT_LIST:
+			result = EncodeObjectList(dev, rpData, apdu);
+			break;
+		case PROP_PROTOCOL_SERVICES_SUPPORTED:
+			//as handled by HandleNpdu() and HandleConfirmed()
+			bitstring_init(&bitStr);
+			for (uint8_t idx = 0; idx < MAX_BACNET_SERVICES_SUPPORTED; ++idx) {
+				bitstring_set_bit(&bitStr, idx, false);
+			}
+			bitstring_set_bit(&bitStr, SERVICE_SUPPORTED_READ_PROPERTY, true);
+			bitstring_set_bit(&bitStr, SERVICE_SUPPORTED_READ_PROP_MULTIPLE, true);
+			bitstring_set_bit(&bitStr, SERVICE_SUPPORTED_WRITE_PROPERTY, true);
+			bitstring_set_bit(&bitStr, SERVICE_SUPPORTED_SUBSCRIBE_COV, true);
+			bitstring_set_bit(&bitStr, SERVICE_SUPPORTED_SUBSCRIBE_COV_PROPERTY, true);
+			bitstring_set_bit(&bitStr, SERVICE_SUPPORTED_WHO_IS, true);
+			bitstring_set_bit(&bitStr, SERVICE_SUPPORTED_I_AM, true);
+			result = encode_application_bitstring(apdu, &bitStr);
+			break;
+		case PROP_MAX_APDU_LENGTH_ACCEPTED:
+			result = encode_application_unsigned(apdu, MAX_APDU);
+			break;
+		case PROP_SEGMENTATION_SUPPORTED:
+			result = encode_application_enumerated(apdu, SEGMENTATION_NONE);
+			break;
+		case PROP_PROTOCOL_VERSION:
+			result = encode_application_unsigned(apdu, BACNET_PROTOCOL_VERSION);
+			break;
+		case PROP_PROTOCOL_REVISION:
+			result = encode_application_unsigned(apdu, BACNET_PROTOCOL_REVISION);
+			break;
+		default:
+			break;
+		}
+		
+		return result;
+	}
+	
+	const auto &obj = dev.objects.find(ObjectKey(rpData.object_type, rpData.object_instance));
+	if (obj == dev.objects.end()) {
+		rpData.error_class = ERROR_CLASS_OBJECT;
+		rpData.error_code = ERROR_CODE_UNKNOWN_OBJECT;
+		return result;
+	}
+	
+	switch (rpData.object_property) {
+	case PROP_OBJECT_IDENTIFIER:
+		result = encode_application_object_id(apdu, rpData.object_type, rpData.object_instance);
+		break;
+	case PROP_OBJECT_NAME:
+		characterstring_init_ansi(&charStr, (std::string(bactext_object_type_name(rpData.object_type)) + " " +
+			std::to_string(rpData.object_instance)).c_str());
+		result = encode_application_character_string(apdu, &charStr);
+		break;
+	case PROP_OBJECT_TYPE:
+		result = encode_application_enumerated(apdu, rpData.object_type);
+		break;
+	case PROP_PRESENT_VALUE:
+		if (std::holds_alternative<ValueWithPriority>(obj->second)) {
+			result = std::visit([apdu](const auto &val) { return EncodeValue(apdu, val); },
+				std::get<ValueWithPriority>(obj->second).value);
+		}
+		else if (!std::holds_alternative<std::string>(obj->second)) {
+			result = std::visit([apdu](const auto &val) { return EncodeValue(apdu, val); }, obj->second);
+		}
+		break;
+	case PROP_UNITS:
+		if ((rpData.object_type == OBJECT_ANALOG_INPUT) || (rpData.object_type == OBJECT_ANALOG_OUTPUT) ||
+		(rpData.object_type == OBJECT_ANALOG_VALUE)) {
+			result = encode_application_enumerated(apdu, UNITS_NO_UNITS);
+		}
+		break;
+	case PROP_STATUS_FLAGS:
+		bitstring_init(&bitStr);
+		bitstring_set_bit(&bitStr, STATUS_FLAG_IN_ALARM, false);
+		bitstring_set_bit(&bitStr, STATUS_FLAG_FAULT, false);
+		bitstring_set_bit(&bitStr, STATUS_FLAG_OVERRIDDEN, false);
+		bitstring_set_bit(&bitStr, STATUS_FLAG_OUT_OF_SERVICE, false);
+		result = encode_application_bitstring(apdu, &bitStr);
+		break;
+	case PROP_EVENT_STATE:
+		result = encode_application_enumerated(apdu, EVENT_STATE_NORMAL);
+		break;
+	case PROP_OUT_OF_SERVICE:
+		result = encode_application_boolean(apdu, false);
+		break;
+	case PROP_NUMBER_OF_STATES:
+		if ((rpData.object_type == OBJECT_MULTI_STATE_INPUT) ||
+		(rpData.object_type == OBJECT_MULTI_STATE_OUTPUT) || (rpData.object_type == OBJECT_MULTI_STATE_VALUE)) {
+			result = encode_application_unsigned(apdu, VIRTUAL_STATE_COUNT);
+		}
+		break;
+	default:
+		break;
+	}
+	
+	return result;
+}
+
+//! Helper function to encode Object_List of virtual device, device object first, then other objects ordered
+//! by type and instance, so array indices stay put while client walks list. Caller must hold \ref guard.
+//! @param[in] dev Target virtual device.
+//! @param[in,out] rpData Decoded request, with encoding buffer size. Error class/code is set if error has
+//! occurred.
+//! @param[out] apdu Encoding buffer.
+//! @return Encoded length, in bytes. Negative if error has occurred, \ref BACNET_STATUS_ABORT if list doesn't
+//! fit.
+int hvac::DevRouter::EncodeObjectList(const Device &dev, BACNET_READ_PROPERTY_DATA &rpData, uint8_t *apdu) {
+	const size_t count = dev.objectList.size() + 1u;
+	int result = -1;
+	
+	if (!rpData.array_index) {
+		result = encode_application_unsigned(apdu, count);
+	}
+	else if (rpData.array_index == BACNET_ARRAY_ALL) {
+		if ((count * OBJECT_ID_ENCODED_LEN) > (size_t) rpData.application_data_len) {
+			rpData.error_class = ERROR_CLASS_SERVICES;
+			rpData.error_code = ERROR_CODE_ABORT_SEGMENTATION_NOT_SUPPORTED;
+			return BACNET_STATUS_ABORT;
+		}
+		
+		result = encode_application_object_id(apdu, OBJECT_DEVICE, dev.id);
+		for (const uint64_t key : dev.objectList) {
+			result += encode_application_object_id(apdu + result, (BACNET_OBJECT_TYPE) (key >> 32u),
+				(uint32_t) key);
+		}
+	}
+	else if (rpData.array_index == 1u) {
+		result = encode_application_object_id(apdu, OBJECT_DEVICE, dev.id);
+	}
+	else if (rpData.array_index <= count) {
+		const uint64_t key = dev.objectList[rpData.array_index - 2u];
+		result = encode_application_object_id(apdu, (BACNET_OBJECT_TYPE) (key >> 32u), (uint32_t) key);
+	}
+	else {
+		rpData.error_class = ERROR_CLASS_PROPERTY;
+		rpData.error_code = ERROR_CODE_INVALID_ARRAY_INDEX;
+	}
+	
+	return result;
+}
+
+//! Helper function to encode present value as application data.
+//! @tparam T Stored value type.
+//! @param[out] apdu Encoding buffer.
+//! @param[in] val Stored value.
+//! @return Encoded length, in bytes. Negative if value type isn't present value type.
+template<class T> int hvac::DevRouter::EncodeValue(uint8_t *apdu, const T &val) {
+	if constexpr (std::is_same_v<T, bool>) {
+		return encode_application_enumerated(apdu, val ? BINARY_ACTIVE : BINARY_INACTIVE);
+	}
+	else if constexpr (std::is_same_v<T, BACNET_BINARY_PV>) {
+		return encode_application_enumerated(apdu, val);
+	}
+	else if constexpr (std::is_same_v<T, float>) {
+		return encode_application_real(apdu, val);
+	}
+	else if constexpr (std::is_same_v<T, uint32_t>) {
+		return encode_application_unsigned(apdu, val);
+	}
+	else {
+		return -1;
+	}
+}
+
+//! Helper function to handle confirmed service request routed to virtual device.
+//! @param[in] src Requester address.
+//! @param[in] devIdx Target device index (MAC) on virtual network.
+//! @param[in] apdu Received APDU.
+//! @param[in] apduLen APDU length, in bytes.
+void hvac::DevRouter::HandleConfirmed(const BACNET_ADDRESS &src, uint32_t devIdx, uint8_t *apdu,
+uint16_t apduLen) {
+	uint8_t resp[MAX_APDU];
+	int respLen = 0;
+	
+	if (apduLen < 4) {
+		return;
+	}
+	
+	const uint8_t invokeId = apdu[2];
+	const uint8_t service = apdu[3];
+	
+	if (apdu[0] & 0x08u) {											//segmented request
+		respLen = abort_encode_apdu(resp, invokeId, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
+	}
+	else if (service == SERVICE_CONFIRMED_READ_PROPERTY) {
+		BACNET_READ_PROPERTY_DATA rpData = {};
+		
+		if (rp_decode_service_request(apdu + 4, apduLen - 4, &rpData) <= 0) {
+			respLen = reject_encode_apdu(resp, invokeId, REJECT_REASON_MISSING_REQUIRED_PARAMETER);
+		}
+		else {
+			std::shared_lock<decltype(guard)> lock(guard);
+			int valueLen = -1;
+			
+			respLen = rp_ack_encode_apdu_init(resp, invokeId, &rpData);
+			rpData.application_data = resp + respLen;
+			rpData.application_data_len = sizeof(resp) - respLen - 1;		//room for closing tag
+			if (devIdx < devices.size()) {
+				valueLen = EncodeProperty(devices[devIdx], rpData, resp + respLen);
+			}
+			else {
+				rpData.error_class = ERROR_CLASS_OBJECT;
+				rpData.error_code = ERROR_CODE_UNKNOWN_OBJECT;
+			}
+			
+			if (valueLen == BACNET_STATUS_ABORT) {
+				respLen = abort_encode_apdu(resp, invokeId, ABORT_REASON_SEGMENTATION_NOT_SUPPORTED, true);
+			}
+			else if (valueLen < 0) {
+				respLen = bacerror_encode_apdu(resp, invokeId, SERVICE_CONFIRMED_READ_PROPERTY,
+					rpData.error_class, rpData.error_code);
+			}
+			else {
+				respLen += valueLen;
+				respLen += rp_ack_encode_apdu_object_property_end(resp + respLen);
+			}
+		}
+	}
+	else if (service == SERVICE_CONFIRMED_WRITE_PROPERTY) {
+		BACNET_WRITE_PROPERTY_DATA wpData = {};
+		bool isValid = false;
+		uint32_t devId = 0;
+		
+		if (wp_decode_service_request(apdu + 4, apduLen - 4, &wpData) <= 0) {
+			respLen = reject_encode_apdu(resp, invokeId, REJECT_REASON_MISSING_REQUIRED_PARAMETER);
+		}
+		else {
+			{
+				std::shared_lock<decltype(guard)> lock(guard);
+				
+				if (devIdx < devices.size()) {
+					devId = devices[devIdx].id;
+					isValid = true;
+				}
+			}
+			
+			if (isValid && HandleWriteProperty(devId, wpData)) {
+				respLen = encode_simple_ack(resp, invokeId, SERVICE_CONFIRMED_WRITE_PROPERTY);
+			}
+			else {
+				if (!isValid) {
+					wpData.error_class = ERROR_CLASS_OBJECT;
+					wpData.error_code = ERROR_CODE_UNKNOWN_OBJECT;
+				}
+				
+				respLen = bacerror_encode_apdu(resp, invokeId, SERVICE_CONFIRMED_WRITE_PROPERTY,
+					wpData.error_class, wpData.error_code);
+			}
+		}
+	}
+	else if (service == SERVICE_CONFIRMED_READ_PROP_MULTIPLE) {
+		bool isValid = false;
+		uint32_t devId = 0;
+		
+		{
+			std::shared_lock<decltype(guard)> lock(guard);
+			
+			if (devIdx < devices.size()) {
+				devId = devices[devIdx].id;
+				isValid = true;
+			}
+		}
+		
+		if (isValid) {
+			respLen = BacServer::ReadPropertyMultiple(devId, invokeId, apdu + 4, apduLen - 4, resp,
+				std::min<unsigned>(decode_max_apdu(apdu[1] & 0x0Fu), sizeof(resp)),
+				[this, devIdx](BACNET_READ_PROPERTY_DATA &rpData, uint8_t *value) {
+					std::shared_lock<decltype(guard)> lock(guard);
+					
+					if (devIdx < devices.size()) {
+						return EncodeProperty(devices[devIdx], rpData, value);
+					}
+					
+					rpData.error_class = ERROR_CLASS_OBJECT;
+					rpData.error_code = ERROR_CODE_UNKNOWN_OBJECT;
+					return -1;
+				});
+			if (respLen < 0) {										//property groups are not supported
+				respLen = bacerror_encode_apdu(resp, invokeId, SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
+					ERROR_CLASS_SERVICES, ERROR_CODE_OPTIONAL_FUNCTIONALITY_NOT_SUPPORTED);
+			}
+		}
+		else {
+			respLen = bacerror_encode_apdu(resp, invokeId, SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
+				ERROR_CLASS_OBJECT, ERROR_CODE_UNKNOWN_OBJECT);
+		}
+	}
+	else if ((service == SERVICE_CONFIRMED_SUBSCRIBE_COV) ||
+	(service == SERVICE_CONFIRMED_SUBSCRIBE_COV_PROPERTY)) {
+		bool isValid = false;
+		uint32_t devId = 0;
+		
+		{
+			std::shared_lock<decltype(guard)> lock(guard);
+			
+			if (devIdx < devices.size()) {
+				devId = devices[devIdx].id;
+				isValid = true;
+			}
+		}
+		
+		if (isValid) {												//no lock held here, COV reads object value
+			respLen = BacServer::SubscribeCov(devId, src, invokeId, service, apdu + 4, apduLen - 4, resp);
+		}
+		else {
+			respLen = bacerror_encode_apdu(resp, invokeId, (BACNET_CONFIRMED_SERVICE) service,
+				ERROR_CLASS_OBJECT, ERROR_CODE_UNKNOWN_OBJECT);
+		}
+	}
+	else {
+		respLen = reject_encode_apdu(resp, invokeId, REJECT_REASON_UNRECOGNIZED_SERVICE);
+	}
+	
+	if (respLen > 0) {
+		Send(src, devIdx, resp, respLen, false);
+	}
+}
+
+//! Helper function to answer Who-Is with I-Am of every virtual device in requested range.
+//! @param[in] apdu Who-Is service request, after service choice.
+//! @param[in] apduLen Service request length, in bytes.
+void hvac::DevRouter::HandleWhoIs(uint8_t *apdu, uint16_t apduLen) const {
+	int32_t lowLimit = 0, highLimit = BACNET_MAX_INSTANCE;
+	BACNET_ADDRESS dest;
+	uint8_t iAm[MAX_APDU];
+	
+	if (apduLen && (whois_decode_service_request(apdu, apduLen, &lowLimit, &highLimit) <= 0)) {
+		return;
+	}
+	if (lowLimit < 0) {												//no range means all devices
+		lowLimit = 0;
+		highLimit = BACNET_MAX_INSTANCE;
+	}
+	
+	datalink_get_broadcast_address(&dest);
+	
+	std::shared_lock<decltype(guard)> lock(guard);
+	auto pos = std::lower_bound(devIndex.begin(), devIndex.end(), std::make_pair((uint32_t) lowLimit, 0u));
+	
+	for (; (pos != devIndex.end()) && (pos->first <= (uint32_t) highLimit); ++pos) {
+		const int iAmLen = iam_encode_apdu(iAm, pos->first, MAX_APDU, SEGMENTATION_NONE,
+			Device_Vendor_Identifier());
+		
+		Send(dest, pos->second, iAm, iAmLen, false);
+	}
+}
+
+//! Helper function to handle WriteProperty to virtual device object. Value change goes through device manager
+//! bridge first, same as BACnet stack objects.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in,out] wpData Decoded request. Error class/code is set if error has occurred.
+//! @return True if value is written successfully.
+bool hvac::DevRouter::HandleWriteProperty(uint32_t devId, BACNET_WRITE_PROPERTY_DATA &wpData) {
+	BACNET_APPLICATION_DATA_VALUE appVal = {};
+	
+	wpData.error_class = ERROR_CLASS_PROPERTY;
+	wpData.error_code = ERROR_CODE_WRITE_ACCESS_DENIED;
+	
+	if (wpData.object_property != PROP_PRESENT_VALUE) {
+		return false;
+	}
+	
+	if (bacapp_decode_application_data(wpData.application_data, wpData.application_data_len, &appVal) <= 0) {
+		wpData.error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+		return false;
+	}
+	
+	return VisitObjectType(wpData.object_type, [&](auto type) {
+		typedef ObjectTraits<decltype(type)::value> Traits;
+		
+		if constexpr (!Traits::IS_WRITABLE) {
+			return false;
+		}
+		else {
+			typename Traits::PvType pv;
+			typename Traits::SetType val;
+			
+			if constexpr (std::is_same_v<typename Traits::PvType, BACNET_BINARY_PV>) {
+				if ((appVal.tag != Traits::PV_TAG) || (appVal.type.Enumerated > BINARY_ACTIVE)) {
+					wpData.error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+					return false;
+				}
+				pv = (BACNET_BINARY_PV) appVal.type.Enumerated;
+			}
+			else if constexpr (std::is_same_v<typename Traits::PvType, float>) {
+				if (appVal.tag != Traits::PV_TAG) {
+					wpData.error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+					return false;
+				}
+				pv = appVal.type.Real;
+			}
+			else {
+				if ((appVal.tag != Traits::PV_TAG) || !appVal.type.Unsigned_Int ||
+				(appVal.type.Unsigned_Int > VIRTUAL_STATE_COUNT)) {
+					wpData.error_code = ERROR_CODE_VALUE_OUT_OF_RANGE;
+					return false;
+				}
+				pv = appVal.type.Unsigned_Int;
+			}
+			
+			if constexpr (std::is_same_v<typename Traits::SetType, ValueWithPriority>) {
+				val = ValueWithPriority(Traits::ToValue(pv));
+				val.priority = (wpData.priority == BACNET_NO_PRIORITY) ? BACNET_MAX_PRIORITY : wpData.priority;
+			}
+			else {
+				val = Traits::ToValue(pv);
+			}
+			
+			//no lock held here, device manager may call back into BacServer
+			return BacServer::SetObjectValueBS<decltype(type)::value>(devId, wpData.object_instance, val,
+				wpData.error_class, wpData.error_code) && SetObjectValue(devId, wpData.object_type,
+				wpData.object_instance, ValueTypes(val));
+		}
+	});
+}
+
+//! Sends APDU from virtual device, e.g. COV notification.
+//! @param[in] devId Source BACnet device instance ID.
+//! @param[in] dest Destination address.
+//! @param[in] apdu APDU to be sent.
+//! @param[in] apduLen APDU length, in bytes.
+//! @param[in] expectReply True if APDU is confirmed request.
+//! @return True if APDU is sent successfully.
+bool hvac::DevRouter::SendFrom(uint32_t devId, const BACNET_ADDRESS &dest, const uint8_t *apdu,
+unsigned apduLen, bool expectReply) const {
+	std::shared_lock<decltype(guard)> lock(guard);
+	const auto &pos = std::lower_bound(devIndex.begin(), devIndex.end(), std::make_pair(devId, 0u));
+	
+	return (pos != devIndex.end()) && (pos->first == devId) && Send(dest, pos->second, apdu, apduLen,
+		expectReply);
+}
+
+//! Helper function to send APDU from virtual device.
+//! @param[in] dest Destination address.
+//! @param[in] devIdx Source device index (MAC) on virtual network.
+//! @param[in] apdu APDU to be sent.
+//! @param[in] apduLen APDU length, in bytes.
+//! @param[in] expectReply True if APDU is confirmed request.
+//! @return True if APDU is sent successfully.
+bool hvac::DevRouter::Send(const BACNET_ADDRESS &dest, uint32_t devIdx, const uint8_t *apdu,
+unsigned apduLen, bool expectReply) const {
+	uint8_t pdu[MAX_PDU];
+	BACNET_ADDRESS sendDest = dest, src = {};
+	BACNET_NPDU_DATA npduData;
+	
+	src.net = network;
+	src.len = VIRTUAL_MAC_LEN;
+	src.adr[0] = (devIdx >> 16u) & 0xFFu;
+	src.adr[1] = (devIdx >> 8u) & 0xFFu;
+	src.adr[2] = devIdx & 0xFFu;
+	
+	npdu_encode_npdu_data(&npduData, expectReply, MESSAGE_PRIORITY_NORMAL);
+	const int pduLen = npdu_encode_pdu(pdu, &sendDest, &src, &npduData);
+	
+	if ((pduLen + apduLen) > sizeof(pdu)) {
+		SPDLOG_WARN("Virtual device APDU of {} bytes is too big.", apduLen);
+		return false;
+	}
+	
+	memcpy(pdu + pduLen, apdu, apduLen);
+	if (datalink_send_pdu(&sendDest, &npduData, pdu, pduLen + apduLen) <= 0) {
+		SPDLOG_DEBUG("Error sending virtual device APDU.");
+		return false;
+	}
+	
+	return true;
+}
@@ -0,0 +1,229 @@
+#include "main.h"
+#include "RpmCache.h"
+
+#include <Commons.h>
+
+#include <bacnet/rpm.h>
+
+#include <algorithm>
+#include <cstring>
+
+//! Fragments cached per object, for different property lists requested by different clients.
+constexpr static size_t RPM_CACHE_VARIANTS = 4u;
+//! Worst case encoded size of RPM result per property, excluding property value, in bytes.
+constexpr static unsigned RPM_PROPERTY_OVERHEAD = 16u;
+
+//! Constructor.
+hvac::RpmCache::RpmCache() : generation(0) {}
+
+//! Encodes ReadPropertyMultiple-ACK, with object results served from cache where possible. Request is left to
+//! caller if it asks for ALL, REQUIRED or OPTIONAL property groups, or if response doesn't fit.
+//! @param[in] devId Target BACnet device instance ID.
+//! @param[in] invokeId Request invoke ID.
+//! @param[in] req Service request, after service choice.
+//! @param[in] reqLen Service request length, in bytes.
+//! @param[out] resp Response APDU buffer.
+//! @param[in] respSz Response size limit, in bytes.
+//! @param[in] readProp Property encoder of target device, for cache miss. Called without lock held.
+//! @return Response APDU length, in bytes. Negative if request isn't handled.
+int hvac::RpmCache::Encode(uint32_t devId, uint8_t invokeId, uint8_t *req, uint16_t reqLen, uint8_t *resp,
+unsigned respSz, const ReadFunc &readProp) {
+	std::vector<std::pair<BACNET_PROPERTY_ID, uint32_t>> props;
+	BACNET_RPM_DATA rpmData = {};
+	uint8_t frag[MAX_APDU];
+	unsigned offset = 0;
+	int respLen = rpm_ack_encode_apdu_init(resp, invokeId);
+	
+	while (offset < reqLen) {
+		int len = rpm_decode_object_id(req + offset, reqLen - offset, &rpmData);
+		if (len <= 0) {
+			return -1;
+		}
+		offset += len;
+		
+		const unsigned specOffset = offset;
+		props.clear();
+		
+		while (true) {
+			if (offset >= reqLen) {
+				return -1;
+			}
+			
+			if (rpm_decode_object_end(req + offset, reqLen - offset)) {
+				++offset;
+				break;
+			}
+			
+			len = rpm_decode_object_property(req + offset, reqLen - offset, &rpmData);
+			if ((len <= 0) || (rpmData.object_property == PROP_ALL) ||
+			(rpmData.object_property == PROP_REQUIRED) || (rpmData.object_property == PROP_OPTIONAL)) {
+				return -1;
+			}
+			offset += len;
+			
+			props.emplace_back(rpmData.object_property, rpmData.array_index);
+		}
+		
+		const uint8_t *spec = req + specOffset;
+		const size_t specLen = offset - specOffset;
+		const uint64_t key = ObjectKey(devId, rpmData.object_type, rpmData.object_instance);
+		const bool isCacheable = IsCacheable(rpmData.object_type, props);
+		int fragLen = -1;
+		uint64_t gen = 0;
+		
+		if (isCacheable) {
+			std::lock_guard<decltype(guard)> lock(guard);
+			const auto &pos = entries.find(key);
+			
+			gen = generation;
+			if (pos != entries.end()) {
+				for (const Fragment &cached : pos->second.fragments) {
+					if ((cached.spec.size() == specLen) && !memcmp(cached.spec.data(), spec, specLen)) {
+						if ((respLen + cached.data.size()) > respSz) {
+							return -1;
+						}
+						
+						memcpy(resp + respLen, cached.data.data(), cached.data.size());
+						fragLen = cached.data.size();
+						break;
+					}
+				}
+			}
+		}
+		
+		if (fragLen < 0) {
+			bool hasError = false;
+			
+			fragLen = EncodeObject(rpmData.object_type, rpmData.object_instance, props, frag, sizeof(frag),
+				readProp, hasError);
+			if ((fragLen < 0) || ((respLen + fragLen) > (int) respSz)) {
+				return -1;
+			}
+			
+			memcpy(resp + respLen, frag, fragLen);
+			
+			//error result (e.g. unknown object) isn't cached, nor is result of object changed while encoding
+			if (isCacheable && !hasError) {
+				std::lock_guard<decltype(guard)> lock(guard);
+				
+				if (generation == gen) {
+					Entry &entry = entries[key];
+					Fragment fragment = {{spec, spec + specLen}, {frag, frag + fragLen}};
+					
+					if (entry.fragments.size() < RPM_CACHE_VARIANTS) {
+						entry.fragments.push_back(std::move(fragment));
+					}
+					else {
+						entry.fragments[entry.nextSlot] = std::move(fragment);
+						entry.nextSlot = (entry.nextSlot + 1u) % RPM_CACHE_VARIANTS;
+					}
+				}
+			}
+		}
+		
+		respLen += fragLen;
+	}
+	
+	return respLen;
+}
+
+//! Drops cached results of object, e.g. after value change or deletion. Thread-safe.
+//! @param[in] devId BACnet device instance ID.
+//! @param[in] objType BACnet object type.
+//! @param[in] objId BACnet object instance ID.
+void hvac::RpmCache::Invalidate(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+	std::lock_guard<decltype(guard)> lock(guard);
+	
+	++generation;
+	entries.erase(ObjectKey(devId, objType, objId));
+}
+
+//! Drops cached results of all objects, e.g. after bulk object table change. Thread-safe.
+void hvac::RpmCache::InvalidateAll() {
+	std::lock_guard<decltype(guard)> lock(guard);
+	
+	++generation;
+	entries.clear();
+}
+
+//! Drops cached results of all objects of device, e.g. after property write handled by BACnet stack.
+//! Thread-safe.
+//! @param[in] devId BACnet device instance ID.
+void hvac::RpmCache::InvalidateDevice(uint32_t devId) {
+	std::lock_guard<decltype(guard)> lock(guard);
+	
+	++generation;
+	std::erase_if(entries, [devId](const auto &entry) { return (entry.first >> 32u) == devId; });
+}
+
+//! Helper function to check if object result can be cached.
+//! @param[in] objType BACnet object type.
+//! @param[in] props Requested properties, with array index.
+//! @return True if object isn't device object, and only present value and status flags are requested.
+bool hvac::RpmCache::IsCacheable(BACNET_OBJECT_TYPE objType,
+const std::vector<std::pair<BACNET_PROPERTY_ID, uint32_t>> &props) {
+	return (objType != OBJECT_DEVICE) && std::all_of(props.begin(), props.end(), [](const auto &prop) {
+		return (prop.first == PROP_PRESENT_VALUE) || (prop.first == PROP_STATUS_FLAGS);
+	});
+}
+
+//! Helper function to build cache key.
+//! @param[in] devId BACnet device instance ID.
+//! @param[in] objType BACnet object type.
+//! @param[in] objId BACnet object instance ID.
+//! @return Cache key, unique as instance IDs take 22 bits and object type 10 bits.
+uint64_t hvac::RpmCache::ObjectKey(uint32_t devId, BACNET_OBJECT_TYPE objType, uint32_t objId) {
+	return ((uint64_t) devId << 32u) | ((uint64_t) objType << 22u) | objId;
+}
+
+//! Helper function to encode result of single object.
+//! @param[in] objType Target BACnet object type.
+//! @param[in] objId Target BACnet object instance ID.
+//! @param[in] props Requested properties, with array index.
+//! @param[out] frag Encoding buffer.
+//! @param[in] fragSz Encoding buffer size, in bytes.
+//! @param[in] readProp Property encoder of target device.
+//! @param[out] hasError Set if any property is encoded as error.
+//! @return Encoded length, in bytes. Negative if result doesn't fit.
+int hvac::RpmCache::EncodeObject(BACNET_OBJECT_TYPE objType, uint32_t objId,
+const std::vector<std::pair<BACNET_PROPERTY_ID, uint32_t>> &props, uint8_t *frag, unsigned fragSz,
+const ReadFunc &readProp, bool &hasError) const {
+	BACNET_RPM_DATA rpmData = {};
+	uint8_t value[MAX_APDU];
+	
+	rpmData.object_type = objType;
+	rpmData.object_instance = objId;
+	int len = rpm_ack_encode_apdu_object_begin(frag, &rpmData);
+	
+	for (const auto &prop : props) {
+		BACNET_READ_PROPERTY_DATA rpData = {};
+		
+		rpData.object_type = objType;
+		rpData.object_instance = objId;
+		rpData.object_property = prop.first;
+		rpData.array_index = prop.second;
+		rpData.application_data = value;
+		rpData.application_data_len = sizeof(value);
+		
+		const int valueLen = readProp(rpData, value);
+		if ((len + std::max(valueLen, 0) + RPM_PROPERTY_OVERHEAD) > fragSz) {
+			return -1;
+		}
+		
+		len += rpm_ack_encode_apdu_object_property(frag + len, prop.first, prop.second);
+		if (valueLen >= 0) {
+			len += rpm_ack_encode_apdu_object_property_value(frag + len, value, valueLen);
+		}
+		else {
+			len += rpm_ack_encode_apdu_object_property_error(frag + len, rpData.error_class, rpData.error_code);
+			hasError = true;
+		}
+	}
+	
+	if ((len + RPM_PROPERTY_OVERHEAD) > fragSz) {
+		return -1;
+	}
+	len += rpm_ack_encode_apdu_object_end(frag + len);
+	
+	return len;
+}
@@ -4,15 +4,183 @@
 
 #include <Commons.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
-#include <filesystem>
-#include <fstream>
 #include <mutex>
 #include <stdexcept>
+#include <string>
 #include <thread>
 
-struct ClientData {};
+//! WebSocket topic for broadcast, to every client.
+constexpr static std::string_view WS_TOPIC_ALL = "all";
+//! WebSocket topic every client subscribes to, for keep-alive ping.
+constexpr static std::string_view WS_TOPIC_PING = "ping";
+//! Period of connector value delta updates to subscribed clients, in ms.
+constexpr static int WS_DELTA_TICK_MS = 200;
+
+//! WebSocket client state, accessed on server loop thread only.
+struct ClientData {
+	std::unordered_set<std::string> connectors;						//!< Subscribed connectors.
+};
+
+//! Encoded size of REST API response written per socket write, in bytes.
+constexpr static size_t API_CHUNK_SZ = 64u * 1024u;
+
+//! Encodings of REST API request and response body.
+enum class ApiFormat {
+	JSON,
+	CBOR,
+	MSGPACK
+};
+
+//! REST API request in progress, shared by uWebSockets callbacks of single request.
+struct ApiTransfer {
+	std::string body;												//!< Request body, as received so far.
+	nlohmann::json resp;
+	std::string chunk;												//!< Response chunk being written.
+	size_t next = 0;												//!< Next response element to be encoded.
+	ApiFormat format = ApiFormat::JSON;								//!< Response encoding.
+	bool isAborted = false;
+};
+
+//! Helper function to pick REST API body encoding.
+//! @param[in] mediaTypes Accept or Content-Type header.
+//! @return Encoding of first supported media type listed, JSON if none.
+static ApiFormat ParseApiFormat(std::string_view mediaTypes) {
+	const size_t jsonPos = mediaTypes.find("application/json");
+	const size_t cborPos = mediaTypes.find("application/cbor");
+	const size_t msgpackPos = std::min(mediaTypes.find("application/msgpack"),
+		mediaTypes.find("application/x-msgpack"));
+	ApiFormat result = ApiFormat::JSON;
+	
+	if (cborPos < std::min(jsonPos, msgpackPos)) {
+		result = ApiFormat::CBOR;
+	}
+	else if (msgpackPos < std::min(jsonPos, cborPos)) {
+		result = ApiFormat::MSGPACK;
+	}
+	
+	return result;
+}
+
+//! Helper function to get media type of REST API body encoding.
+//! @param[in] format Body encoding.
+//! @return Content-Type header.
+static std::string_view ApiMediaType(ApiFormat format) {
+	std::string_view result;
+	
+	switch (format) {
+	case ApiFormat::CBOR:
+		result = "application/cbor";
+		break;
+	case ApiFormat::MSGPACK:
+		result = "application/msgpack";
+		break;
+	default:
+		result = "application/json";
+		break;
+	}
+	
+	return result;
+}
+
+//! Helper function to append JSON value in REST API body encoding. JSON is written compact, without
+//! indentation.
+//! @param[in] val Value to be encoded.
+//! @param[in] format Body encoding.
+//! @param[out] out Encoded value is appended here.
+static void EncodeApiValue(const nlohmann::json &val, ApiFormat format, std::string &out) {
+	switch (format) {
+	case ApiFormat::CBOR:
+		nlohmann::json::to_cbor(val, out);
+		break;
+	case ApiFormat::MSGPACK:
+		nlohmann::json::to_msgpack(val, out);
+		break;
+	default:
+		out += val.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+		break;
+	}
+	
+	return;
+}
+
+//! Helper function to write REST API response array chunk by chunk, as socket drains, so response is never
+//! held whole in socket buffer. Elements are encoded on demand, and array is framed per encoding (CBOR as
+//! indefinite length array).
+//! @tparam Res HTTP response type.
+//! @param[in] res HTTP response, with headers written.
+//! @param[in] xfer Request in progress, with array response.
+//! @return True if response is completed (or aborted), false if waiting for socket to drain.
+template<class Res> static bool WriteApiStream(Res *res, ApiTransfer &xfer) {
+	while (!xfer.isAborted) {
+		xfer.chunk.clear();
+		
+		if (xfer.next == 0) {										//array start
+			const uint32_t size = xfer.resp.size();
+			
+			switch (xfer.format) {
+			case ApiFormat::CBOR:
+				xfer.chunk += '\x9f';
+				break;
+			case ApiFormat::MSGPACK:
+				if (size < 16u) {
+					xfer.chunk += (char) (0x90u | size);
+				}
+				else if (size <= UINT16_MAX) {
+					xfer.chunk += {'\xdc', (char) (size >> 8u), (char) size};
+				}
+				else {
+					xfer.chunk += {'\xdd', (char) (size >> 24u), (char) (size >> 16u), (char) (size >> 8u),
+						(char) size};
+				}
+				break;
+			default:
+				xfer.chunk += '[';
+				break;
+			}
+		}
+		
+		while ((xfer.chunk.size() < API_CHUNK_SZ) && (xfer.next < xfer.resp.size())) {
+			if ((xfer.format == ApiFormat::JSON) && (xfer.next > 0)) {
+				xfer.chunk += ',';
+			}
+			EncodeApiValue(xfer.resp[xfer.next++], xfer.format, xfer.chunk);
+		}
+		
+		if (xfer.next >= xfer.resp.size()) {						//array end
+			if (xfer.format == ApiFormat::CBOR) {
+				xfer.chunk += '\xff';
+			}
+			else if (xfer.format == ApiFormat::JSON) {
+				xfer.chunk += ']';
+			}
+			
+			res->end(xfer.chunk);
+			break;
+		}
+		
+		if (!res->write(xfer.chunk)) {								//chunk is buffered, wait for drain
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+//! Helper function to read all connector values through REST API handler.
+//! @param[out] values Connector name to value object.
+//! @return True if connector values are read successfully.
+static bool ReadConnectorValues(nlohmann::json &values) {
+	nlohmann::json resp;
+	
+	return hvac::DevManager::RestApiHandler(R"([{
+		"connector_value": {},
+		"type": "read"
+	}])", resp) && Private::RestExtractResponse(resp, "connector_value", "read", 200,
+		nlohmann::json::value_t::object, values);
+}
 
 //! Initializes WebSocket/REST API server (as singleton object).
 //! @param[in] config Configuration object.
@@ -62,34 +230,45 @@ bool hvac::WebServer::Stop() {
 		result = false;
 	}
 	else {
+		{															//checked by loop thread before it runs
+			std::lock_guard<decltype(server->loopGuard)> lock(server->loopGuard);
+			server->stop = true;
+		}
+		
 		if (server->thdPing.joinable()) {
 			SPDLOG_INFO("Web server stopping client pinger.");
-			server->stop = true;
 			server->thdPing.join();
 		}
 		
 		if (server->thdMain.joinable()) {
-			{
-				std::lock_guard<decltype(wsSocksGuard)> lock(server->wsSocksGuard);
+			const bool isDeferred = server->Defer([]() {
+				if (server->deltaTimer) {
+					us_timer_close(server->deltaTimer);
+					server->deltaTimer = nullptr;
+				}
 				
 				if (!server->wsSocks.empty()) {
 					SPDLOG_INFO("Web server closing still connected socket.");
 					
-					for (auto wsSock : server->wsSocks) {
+					for (auto wsSock : std::unordered_set<void*>(server->wsSocks)) {	//end() erases from set
 						if (server->useSsl) {
-							((uWS::WebSocket<true, true>*) wsSock)->end();
+							((uWS::WebSocket<true, true, ClientData>*) wsSock)->end();
 						}
 						else {
-							((uWS::WebSocket<false, true>*) wsSock)->end();
+							((uWS::WebSocket<false, true, ClientData>*) wsSock)->end();
 						}
 					}
 				}
-			}
+				
+				if (server->token) {
+					SPDLOG_INFO("Web server closing listening socket.");
+					us_listen_socket_close(server->useSsl, server->token);
+					server->token = nullptr;
+				}
+			});
 			
-			if (server->token) {
-				SPDLOG_INFO("Web server closing listening socket.");
-				us_listen_socket_close(server->useSsl, server->token);
-				server->token = nullptr;
+			if (!isDeferred) {
+				SPDLOG_DEBUG("Web server loop not running, waiting for it to exit.");
 			}
 			
 			server->thdMain.join();
@@ -99,10 +278,11 @@ bool hvac::WebServer::Stop() {
 	return result;
 }
 
-//! Sends message to all clients connected to server.
+//! Sends message to all clients connected to server. Thread-safe, as message is handed over to server loop and
+//! published to topic, so it's compressed once regardless of client count.
 //! @param[in] msg Message to be sent.
 //! @param[in] opcode WebSocket protocol transaction opcode.
-//! @return False if server not initialized.
+//! @return False if server not initialized or not running.
 bool hvac::WebServer::SendMessage(std::string_view msg, uWS::OpCode opcode) {
 	bool result = true;
 	
@@ -111,20 +291,29 @@ bool hvac::WebServer::SendMessage(std::string_view msg, uWS::OpCode opcode) {
 		result = false;
 	}
 	else {
-		std::lock_guard<decltype(wsSocksGuard)> lock(server->wsSocksGuard);
-		
-		if (!server->wsSocks.empty()) {
-			for (auto wsSock : server->wsSocks) {
-				if (server->useSsl) {
-					if (!((uWS::WebSocket<true, true>*) wsSock)->send(msg, opcode, true)) {
-						SPDLOG_WARN("Failed sending WebSocket message '{}'.", msg);
-					}
-				}
-				else if (!((uWS::WebSocket<false, true>*) wsSock)->send(msg, opcode, true)) {
-					SPDLOG_WARN("Failed sending WebSocket message '{}'.", msg);
-				}
-			}
-		}
+		result = server->Publish(WS_TOPIC_ALL, msg, opcode);
+	}
+	
+	return result;
+}
+
+//! Queues connector value change for clients subscribed to connector, which are sent all changes since last
+//! tick in single message. Thread-safe. Only latest value is sent if connector changes several times per tick.
+//! Connector values are polled every tick as well while any client has subscription, so value producer
+//! (e.g. device manager) needn't call it, but pushed value takes precedence over polled one.
+//! @param[in] connector Connector name.
+//! @param[in] value New connector value.
+//! @return False if server not initialized.
+bool hvac::WebServer::UpdateValue(std::string_view connector, const nlohmann::json &value) {
+	bool result = true;
+	
+	if (!server) {
+		SPDLOG_ERROR("Web server not initialized yet.");
+		result = false;
+	}
+	else if (server->deltaClients) {
+		std::lock_guard<decltype(pendingGuard)> lock(server->pendingGuard);
+		server->pendingValues.insert_or_assign(std::string(connector), value);
 	}
 	
 	return result;
@@ -134,6 +323,7 @@ bool hvac::WebServer::SendMessage(std::string_view msg, uWS::OpCode opcode) {
 //! @param config Configuration object.
 //! @throw invalid_argument If configuration JSON type is not object.
 //!							If SSL is enabled but related configuration is invalid.
+//! @throw runtime_error If error creating website file cache.
 hvac::WebServer::WebServer(const nlohmann::json &config) {
 	if (!config.is_object()) {
 		throw std::invalid_argument("Invalid configuration JSON type.");
@@ -172,6 +362,7 @@ hvac::WebServer::WebServer(const nlohmann::json &config) {
 		
 		if (testPath) {
 			wwwPath = testPath.get();
+			wwwCache.reset(new WwwCache(wwwPath));
 		}
 		else {
 			throw std::invalid_argument("'www_root' configuration error: " +
@@ -179,6 +370,13 @@ hvac::WebServer::WebServer(const nlohmann::json &config) {
 		}
 	}
 	
+	if (!Private::JsonExtract(config, "ws_full_snapshot", nlohmann::json::value_t::boolean, jsonVal)) {
+		fullSnapshot = true;
+	}
+	else {
+		fullSnapshot = jsonVal.get<bool>();
+	}
+	
 	if (!Private::JsonExtract(config, "port", nlohmann::json::value_t::number_unsigned, jsonVal)) {
 		SPDLOG_WARN("Missing or invalid 'port' configuration, defaulting to 9001.");
 		port = 9001;
@@ -190,103 +388,175 @@ hvac::WebServer::WebServer(const nlohmann::json &config) {
 	return;
 }
 
-//! Helper function to get/read website file in wwwPath. Requesting root path ('/') will return '/index.html'.
-//! @param[in] filePath Partial target file path (wwwPath will be prepended later).
-//! @param[out] headers Headers (e.g. MIME type) to be written as part of response.
-//! @param[out] resp Target file content or HTTP status code if error.
-//! @return True if target file exists and file is read successfully.
-bool hvac::WebServer::GetWwwFile(std::string_view filePath,
-std::unordered_map<std::string, std::string> &headers, std::string &resp) const {
-	const std::string_view &chkFilePath = (filePath == "/") ? "/index.html" : filePath;
-	const std::unique_ptr<char> validPath(realpath((wwwPath + std::string(chkFilePath.data(),
-		chkFilePath.size())).data(), nullptr));
-	bool result = true;
-
-	//check whether target file path valid or not, then whether file is within 'wwwPath' or not.
-	if ((validPath) && (std::strstr(validPath.get(), wwwPath.c_str()) == validPath.get())) {
-		const std::filesystem::path &ext = std::filesystem::path(validPath.get()).extension();
-			
-		if (ext == ".html") {
-			headers.insert_or_assign("Content-Type", "text/html");
-		}
-		else if (ext == ".js") {
-			headers.insert_or_assign("Content-Type", "application/javascript");
-		}
-		else if (ext == ".css") {
-			headers.insert_or_assign("Content-Type", "text/css");
-		}
-		else if (ext == ".ico") {
-			headers.insert_or_assign("Content-Type", "image/x-icon");
-		}
-		else {
-			SPDLOG_WARN("Attempt to open unhandled file type: '{}'.", validPath.get());
-			result = false;
-		}
-		
-		if (result) {
-			std::ifstream fileStrm(validPath.get(), std::ios_base::in | std::ios::ate);
-		
-			if (fileStrm.fail()) {
-				SPDLOG_DEBUG("Error opening target file: '{}'.", validPath.get());
-				result = false;
-			}
-			else {
-				const std::fpos fileSz = fileStrm.tellg();
-				resp.assign(fileSz, '\0');
-				fileStrm.seekg(0).read(resp.data(), fileSz);
-			}
-		}
-	}
-	else {
-		SPDLOG_WARN("Invalid target file path: '{}'.", chkFilePath);
-		result = false;
-	}
+//! Helper function to run function on server loop thread, as uWebSockets isn't thread-safe.
+//! @param[in] fn Function to be run.
+//! @return False if server loop is not running.
+bool hvac::WebServer::Defer(std::function<void()> &&fn) {
+	std::lock_guard<decltype(loopGuard)> lock(loopGuard);
 	
-	if (!result) {
-		resp = "404 Not Found";
+	if (loop) {
+		loop->defer(std::move(fn));
 	}
+	
+	return loop != nullptr;
+}
 
-	return result;
+//! Helper function to publish message to WebSocket topic on server loop thread.
+//! @param[in] topic Target topic.
+//! @param[in] msg Message to be sent.
+//! @param[in] opcode WebSocket protocol transaction opcode.
+//! @return False if server loop is not running.
+bool hvac::WebServer::Publish(std::string_view topic, std::string_view msg, uWS::OpCode opcode) {
+	return Defer([this, topic = std::string(topic), msg = std::string(msg), opcode]() {
+		if (publish) {
+			publish(topic, msg, opcode);
+		}
+	});
 }
 
 //! Server process that is intended to run on separate thread.
 void hvac::WebServer::Process() {
-	auto fxStartServer = [this](auto app) {
-		app.get("/*", [this](auto *res, uWS::HttpRequest *req) {
-			std::unordered_map<std::string, std::string> headers;
-			std::string resp;
+	auto fxStartServer = [this]<bool SSL>(uWS::TemplatedApp<SSL> app) {
+		typedef uWS::WebSocket<SSL, true, ClientData> Socket;
+		
+		publish = [&app](std::string_view topic, std::string_view msg, uWS::OpCode opcode) {
+			app.publish(topic, msg, opcode, true);
+		};
+		sendDeltas = [this]() {
+			decltype(pendingValues) values;
+			
+			{
+				std::lock_guard<decltype(pendingGuard)> lock(pendingGuard);
+				values.swap(pendingValues);
+			}
+			
+			nlohmann::json current;									//picks up changes nobody pushed
+			if (!deltaClients) {
+				polledValues.clear();
+			}
+			else if (ReadConnectorValues(current)) {
+				for (const auto &value : current.items()) {
+					const auto &last = polledValues.find(value.key());
+					
+					if ((last == polledValues.end()) || (*last != value.value())) {
+						values.try_emplace(value.key(), value.value());
+					}
+				}
+				polledValues = std::move(current);
+			}
+			
+			if (values.empty()) {
+				return;
+			}
 			
-			if (GetWwwFile(req->getUrl(), headers, resp)) {
-				for (const auto &header : headers) {
-					res->writeHeader(header.first, header.second);
+			for (auto wsSock : wsSocks) {
+				Socket *ws = (Socket*) wsSock;
+				const ClientData &client = *ws->getUserData();
+				nlohmann::json delta = nlohmann::json::object();
+				
+				if (client.connectors.size() < values.size()) {		//walk smaller set
+					for (const auto &connector : client.connectors) {
+						const auto &value = values.find(connector);
+						
+						if (value != values.end()) {
+							delta[connector] = value->second;
+						}
+					}
+				}
+				else {
+					for (const auto &value : values) {
+						if (client.connectors.count(value.first)) {
+							delta[value.first] = value.second;
+						}
+					}
+				}
+				
+				if (!delta.empty()) {
+					const nlohmann::json &msg = {{"type", "delta"}, {"connector_value", delta}};
+					
+					ws->send(msg.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace),
+						uWS::OpCode::TEXT, true);
 				}
-				res->end(resp);
+			}
+		};
+		
+		app.get("/*", [this](auto *res, uWS::HttpRequest *req) {
+			const std::shared_ptr<const WwwCache::File> &file = wwwCache->Find(req->getUrl());
+			
+			if (!file) {
+				SPDLOG_DEBUG("Invalid target file path: '{}'.", req->getUrl());
+				res->writeStatus("404 Not Found")->end();
 			}
 			else {
-				res->writeStatus(resp)->end();
+				std::string_view encoding;
+				const WwwCache::Variant &variant = WwwCache::SelectVariant(*file,
+					req->getHeader("accept-encoding"), encoding);
+				
+				if (WwwCache::MatchesETag(req->getHeader("if-none-match"), variant.etag)) {
+					res->writeStatus("304 Not Modified")->writeHeader("ETag", variant.etag)
+						->writeHeader("Vary", "Accept-Encoding")->end();
+				}
+				else {
+					std::string diskData;									//file too big to be cached
+					
+					if (!file->diskPath.empty() && !WwwCache::ReadFromDisk(*file, diskData)) {
+						SPDLOG_WARN("Error reading web server file: '{}'.", file->diskPath);
+						res->writeStatus("404 Not Found")->end();
+						return;
+					}
+					
+					res->writeHeader("Content-Type", file->mime)->writeHeader("ETag", variant.etag)
+						->writeHeader("Vary", "Accept-Encoding")->writeHeader("Cache-Control", "no-cache");
+					if (!encoding.empty()) {
+						res->writeHeader("Content-Encoding", encoding);
+					}
+					res->end(file->diskPath.empty() ? std::string_view(variant.data) : diskData);
+				}
 			}
-		}).post("/api", [](auto *res, uWS::HttpRequest*) {
-			std::string dataFull;
+		}).post("/api", [](auto *res, uWS::HttpRequest *req) {
+			//request body is decoded as per Content-Type, response is encoded as per Accept
+			const std::shared_ptr<ApiTransfer> &xfer = std::make_shared<ApiTransfer>();
+			const ApiFormat reqFormat = ParseApiFormat(req->getHeader("content-type"));
 			
-			res->onAborted([]() {									//need to add this lest it'll crash
-				return;
+			xfer->format = ParseApiFormat(req->getHeader("accept"));
+			res->onAborted([xfer]() {								//need to add this lest it'll crash
+				xfer->isAborted = true;
 			});
-			res->onData([res, &dataFull](std::string_view dataPartial, bool done) {
-				dataFull.append(dataPartial);
+			res->onData([res, xfer, reqFormat](std::string_view dataPartial, bool done) {
+				xfer->body.append(dataPartial);
 				
 				if (done) {
-					nlohmann::json resp;
+					if (reqFormat != ApiFormat::JSON) {
+						const nlohmann::json &reqJson = (reqFormat == ApiFormat::CBOR) ?
+							nlohmann::json::from_cbor(xfer->body, true, false) :
+							nlohmann::json::from_msgpack(xfer->body, true, false);
+						
+						xfer->body = reqJson.is_discarded() ? "" : reqJson.dump();
+					}
 					
-					if (DevManager::RestApiHandler(dataFull, resp)) {
-						res->end(resp.dump(1, '\t', false, nlohmann::json::error_handler_t::replace));
+					if (xfer->body.empty()) {
+						res->writeStatus("400 Bad Request")->end();
+					}
+					else if (!DevManager::RestApiHandler(xfer->body, xfer->resp)) {
+						res->writeStatus(xfer->resp.get<std::string_view>())->end();
 					}
 					else {
-						res->writeStatus(resp.get<std::string_view>())->end();
+						res->writeHeader("Content-Type", ApiMediaType(xfer->format));
+						
+						if (!xfer->resp.is_array()) {
+							std::string encoded;
+							
+							EncodeApiValue(xfer->resp, xfer->format, encoded);
+							res->end(encoded);
+						}
+						else if (!WriteApiStream(res, *xfer)) {
+							res->onWritable([res, xfer](uintmax_t) {
+								WriteApiStream(res, *xfer);
+								return true;
+							});
+						}
 					}
 				}
-				else {
-					res->writeContinue()->end();
-				}
 			});
 		}).template ws<ClientData>("/*", {
 			.compression = uWS::SHARED_COMPRESSOR,
@@ -297,33 +567,102 @@ void hvac::WebServer::Process() {
 			.open = [this](auto *ws) {
 				SPDLOG_TRACE("WebSocket connected.");
 				
-				std::lock_guard<decltype(wsSocksGuard)> lock(wsSocksGuard);
-				const typename decltype(wsSocks)::iterator &wsFind =
-					std::find(wsSocks.begin(), wsSocks.end(), ws);
-				nlohmann::json resp;
-				
-				if (wsFind != wsSocks.end()) {
+				if (!wsSocks.insert(ws).second) {
 					SPDLOG_WARN("WebSocket '{}' already in list.", ws->getRemoteAddressAsText());
 				}
 				else {
 					SPDLOG_TRACE("WebSocket entry '{}' inserted.", ws->getRemoteAddressAsText());
-					wsSocks.emplace_back(ws);
+					ws->subscribe(WS_TOPIC_ALL);
+					ws->subscribe(WS_TOPIC_PING);
+				}
+				
+				nlohmann::json jsonVal;
+				
+				if (fullSnapshot && ReadConnectorValues(jsonVal)) {
+					ws->send(jsonVal.dump(1, '\t', false, nlohmann::json::error_handler_t::replace),
+						uWS::OpCode::TEXT, true);
 				}
+			},
+			//Connector subscription protocol, where 'connectors' is array of connector names:
+			//- {"type": "subscribe", "connectors": [...]}: replies with snapshot of given connectors as
+			//  {"type": "snapshot", "connector_value": {...}}, then sends changed ones every tick as
+			//  {"type": "delta", "connector_value": {...}}.
+			//  Changes are polled every tick, or pushed via UpdateValue().
+			//  Client keeps receiving broadcast messages too.
+			//- {"type": "unsubscribe", "connectors": [...]}: all connectors if 'connectors' is omitted.
+			.message = [this](auto *ws, std::string_view msg, uWS::OpCode) {
+				const nlohmann::json &req = nlohmann::json::parse(msg, nullptr, false);
+				ClientData &client = *ws->getUserData();
+				const bool wasDelta = !client.connectors.empty();
+				nlohmann::json jsonVal, connectors;
+				std::string err;
 				
-				if (DevManager::RestApiHandler(R"([{
-					"connector_value": {},
-					"type": "read"
-				}])", resp)) {
-					nlohmann::json jsonVal;
+				if (!req.is_object() ||
+				!Private::JsonExtract(req, "type", nlohmann::json::value_t::string, jsonVal)) {
+					err = "Missing or invalid 'type'.";
+				}
+				else if (req.contains("connectors") &&
+				(!Private::JsonExtract(req, "connectors", nlohmann::json::value_t::array, connectors) ||
+				!std::all_of(connectors.begin(), connectors.end(), [](const nlohmann::json &connector) {
+					return connector.is_string();
+				}))) {
+					err = "Invalid 'connectors'.";
+				}
+				else if (jsonVal.get<std::string_view>() == "subscribe") {
+					nlohmann::json values, snapshot = nlohmann::json::object();
 					
-					if (Private::RestExtractResponse(resp, "connector_value", "read", 200,
-					nlohmann::json::value_t::object, jsonVal)) {
-						ws->send(jsonVal.dump(1, '\t', false, nlohmann::json::error_handler_t::replace),
+					if (!ReadConnectorValues(values)) {
+						err = "Error reading connector values.";
+					}
+					else {
+						for (const auto &connector : connectors) {
+							const auto &value = values.find(connector.get<std::string>());
+							
+							if (value != values.end()) {
+								client.connectors.insert(value.key());
+								snapshot[value.key()] = *value;
+							}
+						}
+						
+						//baseline for polling on first subscription, kept as is otherwise lest changes get lost
+						for (const auto &value : values.items()) {
+							polledValues.emplace(value.key(), value.value());
+						}
+						
+						const nlohmann::json &msg = {{"type", "snapshot"}, {"connector_value", snapshot}};
+						
+						ws->send(msg.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace),
 							uWS::OpCode::TEXT, true);
 					}
 				}
+				else if (jsonVal.get<std::string_view>() == "unsubscribe") {
+					if (!req.contains("connectors")) {
+						client.connectors.clear();
+					}
+					
+					for (const auto &connector : connectors) {
+						client.connectors.erase(connector.get<std::string>());
+					}
+				}
+				else {
+					err = "Unknown 'type'.";
+				}
+				
+				if (!err.empty()) {
+					SPDLOG_DEBUG("Invalid WebSocket message from '{}': {}", ws->getRemoteAddressAsText(), err);
+					ws->send(nlohmann::json({{"type", "error"}, {"message", err}}).dump(), uWS::OpCode::TEXT,
+						true);
+				}
+				
+				if (wasDelta != !client.connectors.empty()) {		//delta updates only queued while needed
+					if (wasDelta) {
+						--deltaClients;
+					}
+					else {
+						++deltaClients;
+					}
+				}
 			},
-			.message = [](auto*, std::string_view, uWS::OpCode) {},
 			.drain = [](auto *ws) {
 				SPDLOG_WARN("WebSocket draining {} bytes.", ws->getBufferedAmount());
 			},
@@ -332,16 +671,15 @@ void hvac::WebServer::Process() {
 			.close = [this](auto *ws, int code, std::string_view msg) {
 				SPDLOG_DEBUG("WebSocket disconnected with code '{}': {}", code, msg);
 				
-				std::lock_guard<decltype(wsSocksGuard)> lock(wsSocksGuard);
-				const typename decltype(wsSocks)::iterator &wsFind =
-					std::find(wsSocks.begin(), wsSocks.end(), ws);
+				if (!ws->getUserData()->connectors.empty()) {
+					--deltaClients;
+				}
 				
-				if (wsFind == wsSocks.end()) {
+				if (!wsSocks.erase(ws)) {
 					SPDLOG_WARN("WebSocket '{}' not found from list.", ws->getRemoteAddressAsText());
 				}
 				else {
 					SPDLOG_TRACE("WebSocket entry '{}' erased.", ws->getRemoteAddressAsText());
-					wsSocks.erase(wsFind);
 				}
 				
 				return;
@@ -351,7 +689,38 @@ void hvac::WebServer::Process() {
 				SPDLOG_INFO("Web server listening at port '{}'.", port);
 				this->token = token;
 			}
-		}).run();
+		});
+		
+		bool isStopping;
+		{
+			std::lock_guard<decltype(loopGuard)> lock(loopGuard);
+			
+			isStopping = stop;
+			if (!isStopping) {
+				loop = uWS::Loop::get();
+			}
+		}
+		
+		if (!isStopping) {
+			deltaTimer = us_create_timer((us_loop_t*) loop, 1, 0);	//fall through, lest it keeps loop alive
+			us_timer_set(deltaTimer, [](us_timer_t*) {
+				server->sendDeltas();
+			}, WS_DELTA_TICK_MS, WS_DELTA_TICK_MS);
+			
+			app.run();
+		}
+		else if (token) {											//Stop() came before loop was published
+			us_listen_socket_close(useSsl, token);
+			token = nullptr;
+		}
+		
+		std::lock_guard<decltype(loopGuard)> lock(loopGuard);
+		loop = nullptr;
+		publish = nullptr;
+		sendDeltas = nullptr;
+		wsSocks.clear();
+		polledValues.clear();
+		deltaClients = 0;
 	};
 	
 	if (useSsl) {
@@ -377,7 +746,7 @@ void hvac::WebServer::Process() {
 void hvac::WebServer::PingClients() {
 	while (!stop) {
 		std::this_thread::sleep_for(std::chrono::seconds(4));
-		if (!hvac::WebServer::SendMessage("", uWS::OpCode::PING)) {
+		if (!Publish(WS_TOPIC_PING, "", uWS::OpCode::PING)) {
 			SPDLOG_DEBUG("Error sending ping message.");
 		}
 	}
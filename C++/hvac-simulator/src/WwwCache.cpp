@@ -0,0 +1,374 @@
+#include "main.h"
+#include "WwwCache.h"
+
+#include <Commons.h>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+//! Events of website tree directories that trigger rebuild.
+constexpr static uint32_t WWW_WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+	IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR;
+//! Quiet period after last change before rebuild, so bulk deployment triggers single rebuild, in ms.
+constexpr static int WWW_SETTLE_MS = 200;
+//! Files larger than this are left out of cache and read from disk on request instead, in bytes.
+constexpr static uintmax_t WWW_MAX_FILE_SZ = 16u * 1024u * 1024u;
+
+//! Helper function to get MIME type of file.
+//! @param[in] ext File extension, including dot.
+//! @return MIME type, empty if file type isn't served.
+static std::string_view MimeType(const std::filesystem::path &ext) {
+	std::string_view result;
+	
+	if (ext == ".html") {
+		result = "text/html";
+	}
+	else if (ext == ".js") {
+		result = "application/javascript";
+	}
+	else if (ext == ".css") {
+		result = "text/css";
+	}
+	else if (ext == ".ico") {
+		result = "image/x-icon";
+	}
+	else if (ext == ".json") {
+		result = "application/json";
+	}
+	else if (ext == ".svg") {
+		result = "image/svg+xml";
+	}
+	else if (ext == ".png") {
+		result = "image/png";
+	}
+	
+	return result;
+}
+
+//! Helper function to read whole file.
+//! @param[in] path File path.
+//! @param[out] data File content.
+//! @return True if file is read successfully.
+static bool ReadFile(const std::filesystem::path &path, std::string &data) {
+	std::ifstream fileStrm(path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+	bool result = false;
+	
+	if (!fileStrm.fail()) {
+		const std::streamoff fileSz = fileStrm.tellg();
+		
+		data.assign(fileSz, '\0');
+		result = !fileStrm.seekg(0).read(data.data(), fileSz).fail();
+	}
+	
+	return result;
+}
+
+//! Helper function to gzip encode data.
+//! @param[in] data Data to be encoded.
+//! @return Encoded data, empty if error.
+static std::string GzipEncode(const std::string &data) {
+	z_stream strm = {};
+	std::string result;
+	
+	if (deflateInit2(&strm, Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 9, Z_DEFAULT_STRATEGY) == Z_OK) {
+		result.resize(deflateBound(&strm, data.size()));
+		strm.next_in = (Bytef*) data.data();
+		strm.avail_in = data.size();
+		strm.next_out = (Bytef*) result.data();
+		strm.avail_out = result.size();
+		
+		if (deflate(&strm, Z_FINISH) == Z_STREAM_END) {
+			result.resize(strm.total_out);
+		}
+		else {
+			result.clear();
+		}
+		deflateEnd(&strm);
+	}
+	
+	return result;
+}
+
+//! Constructor. Builds cache, then starts watching website tree for change.
+//! @param[in] rootPath Website root directory, as canonical path.
+//! @throw runtime_error If error creating inotify or eventfd instance.
+hvac::WwwCache::WwwCache(const std::string &rootPath) : rootPath(rootPath) {
+	inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if ((inotifyFd == -1) || (stopFd == -1)) {
+		for (const int fd : {inotifyFd, stopFd}) {
+			if (fd != -1) {
+				close(fd);
+			}
+		}
+		
+		throw std::runtime_error("Error creating web server file watch handles: " +
+			std::string(std::strerror(errno)));
+	}
+	
+	files = Build();
+	thd = std::thread(&WwwCache::Watch, this);
+	
+	return;
+}
+
+//! Destructor. Stops watching website tree.
+hvac::WwwCache::~WwwCache() {
+	if (eventfd_write(stopFd, 1)) {
+		SPDLOG_ERROR("Error notifying web server file watch to stop: '{}'", std::strerror(errno));
+		thd.detach();												//stops on closed handle instead
+	}
+	else {
+		thd.join();
+	}
+	
+	close(inotifyFd);
+	close(stopFd);
+	
+	return;
+}
+
+//! Looks up cached file. Thread-safe, and takes no system call. Requesting root path ('/') will return
+//! '/index.html'.
+//! @param[in] urlPath URL path, without query string.
+//! @return Cached file, nullptr if not found.
+std::shared_ptr<const hvac::WwwCache::File> hvac::WwwCache::Find(std::string_view urlPath) const {
+	std::shared_ptr<const Files> current;
+	
+	{
+		std::lock_guard<decltype(guard)> lock(guard);
+		current = files;
+	}
+	
+	const auto &pos = current->find(std::string((urlPath == "/") ? "/index.html" : urlPath));
+	
+	return (pos != current->end()) ? pos->second : nullptr;
+}
+
+//! Reads content of file too big to be cached, i.e. with \ref File::diskPath set.
+//! @param[in] file File entry from \ref Find().
+//! @param[out] data File content.
+//! @return True if file is read successfully.
+bool hvac::WwwCache::ReadFromDisk(const File &file, std::string &data) {
+	return ReadFile(file.diskPath, data);
+}
+
+//! Selects smallest file variant acceptable to client.
+//! @param[in] file Cached file.
+//! @param[in] acceptEncoding Accept-Encoding request header.
+//! @param[out] encoding Content-Encoding response header, empty if file is sent as is.
+//! @return Selected variant.
+const hvac::WwwCache::Variant& hvac::WwwCache::SelectVariant(const File &file, std::string_view acceptEncoding,
+std::string_view &encoding) {
+	const Variant *result = &file.raw;
+	
+	encoding = {};
+	if (!file.br.data.empty() && AcceptsEncoding(acceptEncoding, "br")) {
+		result = &file.br;
+		encoding = "br";
+	}
+	else if (!file.gzip.data.empty() && AcceptsEncoding(acceptEncoding, "gzip")) {
+		result = &file.gzip;
+		encoding = "gzip";
+	}
+	
+	return *result;
+}
+
+//! Checks whether client's cached copy is still valid.
+//! @param[in] ifNoneMatch If-None-Match request header.
+//! @param[in] etag Current ETag of selected variant.
+//! @return True if any listed ETag matches, so 304 Not Modified should be sent.
+bool hvac::WwwCache::MatchesETag(std::string_view ifNoneMatch, std::string_view etag) {
+	bool result = false;
+	
+	while (!result && !ifNoneMatch.empty()) {
+		const size_t sep = ifNoneMatch.find(',');
+		std::string_view tag = ifNoneMatch.substr(0, sep);
+		
+		tag.remove_prefix(std::min(tag.find_first_not_of(' '), tag.size()));
+		tag.remove_suffix(tag.size() - std::min(tag.find_last_not_of(' ') + 1u, tag.size()));
+		if (tag.substr(0, 2) == "W/") {								//weak comparison, as per RFC 9110
+			tag.remove_prefix(2);
+		}
+		
+		result = (tag == "*") || (tag == etag);
+		ifNoneMatch.remove_prefix((sep == std::string_view::npos) ? ifNoneMatch.size() : (sep + 1u));
+	}
+	
+	return result;
+}
+
+//! Helper function to check whether content coding is acceptable to client.
+//! @param[in] acceptEncoding Accept-Encoding request header.
+//! @param[in] encoding Content coding, in lowercase.
+//! @return True if content coding is listed without zero quality value.
+bool hvac::WwwCache::AcceptsEncoding(std::string_view acceptEncoding, std::string_view encoding) {
+	bool result = false;
+	
+	while (!result && !acceptEncoding.empty()) {
+		const size_t sep = acceptEncoding.find(',');
+		std::string_view coding = acceptEncoding.substr(0, sep);
+		const size_t param = coding.find(';');
+		std::string_view quality = (param == std::string_view::npos) ? "" : coding.substr(param + 1u);
+		
+		coding = coding.substr(0, param);
+		coding.remove_prefix(std::min(coding.find_first_not_of(' '), coding.size()));
+		coding.remove_suffix(coding.size() - std::min(coding.find_last_not_of(' ') + 1u, coding.size()));
+		quality.remove_prefix(std::min(quality.find("q="), quality.size()));
+		
+		result = (coding == encoding) &&
+			((quality.size() < 3u) || (quality.find_first_not_of("0.", 2u) != std::string_view::npos));
+		acceptEncoding.remove_prefix((sep == std::string_view::npos) ? acceptEncoding.size() : (sep + 1u));
+	}
+	
+	return result;
+}
+
+//! Helper function to build strong ETag from content.
+//! @param[in] data File content.
+//! @param[in] suffix Content coding tag, as strong ETag must differ per content coding.
+//! @return Quoted ETag.
+std::string hvac::WwwCache::MakeETag(std::string_view data, std::string_view suffix) {
+	char etag[64];
+	
+	snprintf(etag, sizeof(etag), "\"%zx-%zx%.*s\"", data.size(), std::hash<std::string_view>()(data),
+		(int) suffix.size(), suffix.data());
+	
+	return etag;
+}
+
+//! Helper function to read whole website tree, and to watch its directories. Files outside root directory
+//! (through symbolic link) or of unhandled type are skipped.
+//! @return Cached files.
+std::shared_ptr<const hvac::WwwCache::Files> hvac::WwwCache::Build() const {
+	const auto &result = std::make_shared<Files>();
+	std::error_code err;
+	size_t totalSz = 0;
+	
+	inotify_add_watch(inotifyFd, rootPath.c_str(), WWW_WATCH_MASK);
+	for (auto entry = std::filesystem::recursive_directory_iterator(rootPath,
+	std::filesystem::directory_options::skip_permission_denied, err);
+	entry != std::filesystem::recursive_directory_iterator(); entry.increment(err)) {
+		const std::filesystem::path &path = entry->path();
+		const std::string_view &mime = MimeType(path.extension());
+		
+		if (entry->is_directory(err)) {
+			if (inotify_add_watch(inotifyFd, path.c_str(), WWW_WATCH_MASK) == -1) {
+				SPDLOG_WARN("Error watching web server directory '{}': '{}'", path.string(),
+					std::strerror(errno));
+			}
+		}
+		else if (mime.empty() || !entry->is_regular_file(err)) {
+			SPDLOG_TRACE("Web server skipping unhandled file: '{}'.", path.string());
+		}
+		else if (std::filesystem::canonical(path, err).string().rfind(rootPath + '/', 0) != 0) {
+			SPDLOG_WARN("Web server skipping file outside 'www_root': '{}'.", path.string());
+		}
+		else if (const uintmax_t fileSz = entry->file_size(err); fileSz > WWW_MAX_FILE_SZ) {
+			File file;
+			char etag[64];
+			
+			//content is read on request, so ETag comes from size and modification time instead
+			snprintf(etag, sizeof(etag), "\"%jx-%jx\"", fileSz,
+				(uintmax_t) entry->last_write_time(err).time_since_epoch().count());
+			file.raw.etag = etag;
+			file.mime = mime;
+			file.diskPath = path.string();
+			
+			SPDLOG_INFO("Web server serving file too big to cache from disk: '{}'.", path.string());
+			result->emplace('/' + path.lexically_relative(rootPath).generic_string(),
+				std::make_shared<const File>(std::move(file)));
+		}
+		else {
+			File file;
+			
+			if (!ReadFile(path, file.raw.data)) {
+				SPDLOG_WARN("Error reading web server file: '{}'.", path.string());
+				continue;
+			}
+			
+			std::filesystem::path encPath = path;
+			
+			if (!ReadFile(encPath.concat(".gz"), file.gzip.data)) {
+				file.gzip.data = GzipEncode(file.raw.data);
+			}
+			if (file.gzip.data.size() >= file.raw.data.size()) {
+				file.gzip.data.clear();
+			}
+			
+			encPath = path;
+			ReadFile(encPath.concat(".br"), file.br.data);
+			
+			file.raw.etag = MakeETag(file.raw.data, "");
+			file.gzip.etag = MakeETag(file.raw.data, "-gz");
+			file.br.etag = MakeETag(file.raw.data, "-br");
+			file.mime = mime;
+			
+			totalSz += file.raw.data.size() + file.gzip.data.size() + file.br.data.size();
+			result->emplace('/' + path.lexically_relative(rootPath).generic_string(),
+				std::make_shared<const File>(std::move(file)));
+		}
+	}
+	
+	SPDLOG_INFO("Web server cached {} file(s) of {} bytes from '{}'.", result->size(), totalSz, rootPath);
+	
+	return result;
+}
+
+//! Process that rebuilds cache on website tree change, intended to run on separate thread.
+void hvac::WwwCache::Watch() {
+	pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+	alignas(inotify_event) char events[4096];
+	bool stop = false;
+	
+	while (!stop) {
+		int timeout = -1;
+		bool isChanged = false;
+		
+		while (!stop) {													//wait until tree settles
+			const int fdQt = poll(fds, 2, timeout);
+			
+			if (fdQt == -1) {
+				if (errno != EINTR) {
+					SPDLOG_ERROR("Error waiting for web server file change: '{}'", std::strerror(errno));
+					stop = true;
+				}
+			}
+			else if (fds[1].revents) {
+				stop = true;
+			}
+			else if (fdQt == 0) {
+				break;
+			}
+			else {
+				while (read(inotifyFd, events, sizeof(events)) > 0) {}	//content is irrelevant, drain only
+				isChanged = true;
+				timeout = WWW_SETTLE_MS;
+			}
+		}
+		
+		if (isChanged && !stop) {
+			std::shared_ptr<const Files> rebuilt = Build();
+			
+			{
+				std::lock_guard<decltype(guard)> lock(guard);
+				files.swap(rebuilt);
+			}
+		}
+	}
+	
+	return;
+}
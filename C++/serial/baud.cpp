@@ -0,0 +1,33 @@
+//termios2 can't be used together with <termios.h> as both define same structures, hence separate file
+#include "baud.h"
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+//! Sets serial port to arbitrary baud rate via termios2 and BOTHER. Other access config is kept as is, so this
+//! is expected to be called after usual termios setup.
+//! @param[in] fd Serial file descriptor.
+//! @param[in] rate Requested baud rate.
+//! @param[out] actual Baud rate reported by driver after setting, which may be rounded to what hardware
+//!						can achieve.
+//! @return False if error has occurred, \b errno is set.
+bool setBaudRate(int fd, uint32_t rate, uint32_t *actual) {
+	termios2 ttycfg;
+	
+	if (ioctl(fd, TCGETS2, &ttycfg)) {
+		return false;
+	}
+	
+	ttycfg.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+	ttycfg.c_cflag |= (BOTHER | (BOTHER << IBSHIFT));				//same custom rate for both directions
+	ttycfg.c_ispeed = rate;
+	ttycfg.c_ospeed = rate;
+	
+	if (ioctl(fd, TCSETS2, &ttycfg) || ioctl(fd, TCGETS2, &ttycfg)) {
+		return false;
+	}
+	
+	*actual = ttycfg.c_ospeed;
+	
+	return true;
+}
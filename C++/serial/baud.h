@@ -0,0 +1,8 @@
+#ifndef BAUD_H
+#define BAUD_H
+
+#include <cstdint>
+
+bool setBaudRate(int fd, uint32_t rate, uint32_t *actual);
+
+#endif
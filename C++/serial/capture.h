@@ -0,0 +1,31 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <cstdint>
+
+//! Capture container is made of data file and its index file ("<data file>.idx"). Data file holds
+//! \ref capture_header followed by raw data as read. Index file holds \ref capture_header followed by one
+//! \ref capture_index per read, in time order, so it can be memory-mapped and binary searched.
+#define CAPTURE_DATA_MAGIC		"SERCAPD"
+#define CAPTURE_INDEX_MAGIC		"SERCAPI"
+#define CAPTURE_INDEX_EXT		".idx"
+#define CAPTURE_VERSION			1u
+
+//! Format of capture data and index file header.
+struct capture_header {
+	char magic[8];													//!< CAPTURE_*_MAGIC, NULL terminated.
+	uint32_t version;												//!< \ref CAPTURE_VERSION.
+	uint32_t size;													//!< Header size, in bytes.
+	uint64_t startTs;												//!< Start CLOCK_MONOTONIC time, in ns.
+	int64_t startRealTs;											//!< Start CLOCK_REALTIME time, in ns.
+	uint32_t baud;													//!< Serial port baud rate.
+	uint32_t reserved;
+} __attribute__ ((packed));
+
+//! Format of single capture index entry.
+struct capture_index {
+	uint64_t ts;													//!< Read CLOCK_MONOTONIC time, in ns.
+	uint64_t offset;												//!< Read data offset, after header.
+} __attribute__ ((packed));
+
+#endif
@@ -0,0 +1,192 @@
+#include "capture.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+const char *captureFile = NULL;
+double seekSec = 0.0;
+uint64_t maxCount = UINT64_MAX;
+bool showInfo = false;
+
+//! Memory-mapped file.
+struct MappedFile {
+	const uint8_t *data = NULL;										//!< Mapped file content.
+	size_t size = 0;												//!< File size, in bytes.
+	int fd = -1;													//!< File descriptor.
+};
+
+//! Helper function to parse command-line arguments.
+bool parseArgs(int argc, char **args) {
+	int opt;
+	bool result = true;
+	
+	while ((opt = getopt(argc, args, "c:in:t:")) != -1) {
+		switch (opt) {
+			case 'c':
+				captureFile = optarg;
+				break;
+			case 'i':
+				showInfo = true;
+				break;
+			case 'n':
+				try {
+					maxCount = std::stoull(optarg);
+				}
+				catch (...) {
+					fprintf(stderr, "Invalid '-n' value '%s'.\n", optarg);
+					result = false;
+				}
+				break;
+			case 't':
+				try {
+					seekSec = std::stod(optarg);
+				}
+				catch (...) {
+					fprintf(stderr, "Invalid '-t' value '%s'.\n", optarg);
+					result = false;
+				}
+				break;
+			default:
+				result = false;
+				break;
+		}
+	}
+	
+	if (result && !captureFile) {
+		fprintf(stderr, "Missing '-c' argument.\n");
+		result = false;
+	}
+	
+	if (!result) {
+		fprintf(stderr, "Usage:\t%s ", args[0]);
+		fprintf(stderr, "<-c capture file> [-t seek time, in seconds since capture start]\n");
+		fprintf(stderr, "\t[-n max byte count] [-i show capture info instead of data]\n");
+		fprintf(stderr, "Data from read nearest before seek time onward is written to stdout.\n");
+	}
+	
+	return result;
+}
+
+//! Helper function to memory-map whole file and validate its header.
+//! @param[in] path File path.
+//! @param[in] magic Expected header magic.
+//! @param[out] file Mapped file.
+//! @return False if error has occurred.
+bool mapFile(const char *path, const char *magic, MappedFile &file) {
+	struct stat fileStat;
+	
+	file.fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (file.fd == -1) {
+		fprintf(stderr, "Error opening capture file '%s': %s\n", path, strerror(errno));
+		return false;
+	}
+	
+	if (fstat(file.fd, &fileStat)) {
+		fprintf(stderr, "Error getting capture file '%s' size: %s\n", path, strerror(errno));
+		return false;
+	}
+	file.size = fileStat.st_size;
+	
+	if (file.size < sizeof(capture_header)) {
+		fprintf(stderr, "Capture file '%s' is too small.\n", path);
+		return false;
+	}
+	
+	void *data = mmap(NULL, file.size, PROT_READ, MAP_SHARED, file.fd, 0);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "Error mapping capture file '%s': %s\n", path, strerror(errno));
+		return false;
+	}
+	file.data = static_cast<const uint8_t*>(data);
+	
+	const capture_header *header = reinterpret_cast<const capture_header*>(file.data);
+	if (strncmp(header->magic, magic, sizeof(header->magic)) || (header->version != CAPTURE_VERSION) ||
+	(header->size < sizeof(capture_header)) || (header->size > file.size)) {
+		fprintf(stderr, "Capture file '%s' header is not valid.\n", path);
+		return false;
+	}
+	
+	return true;
+}
+
+//! Helper function to unmap and close file.
+void unmapFile(MappedFile &file) {
+	if (file.data) {
+		munmap(const_cast<uint8_t*>(file.data), file.size);
+	}
+	
+	if (file.fd != -1) {
+		close(file.fd);
+	}
+}
+
+int main(int argc, char **args) {
+	bool result = parseArgs(argc, args);
+	
+	MappedFile dataFile, indexFile;
+	
+	if (result) {
+		const std::string indexPath = std::string(captureFile) + CAPTURE_INDEX_EXT;
+		
+		result = mapFile(captureFile, CAPTURE_DATA_MAGIC, dataFile) &&
+			mapFile(indexPath.c_str(), CAPTURE_INDEX_MAGIC, indexFile);
+	}
+	
+	if (result) {
+		const capture_header *header = reinterpret_cast<const capture_header*>(dataFile.data);
+		const capture_header *indexHeader = reinterpret_cast<const capture_header*>(indexFile.data);
+		//index may be cut short by unclean stop, only whole entries count
+		const capture_index *first = reinterpret_cast<const capture_index*>(indexFile.data + indexHeader->size);
+		const capture_index *last = first + (indexFile.size - indexHeader->size) / sizeof(capture_index);
+		const uint64_t dataSz = dataFile.size - header->size;
+		
+		if (showInfo) {
+			const double lengthSec = (first == last) ? 0.0 : ((last - 1)->ts - header->startTs) * 1e-9;
+			
+			printf("start (realtime ns): %lld\n", (long long) header->startRealTs);
+			printf("baud: %u\n", header->baud);
+			printf("reads: %zu\n", (size_t) (last - first));
+			printf("data: %llu byte(s)\n", (unsigned long long) dataSz);
+			printf("length: %.6f s\n", lengthSec);
+		}
+		else {
+			//last read at or before seek time, via binary search over index
+			const uint64_t seekTs = header->startTs + (uint64_t) (std::max(seekSec, 0.0) * 1e9);
+			const capture_index *entry = std::upper_bound(first, last, seekTs,
+				[](uint64_t ts, const capture_index &elem) { return ts < elem.ts; });
+			const uint64_t offset = (entry == first) ? 0u : std::min((entry - 1)->offset, dataSz);
+			const uint64_t count = std::min(dataSz - offset, maxCount);
+			
+			size_t done = 0;
+			while (done < count) {
+				const ssize_t written = write(STDOUT_FILENO, dataFile.data + header->size + offset + done,
+					count - done);
+				
+				if (written < 0) {
+					if (errno == EINTR) {
+						continue;
+					}
+					
+					fprintf(stderr, "Error writing data: %s\n", strerror(errno));
+					result = false;
+					break;
+				}
+				
+				done += written;
+			}
+		}
+	}
+	
+	unmapFile(dataFile);
+	unmapFile(indexFile);
+	
+	return result ? 0 : -1;
+}
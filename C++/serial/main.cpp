@@ -1,45 +1,264 @@
+#include "baud.h"
+#include "capture.h"
+#include "splitter.h"
+#include "writer.h"
+
 #include <fcntl.h>
+#include <linux/serial.h>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
 #include <termios.h>
 #include <unistd.h>
 
+#include <array>
 #include <cerrno>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
-#include <fstream>
-#include <iomanip>
+#include <initializer_list>
 #include <ios>
-#include <sstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
 
+#define BAUD_DEFAULT 115200
+#define BAUD_TOLERANCE 3											//achieved baud rate error limit, in %
 #define INPUT_BUF_SZ 1024
+#define TIMESTAMP_SZ 32												//timestamp prefix space in output buffer
+#define OUTPUT_BUF_SZ (TIMESTAMP_SZ + INPUT_BUF_SZ * 3 + 1)			//hex mode: "XX " per byte + newline
+
+//! Hex mode rendering of each byte value, i.e. "XX ".
+constexpr std::array<std::array<char, 3>, 256> hexTable = [] {
+	constexpr char digits[] = "0123456789ABCDEF";
+	std::array<std::array<char, 3>, 256> result{};
+	
+	for (size_t i = 0; i < result.size(); ++i) {
+		result[i] = {digits[i >> 4], digits[i & 0x0f], ' '};
+	}
+	
+	return result;
+}();
+
+//! Single serial port and its settings.
+struct Port {
+	const char *path = NULL;										//!< Serial file path.
+	const char *outFile = NULL;										//!< Raw output file path.
+	const char *splitPrefix = NULL;									//!< Section file path prefix.
+	const char *captureFile = NULL;									//!< Capture data file path.
+	std::unique_ptr<Writer> writer;									//!< Raw output file writer.
+	std::unique_ptr<Writer> capData;								//!< Capture data file writer.
+	std::unique_ptr<Writer> capIndex;								//!< Capture index file writer.
+	uint64_t capOffset = 0;											//!< Capture data written so far, in bytes.
+	std::unique_ptr<Splitter> splitter;								//!< Capture section splitter.
+	timespec ts0;													//!< Last data arrival time.
+	uint32_t baud = BAUD_DEFAULT;									//!< Baud rate.
+	int fd = -1;													//!< Serial file descriptor.
+	uint8_t minRead = 1;											//!< VMIN, bytes to wait for before wake up.
+	uint8_t splitFormat = SECTION_FMT_RAW;							//!< Section file format.
+	bool lowLatency = false;										//!< Sets ASYNC_LOW_LATENCY if true.
+};
 
 bool run = true;
+int stopFd = -1;													//eventfd to wake up main loop on interrupt
 
-const char *outFile = NULL, *serialFile = NULL;
-bool haveStdout = false, modeHex = false, showTimestamp = false;
+const char *mergedFile = NULL;
+bool directIo = false, haveStdout = false, modeHex = false, showTimestamp = false;
+size_t writerBufSz = 1024 * 1024;									//raw output file buffer size
+uint32_t syncMs = 0;												//raw output file sync period
+uint8_t syncPolicy = SYNC_NONE;										//raw output file sync policy
+std::vector<Port> ports(1);										//options before first '-i' go here
+std::unique_ptr<Writer> merged;										//merged output file writer
+
+//! Helper function to undo inverted data from target, i.e. (~val &amp; 0x7f), over whole buffer. Works on
+//! machine word at a time, leaving compiler free to vectorise further.
+void decodeData(uint8_t *data, size_t count) {
+	constexpr uint64_t mask = 0x7f7f7f7f7f7f7f7full;
+	size_t i = 0;
+	
+	for (; (i + sizeof(mask)) <= count; i += sizeof(mask)) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		word = ~word & mask;
+		memcpy(data + i, &word, sizeof(word));
+	}
+	
+	for (; i < count; ++i) {
+		data[i] = ~data[i] & 0x7f;
+	}
+}
 
-//! Helper function to parse command-line arguments.
+//! Helper function to render data into output buffer, either as is or as hex.
+//! @return Rendered data size, in bytes.
+size_t formatData(const uint8_t *data, size_t count, bool hex, char *out) {
+	if (!hex) {
+		memcpy(out, data, count);
+		return count;
+	}
+	
+	for (size_t i = 0; i < count; ++i) {
+		memcpy(out + i * 3, hexTable[data[i]].data(), 3);
+	}
+	out[count * 3] = '\n';
+	
+	return count * 3 + 1;
+}
+
+//! Helper function to limit snprintf() result to what actually got into buffer, in case of truncation.
+//! @return Size of string in buffer, negative if error has occurred.
+int clampSz(int count, size_t bufSz) {
+	return (count < int(bufSz)) ? count : int(bufSz) - 1;
+}
+
+//! Helper function to write whole buffer to file descriptor, retrying on partial write.
+//! @return False if error has occurred.
+bool writeAll(int fd, const char *data, size_t count) {
+	while (count) {
+		const ssize_t written = write(fd, data, count);
+		
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		
+		data += written;
+		count -= written;
+	}
+	
+	return true;
+}
+
+//! Helper function to parse command-line arguments. Per-port options apply to port of latest '-i', or first
+//! port if no '-i' is given yet.
 bool parseArgs(int argc, char **args) {
 	int opt;
 	bool result = true;
 	
-	while ((opt = getopt(argc, args, "i:m:o:t")) != -1) {
+	while ((opt = getopt(argc, args, "b:c:df:i:lm:M:o:s:tv:w:y:")) != -1) {
 		switch (opt) {
+			case 'b':
+				try {
+					const unsigned long val = std::stoul(optarg);
+					
+					if (!val || (val > UINT32_MAX)) {
+						printf("Invalid '-b' value '%s'.\n", optarg);
+						result = false;
+					}
+					else {
+						ports.back().baud = val;
+					}
+				}
+				catch (...) {
+					printf("Invalid '-b' value '%s'.\n", optarg);
+					result = false;
+				}
+				break;
+			case 'c':
+				ports.back().captureFile = optarg;
+				break;
+			case 'd':
+				directIo = true;
+				break;
+			case 'f':
+				if (('0' > *optarg) || ('2' < *optarg) || optarg[1]) {
+					printf("Invalid '-f' value '%s'.\n", optarg);
+					result = false;
+				}
+				else {
+					ports.back().splitFormat = *optarg - '0';
+				}
+				break;
 			case 'i':
-				serialFile = optarg;
+				if (ports.size() > UINT8_MAX) {						//port index is used as channel index
+					printf("Too many '-i' arguments.\n");
+					result = false;
+				}
+				else if (ports.back().path) {
+					ports.emplace_back();
+				}
+				ports.back().path = optarg;
+				break;
+			case 'l':
+				ports.back().lowLatency = true;
 				break;
 			case 'm':
 				haveStdout = ('0' != *optarg);
 				modeHex = ('2' == *optarg);
 				break;
+			case 'M':
+				mergedFile = optarg;
+				break;
 			case 'o':
-				outFile = optarg;
+				if (ports.back().outFile) {
+					printf("Multiple '-o' arguments for same serial file.\n");
+					result = false;
+				}
+				ports.back().outFile = optarg;
+				break;
+			case 's':
+				ports.back().splitPrefix = optarg;
 				break;
 			case 't':
 				showTimestamp = true;
 				break;
+			case 'v':
+				try {
+					const unsigned long val = std::stoul(optarg);
+					
+					if (val > 255) {
+						printf("Invalid '-v' value '%s', 0-255 is expected.\n", optarg);
+						result = false;
+					}
+					else {
+						ports.back().minRead = val;
+					}
+				}
+				catch (...) {
+					printf("Invalid '-v' value '%s'.\n", optarg);
+					result = false;
+				}
+				break;
+			case 'w':
+				try {
+					const unsigned long val = std::stoul(optarg);
+					
+					if (!val || (val > (1024 * 1024))) {					//1GiB at most
+						printf("Invalid '-w' value '%s'.\n", optarg);
+						result = false;
+					}
+					else {
+						writerBufSz = val * 1024;
+					}
+				}
+				catch (...) {
+					printf("Invalid '-w' value '%s'.\n", optarg);
+					result = false;
+				}
+				break;
+			case 'y':
+				if (!strcmp(optarg, "none")) {
+					syncPolicy = SYNC_NONE;
+				}
+				else if (!strcmp(optarg, "buffer")) {
+					syncPolicy = SYNC_BUFFER;
+				}
+				else {
+					try {
+						syncMs = std::stoul(optarg);
+						syncPolicy = SYNC_PERIODIC;
+					}
+					catch (...) {
+						printf("Invalid '-y' value '%s'.\n", optarg);
+						result = false;
+					}
+				}
+				break;
 			default:
 				result = false;
 				break;
@@ -47,12 +266,18 @@ bool parseArgs(int argc, char **args) {
 	}
 	
 	if (result) {
-		if (!serialFile) {
+		bool haveOutFile = (mergedFile != NULL);
+		
+		for (const Port &port : ports) {
+			haveOutFile = haveOutFile || port.outFile || port.splitPrefix || port.captureFile;
+		}
+		
+		if (!ports.back().path) {
 			printf("Missing '-i' argument.\n");
 			result = false;
 		}
 		
-		if (!haveStdout && !outFile) {
+		if (!haveStdout && !haveOutFile) {
 			printf("No output is set to console and/or file.\n");
 			result = false;
 		}
@@ -61,38 +286,269 @@ bool parseArgs(int argc, char **args) {
 	if (!result) {
 		printf("Usage:\t%s ", args[0]);
 		printf("<-i target serial file> <-m 0=off (default), 1=ascii, 2=hex> [-o raw output file] [-t]\n");
+		printf("\t[-l low latency mode] [-v bytes to wait for before wake up, 0-255 (default 1)]\n");
+		printf("\t[-M merged timestamped hex output file] [-b baud rate (default %u)]\n", BAUD_DEFAULT);
+		printf("\t[-s logic analyser capture section file prefix]\n");
+		printf("\t[-f section file format: 0=raw (default), 1=ch_data readings, 2=interpreted ch_sample]\n");
+		printf("\t[-w raw output file buffer size, in KiB (default 1024)] [-d O_DIRECT raw output file]\n");
+		printf("\t[-y raw output file sync: none (default), buffer=after every buffer, <ms>=periodic]\n");
+		printf("\t[-c indexed capture file, index goes to '<file>%s']\n", CAPTURE_INDEX_EXT);
+		printf("'-i' may be repeated for multiple serial files.\n");
+		printf("'-o', '-b', '-c', '-f', '-l', '-s' and '-v' apply to latest '-i'.\n");
 	}
 	
 	return result;
 }
 
+//! Helper function to open indexed capture data and index files, and write their headers.
+//! @param[in,out] port Serial port to be captured.
+//! @return False if error has occurred.
+bool openCapture(Port &port) {
+	const std::string indexFile = std::string(port.captureFile) + CAPTURE_INDEX_EXT;
+	capture_header header;
+	timespec ts;
+	
+	port.capData.reset(new(std::nothrow) Writer(writerBufSz, directIo, syncPolicy, syncMs));
+	port.capIndex.reset(new(std::nothrow) Writer(writerBufSz, directIo, syncPolicy, syncMs));
+	if (!port.capData || !port.capIndex) {
+		printf("Error allocating capture file writer for '%s'.\n", port.path);
+		return false;
+	}
+	
+	if (!port.capData->open(port.captureFile) || !port.capIndex->open(indexFile.c_str())) {
+		return false;
+	}
+	
+	memset(&header, 0, sizeof(header));
+	header.version = CAPTURE_VERSION;
+	header.size = sizeof(header);
+	header.baud = port.baud;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	header.startTs = ts.tv_sec * 1000000000ull + ts.tv_nsec;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	header.startRealTs = ts.tv_sec * 1000000000ll + ts.tv_nsec;
+	
+	strcpy(header.magic, CAPTURE_DATA_MAGIC);
+	port.capData->write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+	strcpy(header.magic, CAPTURE_INDEX_MAGIC);
+	port.capIndex->write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+	
+	return true;
+}
+
+//! Helper function to open serial port and set up its access config.
+//! @param[in,out] port Serial port to be opened.
+//! @param[in] portIdx Serial port index.
+//! @return False if error has occurred.
+bool openPort(Port &port, uint8_t portIdx) {
+	port.fd = open(port.path, O_RDWR | O_NOCTTY | O_NONBLOCK);	//readiness is signalled by epoll
+	if (port.fd == -1) {
+		printf("Error opening serial port '%s' for R/W: %s\n", port.path, strerror(errno));
+		return false;
+	}
+	
+	if (port.outFile) {												//written by its own thread
+		port.writer.reset(new(std::nothrow) Writer(writerBufSz, directIo, syncPolicy, syncMs));
+		if (!port.writer) {
+			printf("Error allocating raw output file writer for '%s'.\n", port.path);
+			return false;
+		}
+		else if (!port.writer->open(port.outFile)) {
+			return false;
+		}
+	}
+	
+	if (port.captureFile && !openCapture(port)) {
+		return false;
+	}
+	
+	if (port.splitPrefix) {
+		port.splitter.reset(new(std::nothrow) Splitter(port.splitPrefix, port.splitFormat, portIdx));
+		if (!port.splitter) {
+			printf("Error allocating section splitter for '%s'.\n", port.path);
+			return false;
+		}
+	}
+	
+	termios ttycfg;
+	
+	if (tcgetattr(port.fd, &ttycfg)) {
+		printf("Error getting serial file '%s' access config: %s\n", port.path, strerror(errno));
+		return false;
+	}
+	
+	ttycfg.c_cflag &= ~PARENB;										//no parity
+	ttycfg.c_cflag &= ~CSTOPB;										//1 stop bit
+	ttycfg.c_cflag &= ~CSIZE;										//clear at set to 8-bit data
+	ttycfg.c_cflag |= CS8;
+	ttycfg.c_cflag &= ~CRTSCTS;										//no HW flow control
+	ttycfg.c_cflag |= (CREAD | CLOCAL);								//ignore signal line
+	
+	ttycfg.c_lflag &= ~ICANON;										//non-canonical mode
+	ttycfg.c_lflag &= ~(ISIG | ECHO | ECHOE | ECHONL);				//disable signal chars
+	
+	ttycfg.c_iflag &= ~(IXON | IXOFF | IXANY);						//no SW flow control
+	ttycfg.c_iflag &= ~(IGNBRK|BRKINT|PARMRK|ISTRIP|INLCR|IGNCR|ICRNL);	//no special RX char handling
+	
+	ttycfg.c_oflag &= ~(OPOST | ONLCR);								//no special TX char handling
+	
+	//no inter-byte timer, epoll only reports ready once VMIN bytes are available
+	ttycfg.c_cc[VTIME] = 0;
+	ttycfg.c_cc[VMIN] = port.minRead;
+	
+	cfsetspeed(&ttycfg, B115200);									//actual rate is set below
+	
+	if (tcsetattr(port.fd, TCSANOW, &ttycfg) ) {
+		printf("Error setting serial file '%s' access config: %s\n", port.path, strerror(errno));
+		return false;
+	}
+	
+	uint32_t baud;
+	if (!setBaudRate(port.fd, port.baud, &baud)) {
+		printf("Error setting serial file '%s' baud rate %u: %s\n", port.path, port.baud, strerror(errno));
+		return false;
+	}
+	
+	//driver reports rate it can achieve with its clock divider, too far off will garble data
+	const uint64_t diff = (baud > port.baud) ? (baud - port.baud) : (port.baud - baud);
+	if ((diff * 100u) > (uint64_t(port.baud) * BAUD_TOLERANCE)) {
+		printf("Serial file '%s' baud rate %u is set as %u, beyond %u%% tolerance.\n", port.path, port.baud,
+			baud, BAUD_TOLERANCE);
+		return false;
+	}
+	else if (diff) {
+		printf("Warning: serial file '%s' baud rate %u is set as %u.\n", port.path, port.baud, baud);
+	}
+	
+	if (port.lowLatency) {											//not all drivers support it, e.g. pty
+		serial_struct serCfg;
+		bool isSet = !ioctl(port.fd, TIOCGSERIAL, &serCfg);
+		
+		if (isSet) {
+			serCfg.flags |= ASYNC_LOW_LATENCY;
+			isSet = !ioctl(port.fd, TIOCSSERIAL, &serCfg);
+		}
+		
+		if (!isSet) {
+			printf("Warning: low latency mode not set for '%s': %s\n", port.path, strerror(errno));
+		}
+	}
+	
+	return true;
+}
+
+//! Helper function to read all available data from serial port and pass it to outputs.
+//! @param[in] port Serial port with data available.
+//! @param[in] portIdx Serial port index.
+//! @param[in] ts1 Data arrival time.
+//! @param[in] dataR Read data buffer, \ref INPUT_BUF_SZ in size.
+//! @param[in] dataW Output data buffer, \ref OUTPUT_BUF_SZ in size.
+//! @return False if serial port can't be read anymore.
+bool readPort(Port &port, size_t portIdx, const timespec &ts1, uint8_t *dataR, char *dataW) {
+	ssize_t count;
+	
+	while ((count = read(port.fd, dataR, INPUT_BUF_SZ)) > 0) {			//drain all available data
+		decodeData(dataR, count);
+		
+		if (haveStdout) {
+			//rendered right after timestamp space, then prefix is placed just before it
+			char *body = dataW + TIMESTAMP_SZ, *head = body;
+			const size_t bodySz = formatData(dataR, count, modeHex, body);
+			char prefix[TIMESTAMP_SZ];
+			int prefixSz = 0;
+			
+			if (showTimestamp) {
+				const double diffMs = (ts1.tv_sec + ts1.tv_nsec * 1e-9) -
+					(port.ts0.tv_sec + port.ts0.tv_nsec * 1e-9);
+				port.ts0 = ts1;
+				
+				prefixSz = clampSz(snprintf(prefix, sizeof(prefix), "%7.4f: ", diffMs), sizeof(prefix));
+			}
+			if ((ports.size() > 1) && (prefixSz >= 0)) {				//tells ports apart
+				prefixSz += snprintf(prefix + prefixSz, sizeof(prefix) - prefixSz, "[%zu] ", portIdx);
+				prefixSz = clampSz(prefixSz, sizeof(prefix));
+			}
+			
+			if (prefixSz > 0) {
+				head -= prefixSz;
+				memcpy(head, prefix, prefixSz);
+			}
+			
+			if (!writeAll(STDOUT_FILENO, head, body + bodySz - head)) {
+				printf("Error writing console output: %s\n", strerror(errno));
+			}
+		}
+		
+		if (port.writer) {
+			port.writer->write(dataR, count);
+		}
+		
+		if (port.splitter) {
+			port.splitter->proc(dataR, count);
+		}
+		
+		if (port.capData) {											//1 index entry per read
+			const capture_index entry = {.ts = ts1.tv_sec * 1000000000ull + ts1.tv_nsec,
+				.offset = port.capOffset};
+			
+			port.capIndex->write(reinterpret_cast<const uint8_t*>(&entry), sizeof(entry));
+			port.capData->write(dataR, count);
+			port.capOffset += count;
+		}
+		
+		if (merged) {
+			char *body = dataW + TIMESTAMP_SZ, *head = body;
+			const size_t bodySz = formatData(dataR, count, true, body);
+			char prefix[TIMESTAMP_SZ];
+			const int prefixSz = clampSz(snprintf(prefix, sizeof(prefix), "%lld.%09ld %zu: ",
+				(long long) ts1.tv_sec, ts1.tv_nsec, portIdx), sizeof(prefix));
+			
+			if (prefixSz > 0) {
+				head -= prefixSz;
+				memcpy(head, prefix, prefixSz);
+			}
+			merged->write(reinterpret_cast<const uint8_t*>(head), body + bodySz - head);
+		}
+	}
+	
+	if ((count < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+		printf("Error reading serial file '%s': %s\n", port.path, strerror(errno));
+		return false;
+	}
+	
+	return true;
+}
+
 int main(int argc, char **args) {
 	bool result = parseArgs(argc, args);
 	
-	std::ofstream ostrm;
 	uint8_t *dataR = NULL;
-	int fd = -1;
+	char *dataW = NULL;
 	
 	if (result) {
 		dataR = (uint8_t*) malloc(INPUT_BUF_SZ);
-		fd = open(serialFile, O_RDWR);
+		dataW = (char*) malloc(OUTPUT_BUF_SZ);
 		
-		if (!dataR) {
-			printf("Error allocating read data buffer.\n");
-			result = false;
-		}
-		if (fd == -1) {
-			printf("Error opening serial port for R/W: %s\n", strerror(errno));
+		if (!dataR || !dataW) {
+			printf("Error allocating data buffer.\n");
 			result = false;
 		}
 	}
 	
-	if (result && outFile) {
-		ostrm.open(outFile, std::ios::out | std::ios::binary);
-		if (!ostrm) {
-			printf("Error opening raw output file '%s'.", outFile);
+	for (size_t portIdx = 0; result && (portIdx < ports.size()); ++portIdx) {
+		result = openPort(ports[portIdx], portIdx);
+	}
+	
+	if (result && mergedFile) {										//text log, so page cache and no sync
+		merged.reset(new(std::nothrow) Writer(writerBufSz, false, SYNC_NONE, 0));
+		if (!merged) {
+			printf("Error allocating merged output file writer.\n");
 			result = false;
 		}
+		else {
+			result = merged->open(mergedFile);
+		}
 	}
 	
 	if (result) {													//Ctrl-C and 'kill' interrupt handler
@@ -100,123 +556,147 @@ int main(int argc, char **args) {
 		
 		sigemptyset(&sigProp.sa_mask);
 		sigProp.sa_handler = [](int code) {
+			const uint64_t val = 1;
+			
 			printf("Got interrupt '%d'.\n", code);
 			run = false;
+			if (write(stopFd, &val, sizeof(val)) < 0) {}				//main loop will see 'run' anyway
 		};
 		sigProp.sa_flags = 0;
 		
-		if (sigaction(SIGINT, &sigProp, nullptr)) {
+		stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (stopFd == -1) {
+			printf("Error creating interrupt event: %s\n", strerror(errno));
+			result = false;
+		}
+		else if (sigaction(SIGINT, &sigProp, nullptr)) {
 			printf("Error setting up interrupt handler.\n");
 			result = false;
 		}
 	}
 	
+	int pollFd = -1;
 	if (result) {
-		termios ttycfg;
+		epoll_event event;
 		
-		if (tcgetattr(fd, &ttycfg)) {
-			printf("Error getting serial file access config: %s\n", strerror(errno));
+		pollFd = epoll_create1(EPOLL_CLOEXEC);
+		if (pollFd == -1) {
+			printf("Error creating epoll instance: %s\n", strerror(errno));
 			result = false;
 		}
 		else {
-			ttycfg.c_cflag &= ~PARENB;								//no parity
-			ttycfg.c_cflag &= ~CSTOPB;								//1 stop bit
-			ttycfg.c_cflag &= ~CSIZE;								//clear at set to 8-bit data
-			ttycfg.c_cflag |= CS8;
-			ttycfg.c_cflag &= ~CRTSCTS;								//no HW flow control
-			ttycfg.c_cflag |= (CREAD | CLOCAL);						//ignore signal line
+			event.events = EPOLLIN;
+			event.data.u64 = ports.size();							//past last port index
+			result = !epoll_ctl(pollFd, EPOLL_CTL_ADD, stopFd, &event);
 			
-			ttycfg.c_lflag &= ~ICANON;								//non-canonical mode
-			ttycfg.c_lflag &= ~(ISIG | ECHO | ECHOE | ECHONL);		//disable signal chars
-			
-			ttycfg.c_iflag &= ~(IXON | IXOFF | IXANY);				//no SW flow control
-			ttycfg.c_iflag &= ~(IGNBRK|BRKINT|PARMRK|ISTRIP|INLCR|IGNCR|ICRNL);	//no special RX char handling
-			
-			ttycfg.c_oflag &= ~(OPOST | ONLCR);						//no special TX char handling
-			
-			ttycfg.c_cc[VTIME] = 1;									//wait for data with 1sec timeout
-			ttycfg.c_cc[VMIN] = 0;
-			
-			cfsetspeed(&ttycfg, B115200);
+			for (size_t portIdx = 0; result && (portIdx < ports.size()); ++portIdx) {
+				event.events = EPOLLIN;
+				event.data.u64 = portIdx;
+				result = !epoll_ctl(pollFd, EPOLL_CTL_ADD, ports[portIdx].fd, &event);
+			}
 			
-			if (tcsetattr(fd, TCSANOW, &ttycfg) ) {
-				printf("Error setting serial file access config: %s\n", strerror(errno));
-				result = false;
+			if (!result) {
+				printf("Error adding file to epoll instance: %s\n", strerror(errno));
 			}
 		}
 	}
 	
 	if (result) {
-		std::ostringstream strm;
-		if (modeHex) {
-			strm << std::hex << std::uppercase;
-		}
+		std::vector<epoll_event> events(ports.size() + 1);
+		size_t openQt = ports.size();
+		int timeout = -1;
+		timespec ts1;
 		
-		timespec delay = {.tv_sec = 0, .tv_nsec = 100'000'000}, ts0, ts1;
-		timespec_get(&ts0, TIME_UTC);
+		clock_gettime(CLOCK_MONOTONIC, &ts1);
+		for (Port &port : ports) {
+			port.ts0 = ts1;
+			if (port.writer || port.capData || merged) {			//partial buffer is flushed when idle
+				timeout = 1000;
+			}
+		}
 		
-		while (run) {
-			const ssize_t count = read(fd, dataR, INPUT_BUF_SZ);
+		while (run && openQt) {
+			const int eventQt = epoll_wait(pollFd, events.data(), events.size(), timeout);
 			
-			if (count > 0) {
-				for (ssize_t i = 0; i < count; ++i) {
-					const uint8_t val = (~dataR[i] & 0x7f);
-					
-					if (haveStdout) {
-						if (modeHex) {
-							strm << std::setw(2) << std::setfill('0') << (uint32_t) val << ' ';
-						}
-						else {
-							strm << val;
-						}
-					}
-					
-					if (outFile) {
-						ostrm << val;
-					}
+			if (eventQt < 0) {
+				if (errno != EINTR) {
+					printf("Error waiting for serial data: %s\n", strerror(errno));
+					break;
 				}
-				
-				if (haveStdout) {
-					if (showTimestamp) {
-						timespec_get(&ts1, TIME_UTC);
-						const double diffMs = (ts1.tv_sec + ts1.tv_nsec * 1e-9) -
-							(ts0.tv_sec + ts0.tv_nsec * 1e-9);
-						ts0 = ts1;
-						
-						if (modeHex) {
-							printf("%7.4f: %s\n", diffMs, strm.str().c_str());
-						}
-						else {
-							printf("%7.4f: %s", diffMs, strm.str().c_str());
-						}
-					}
-					else {
-						if (modeHex) {
-							puts(strm.str().c_str());
-						}
-						else {
-							printf("%s", strm.str().c_str());
-						}
-					}
-					
-					strm.str("");
+				continue;
+			}
+			clock_gettime(CLOCK_MONOTONIC, &ts1);						//data arrival time
+			
+			for (Port &port : ports) {
+				if (port.writer) {
+					port.writer->idle(ts1);
+				}
+				if (port.capData) {
+					port.capData->idle(ts1);
+					port.capIndex->idle(ts1);
 				}
 			}
-			else if (( count < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
-				printf("Error reading serial file: %s\n", strerror(errno));
+			if (merged) {
+				merged->idle(ts1);
+			}
+			
+			for (int eventIdx = 0; eventIdx < eventQt; ++eventIdx) {
+				const size_t portIdx = events[eventIdx].data.u64;
+				
+				if (portIdx >= ports.size()) {
+					run = false;
+					continue;
+				}
+				
+				Port &port = ports[portIdx];
+				bool isOpen = readPort(port, portIdx, ts1, dataR, dataW);
+				
+				if (isOpen && (events[eventIdx].events & (EPOLLERR | EPOLLHUP))) {
+					printf("Serial port '%s' closed.\n", port.path);
+					isOpen = false;
+				}
+				
+				if (!isOpen) {											//keep servicing other ports
+					epoll_ctl(pollFd, EPOLL_CTL_DEL, port.fd, NULL);
+					--openQt;
+				}
 			}
-			else {
-				nanosleep(&delay, NULL);
+		}
+	}
+	
+	if (pollFd != -1) {
+		close(pollFd);
+	}
+	
+	if (stopFd != -1) {
+		close(stopFd);
+	}
+	
+	for (Port &port : ports) {
+		if (port.fd != -1) {
+			close(port.fd);
+		}
+		
+		//last data is written out here, rather than in static destruction, so errors count for exit status
+		for (Writer *writer : {port.writer.get(), port.capData.get(), port.capIndex.get()}) {
+			if (writer && !writer->close()) {
+				result = false;
 			}
 		}
 	}
+	ports.clear();
+	
+	if (merged && !merged->close()) {
+		result = false;
+	}
+	merged.reset();
 	
 	if (dataR) {
 		free(dataR);
 	}
 	
-	if (fd != -1) {
-		close(fd);
+	if (dataW) {
+		free(dataW);
 	}
 	
 	return result ? 0 : -1;
@@ -0,0 +1,60 @@
+#include "rle.h"
+
+#include <cstring>
+
+RleDecoder::RleDecoder() {
+	reset();
+}
+
+size_t RleDecoder::decode(const uint8_t *&data, size_t &count, uint8_t *out, size_t outSz) {
+	size_t len = 0;
+	
+	while (len < outSz) {
+		if (run) {													//finish pending run first
+			const size_t repeat = ((outSz - len) < run) ? (outSz - len) : run;
+			
+			memset(out + len, last, repeat);
+			len += repeat;
+			run -= repeat;
+			continue;
+		}
+		
+		if (!count) {
+			break;
+		}
+		
+		const uint8_t val = *data;
+		++data;
+		--count;
+		
+		if (!(val & RLE_RUN_FLAG)) {
+			last = val & RLE_MAX_SAMPLE;
+			out[len++] = last;
+			continue;
+		}
+		
+		if (runShift < 32u) {										//longer run is corrupted anyway
+			runAcc |= (uint32_t) (val & ((1u << RLE_RUN_BITS) - 1u)) << runShift;
+		}
+		runShift += RLE_RUN_BITS;
+		
+		if (!(val & RLE_RUN_MORE)) {
+			run = runAcc;
+			runAcc = 0;
+			runShift = 0;
+		}
+	}
+	
+	return len;
+}
+
+bool RleDecoder::isPending() const {
+	return run;
+}
+
+void RleDecoder::reset() {
+	run = 0;
+	runAcc = 0;
+	runShift = 0;
+	last = 0;
+}
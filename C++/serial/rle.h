@@ -0,0 +1,43 @@
+#ifndef RLE_H
+#define RLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+//! Run-length encoded symbols, must match firmware side in C/utilities/utilities.h.
+#define RLE_RUN_FLAG		0x40u									//!< Set: run symbol, clear: literal sample.
+#define RLE_RUN_MORE		0x20u									//!< Set: more run symbols follow.
+#define RLE_RUN_BITS		5u										//!< Run length bits per run symbol.
+#define RLE_MAX_SAMPLE		0x3Fu									//!< Largest sample value as literal.
+
+//! Streaming decoder of run-length encoded logic analyser payload. Literal symbol is sample as is, run symbols
+//! (LSB first, 5 bits each) repeat last sample. Symbols may be split anywhere between calls, and long runs are
+//! expanded over as many calls as output space needs.
+class RleDecoder {
+public:
+	//! Constructor.
+	RleDecoder();
+	
+	//! Decodes symbols into samples, until either input runs out or output is full.
+	//! @param[in,out] data Encoded symbols, advanced past consumed symbols.
+	//! @param[in,out] count Symbol count, reduced by consumed symbols.
+	//! @param[out] out Decoded samples.
+	//! @param[in] outSz Output size, in samples.
+	//! @return Decoded sample count.
+	size_t decode(const uint8_t *&data, size_t &count, uint8_t *out, size_t outSz);
+	
+	//! Getter for decoder status.
+	//! @return True if decoded samples are still pending output, without further input.
+	bool isPending() const;
+	
+	//! Resets decoder, before each encoded stream.
+	void reset();
+	
+private:
+	uint32_t run;													//!< Decoded repeats pending output.
+	uint32_t runAcc;												//!< Run length collected so far.
+	uint8_t runShift;												//!< Bit position of next run symbol.
+	uint8_t last;													//!< Last literal sample.
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "splitter.h"
+
+#include <cstdio>
+#include <cstring>
+
+//! Longest valid marker, with all values at 10 digits.
+#define MARKER_MAX_SZ 80
+
+//! Decoded sample buffer size, for run-length encoded payload.
+#define DECODE_BUF_SZ 256
+
+Splitter::Splitter(const char *prefix, uint8_t format, uint8_t channel) : prefix(prefix) {
+	memset(params, 0, sizeof(params));
+	memset(&reading, 0, sizeof(reading));
+	remain = 0;
+	this->channel = channel;
+	this->format = format;
+	readingQt = 0;
+	hasStart = false;
+	isEncoded = false;
+	marker.reserve(MARKER_MAX_SZ);
+}
+
+Splitter::~Splitter() {
+	if (remain) {
+		printf("Section '%s' closed with %u sample(s) missing.\n", prefix.c_str(), remain);
+	}
+}
+
+void Splitter::proc(const uint8_t *data, size_t count) {
+	uint8_t decoded[DECODE_BUF_SZ];
+	
+	while (count || decoder.isPending()) {
+		if (remain) {
+			size_t len;
+			
+			if (isEncoded) {										//payload is decoded into samples first
+				len = decoder.decode(data, count, decoded, (remain < sizeof(decoded)) ? remain :
+					sizeof(decoded));
+				writePayload(decoded, len);
+			}
+			else {													//payload goes to file as is
+				len = (count < remain) ? count : remain;
+				writePayload(data, len);
+				data += len;
+				count -= len;
+			}
+			remain -= len;
+			
+			if (!remain) {
+				flushReading();
+				ostrm.close();
+				decoder.reset();									//drops run overshooting section
+				printf("Section base:%u count:%u sample:%u rate:%u saved.\n", params[0], params[1], params[2],
+					params[3]);
+			}
+			continue;
+		}
+		
+		const char val = *data;
+		++data;
+		--count;
+		
+		if (val == '{') {											//(re)starts candidate
+			marker.assign(1, val);
+		}
+		else if (!marker.empty()) {
+			marker.push_back(val);
+			
+			if (val == '}') {
+				procMarker();
+				marker.clear();
+			}
+			else if (marker.size() >= MARKER_MAX_SZ) {
+				marker.clear();
+			}
+		}
+	}
+}
+
+void Splitter::flushReading() {
+	if (!readingQt) {
+		return;
+	}
+	
+	if (format == SECTION_FMT_READING) {
+		ostrm.write(reinterpret_cast<const char*>(&reading), sizeof(reading));
+	}
+	else {
+		samples.clear();
+		if (interpretData(channel, &reading, samples, sizeof(ch_sample) * (SAMPLE_PER_READING + 1u))) {
+			for (const uint8_t val : samples) {
+				ostrm.put(val);
+			}
+		}
+	}
+	
+	reading.tag = reading.tag + 1u;									//may overflow to 0 as in USB path
+	reading.valid = 0u;
+	memset(reading.data, 0, sizeof(reading.data));
+	readingQt = 0;
+}
+
+void Splitter::procMarker() {
+	uint32_t vals[4];
+	char kind[6];
+	int len = 0;
+	
+	if ((sscanf(marker.c_str(), "{base:%u count:%u sample:%u rate:%u %5[a-z]}%n", &vals[0], &vals[1],
+	&vals[2], &vals[3], kind, &len) != 5) || (len != (int) marker.size())) {
+		return;
+	}
+	
+	if (!strcmp(kind, "start") || !strcmp(kind, "rle")) {
+		static const char *exts[] = {".bin", ".rdg", ".smp"};
+		const std::string path = prefix + "_" + std::to_string(vals[0]) + "_" + std::to_string(vals[1]) + "_" +
+			std::to_string(vals[2]) + "_" + std::to_string(vals[3]) + exts[format];
+		
+		memcpy(params, vals, sizeof(params));
+		hasStart = true;
+		isEncoded = !strcmp(kind, "rle");
+		decoder.reset();
+		
+		//every section starts from tag 0, with fresh interpreter timestamp
+		memset(&reading, 0, sizeof(reading));
+		readingQt = 0;
+		if ((format == SECTION_FMT_SAMPLE) && !resetInterpreter(channel)) {
+			printf("Error resetting data interpreter for section file '%s'.\n", path.c_str());
+		}
+		
+		ostrm.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!ostrm) {
+			printf("Error opening section file '%s'.\n", path.c_str());
+		}
+		else if (vals[2]) {
+			remain = vals[2];
+		}
+		else {
+			ostrm.close();
+		}
+	}
+	else if (!strcmp(kind, "end")) {								//payload is delimited by sample count
+		if (!hasStart || memcmp(params, vals, sizeof(params))) {
+			printf("Section end marker base:%u count:%u sample:%u rate:%u doesn't match start marker.\n",
+				vals[0], vals[1], vals[2], vals[3]);
+		}
+		hasStart = false;
+	}
+}
+
+void Splitter::writePayload(const uint8_t *data, size_t count) {
+	if (format == SECTION_FMT_RAW) {
+		ostrm.write(reinterpret_cast<const char*>(data), count);
+		return;
+	}
+	
+	for (size_t i = 0; i < count; ++i) {							//MSB->LSB valid bits = low->high index
+		reading.data[readingQt] = data[i];
+		reading.valid = reading.valid | (0b1000u >> readingQt);
+		
+		if (++readingQt >= SAMPLE_PER_READING) {
+			flushReading();
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#ifndef SPLITTER_H
+#define SPLITTER_H
+
+#include "data_tools.h"
+#include "rle.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+
+//! Section file formats.
+#define SECTION_FMT_RAW			0u									//!< Payload as is, 1 byte per sample.
+#define SECTION_FMT_READING		1u									//!< Packed into \ref ch_data readings.
+#define SECTION_FMT_SAMPLE		2u									//!< Interpreted into \ref ch_sample.
+
+//! Streaming splitter of logic analyser capture sections, i.e. "{base:%u count:%u sample:%u rate:%u start}",
+//! sample payload, then matching "end" marker. Start marker kind "rle" instead of "start" has run-length
+//! encoded payload, which is decoded here. Each section payload is written to its own file as it arrives,
+//! anything outside sections is dropped. Payload may be packed into same readings (or samples) format as USB
+//! path, to share downstream tools.
+class Splitter {
+public:
+	//! Constructor.
+	//! @param[in] prefix Section file path prefix. Section file is named
+	//!						"<prefix>_<base>_<count>_<sample>_<rate>.<bin|rdg|smp>" as per \b format.
+	//! @param[in] format One of SECTION_FMT_* values.
+	//! @param[in] channel Channel index used for data interpreter, must be unique per splitter.
+	Splitter(const char *prefix, uint8_t format, uint8_t channel);
+	
+	//! Destructor. Section that is still open is kept as is.
+	virtual ~Splitter();
+	
+	//! Processes decoded serial data.
+	//! @param[in] data Decoded serial data.
+	//! @param[in] count Data size, in bytes.
+	void proc(const uint8_t *data, size_t count);
+	
+private:
+	//! Helper function to write out pending reading, as per section file format.
+	void flushReading();
+	
+	//! Helper function to handle complete marker candidate.
+	void procMarker();
+	
+	//! Helper function to write section payload, as per section file format.
+	//! @param[in] data Payload data.
+	//! @param[in] count Payload size, in bytes.
+	void writePayload(const uint8_t *data, size_t count);
+	
+	ch_data reading;												//!< Pending reading to be filled.
+	std::deque<uint8_t> samples;									//!< Interpreted samples storage.
+	std::ofstream ostrm;											//!< Current section file stream.
+	std::string marker;												//!< Marker candidate collected so far.
+	std::string prefix;												//!< Section file path prefix.
+	RleDecoder decoder;												//!< Run-length encoded payload decoder.
+	uint32_t params[4];												//!< Start marker base, count, sample, rate.
+	uint32_t remain;												//!< Remaining payload samples in section.
+	uint8_t channel;												//!< Data interpreter channel index.
+	uint8_t format;													//!< One of SECTION_FMT_* values.
+	uint8_t readingQt;												//!< Sample count in \ref reading.
+	bool hasStart;													//!< Start marker has been seen.
+	bool isEncoded;													//!< Section payload is run-length encoded.
+};
+
+#endif
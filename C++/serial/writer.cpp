@@ -0,0 +1,244 @@
+#include "writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+//! O_DIRECT alignment, for buffer address, size and file offset.
+#define DIRECT_ALIGN 4096u
+
+//! Partially filled buffer is handed over after pending this long, in ms.
+#define IDLE_FLUSH_MS 1000u
+
+//! Helper function to get elapsed time between 2 time points.
+//! @return Elapsed time, in ms.
+static uint64_t elapsedMs(const timespec &from, const timespec &to) {
+	return (to.tv_sec - from.tv_sec) * 1000ll + (to.tv_nsec - from.tv_nsec) / 1000000ll;
+}
+
+Writer::Writer(size_t bufSz, bool direct, uint8_t syncPolicy, uint32_t syncMs) {
+	this->bufSz = (bufSz + DIRECT_ALIGN - 1u) / DIRECT_ALIGN * DIRECT_ALIGN;
+	this->direct = direct;
+	this->syncPolicy = syncPolicy;
+	this->syncMs = syncMs;
+	
+	buf = NULL;
+	bufQt = 0;
+	fd = -1;
+	failed = false;
+	lastSync = {};
+	pendingTs = {};
+}
+
+Writer::~Writer() {
+	close();
+	
+	for (size_t i = 0; i < bufQt; ++i) {
+		free(bufs[i]->data);
+		delete bufs[i];
+	}
+}
+
+Writer::Buffer* Writer::allocBuf() {
+	if (bufQt >= WRITER_MAX_BUFS) {
+		return NULL;
+	}
+	
+	Buffer *result = new(std::nothrow) Buffer;
+	
+	if (result) {
+		if (posix_memalign(reinterpret_cast<void**>(&result->data), DIRECT_ALIGN, bufSz)) {
+			delete result;
+			return NULL;
+		}
+		
+		result->size = 0;
+		bufs[bufQt++] = result;
+	}
+	
+	return result;
+}
+
+bool Writer::close() {
+	bool result = true;
+	
+	if (thread.joinable()) {
+		running.store(false);
+		pending.fetch_add(1u);
+		pending.notify_one();
+		thread.join();
+		
+		//writer thread is gone, what's left can be written here
+		Buffer *full;
+		while (fullBufs.pop(full)) {
+			writeBuf(full, false);
+		}
+		if (buf && buf->size) {
+			writeBuf(buf, true);
+		}
+		
+		if ((syncPolicy != SYNC_NONE) && fdatasync(fd)) {
+			printf("Error syncing output file '%s': %s\n", path.c_str(), strerror(errno));
+			result = false;
+		}
+	}
+	
+	if (fd != -1) {
+		if (::close(fd)) {
+			printf("Error closing output file '%s': %s\n", path.c_str(), strerror(errno));
+			result = false;
+		}
+		fd = -1;
+	}
+	
+	return result && !failed;
+}
+
+void Writer::handOver() {
+	fullBufs.push(buf);												//can't be full, pool is same size
+	pending.fetch_add(1u, std::memory_order_release);
+	pending.notify_one();
+	
+	if (freeBufs.pop(buf)) {
+		return;
+	}
+	
+	buf = allocBuf();
+	if (buf) {
+		printf("Warning: output file '%s' falls behind, using %zu buffer(s).\n", path.c_str(), bufQt);
+		return;
+	}
+	
+	//last resort, rather block than drop data, sleeping until writer thread frees buffer
+	printf("Warning: output file '%s' falls behind, waiting for storage.\n", path.c_str());
+	uint32_t seen = freed.load(std::memory_order_acquire);
+	while (!freeBufs.pop(buf)) {
+		freed.wait(seen, std::memory_order_acquire);				//returns once counter moves
+		seen = freed.load(std::memory_order_acquire);
+	}
+}
+
+void Writer::idle(const timespec &now) {
+	if (!direct && buf->size && (elapsedMs(pendingTs, now) >= IDLE_FLUSH_MS)) {
+		handOver();
+	}
+}
+
+bool Writer::open(const char *path) {
+	this->path = path;
+	
+	fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | (direct ? O_DIRECT : 0), 0644);
+	if (fd == -1) {
+		printf("Error opening output file '%s': %s\n", path, strerror(errno));
+		return false;
+	}
+	
+	//double buffering to begin with
+	Buffer *spare = allocBuf();
+	buf = allocBuf();
+	if (!buf || !spare) {
+		printf("Error allocating output file '%s' buffer.\n", path);
+		return false;
+	}
+	freeBufs.push(spare);
+	
+	clock_gettime(CLOCK_MONOTONIC, &lastSync);
+	running.store(true);
+	try {
+		thread = std::thread(&Writer::proc, this);
+	}
+	catch (...) {
+		printf("Error starting output file '%s' writer thread.\n", path);
+		running.store(false);
+		return false;
+	}
+	
+	return true;
+}
+
+void Writer::proc() {
+	uint32_t seen = 0;
+	
+	while (true) {
+		Buffer *full;
+		
+		while (fullBufs.pop(full)) {
+			writeBuf(full, false);
+			full->size = 0;
+			freeBufs.push(full);
+			freed.fetch_add(1u, std::memory_order_release);
+			freed.notify_one();
+		}
+		
+		if (!running.load()) {
+			break;
+		}
+		
+		pending.wait(seen, std::memory_order_acquire);				//returns once counter moves
+		seen = pending.load(std::memory_order_acquire);
+	}
+}
+
+void Writer::write(const uint8_t *data, size_t count) {
+	while (count) {
+		if (!buf->size) {
+			clock_gettime(CLOCK_MONOTONIC, &pendingTs);
+		}
+		
+		const size_t len = ((bufSz - buf->size) < count) ? (bufSz - buf->size) : count;
+		
+		memcpy(buf->data + buf->size, data, len);
+		buf->size += len;
+		data += len;
+		count -= len;
+		
+		if (buf->size >= bufSz) {
+			handOver();
+		}
+	}
+}
+
+void Writer::writeBuf(const Buffer *buf, bool last) {
+	if (failed) {
+		return;
+	}
+	
+	if (last && direct && (buf->size % DIRECT_ALIGN)) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+	}
+	
+	size_t done = 0;
+	while (done < buf->size) {
+		const ssize_t count = ::write(fd, buf->data + done, buf->size - done);
+		
+		if (count < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			
+			printf("Error writing output file '%s': %s\n", path.c_str(), strerror(errno));
+			failed = true;
+			return;
+		}
+		
+		done += count;
+	}
+	
+	if (syncPolicy == SYNC_BUFFER) {
+		fdatasync(fd);
+	}
+	else if (syncPolicy == SYNC_PERIODIC) {
+		timespec now;
+		
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (elapsedMs(lastSync, now) >= syncMs) {
+			fdatasync(fd);
+			lastSync = now;
+		}
+	}
+}
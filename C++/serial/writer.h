@@ -0,0 +1,138 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <thread>
+
+//! fdatasync() policies, used in \ref Writer.
+#define SYNC_NONE		0u											//!< Left to OS.
+#define SYNC_BUFFER		1u											//!< After every buffer written.
+#define SYNC_PERIODIC	2u											//!< At most once per sync period.
+
+//! Writer buffer pool size limit. Buffers are added beyond double buffering only when storage falls behind.
+#define WRITER_MAX_BUFS	64u
+
+//! Lock-free single producer, single consumer queue.
+//! @tparam T Element type.
+//! @tparam N Capacity, must be power of 2.
+template<class T, size_t N> class SpscQueue {
+	static_assert(N && !(N & (N - 1)), "Capacity must be power of 2.");
+	
+public:
+	//! Adds element. Producer side only.
+	//! @return False if queue is full.
+	bool push(const T &val) {
+		const size_t tail = this->tail.load(std::memory_order_relaxed);
+		
+		if ((tail - head.load(std::memory_order_acquire)) >= N) {
+			return false;
+		}
+		
+		elems[tail & (N - 1)] = val;
+		this->tail.store(tail + 1, std::memory_order_release);
+		
+		return true;
+	}
+	
+	//! Removes oldest element. Consumer side only.
+	//! @return False if queue is empty.
+	bool pop(T &val) {
+		const size_t head = this->head.load(std::memory_order_relaxed);
+		
+		if (head == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		
+		val = elems[head & (N - 1)];
+		this->head.store(head + 1, std::memory_order_release);
+		
+		return true;
+	}
+	
+private:
+	std::array<T, N> elems;
+	alignas(64) std::atomic<size_t> head{0};						//!< Consumer position.
+	alignas(64) std::atomic<size_t> tail{0};						//!< Producer position.
+};
+
+//! Asynchronous file writer. Data is copied into large aligned buffers by caller, and full buffers are written
+//! out by writer thread, so caller never waits for storage.
+class Writer {
+public:
+	//! Constructor. Call \ref open() before use.
+	//! @param[in] bufSz Buffer size, in bytes. Rounded up to multiple of 4KiB for O_DIRECT.
+	//! @param[in] direct True to bypass page cache with O_DIRECT.
+	//! @param[in] syncPolicy One of SYNC_* values.
+	//! @param[in] syncMs Sync period for \ref SYNC_PERIODIC, in ms.
+	Writer(size_t bufSz, bool direct, uint8_t syncPolicy, uint32_t syncMs);
+	
+	//! Destructor. Calls \ref close() if not done yet.
+	virtual ~Writer();
+	
+	//! Writes out remaining data, waits for writer thread and closes output file. No more data may be added.
+	//! @return False if any write, sync or close error has occurred.
+	bool close();
+	
+	//! Hands over partially filled buffer to writer thread if it has been pending for too long. Not done with
+	//! O_DIRECT as partial write would break alignment of following writes.
+	//! @param[in] now Current CLOCK_MONOTONIC time.
+	void idle(const timespec &now);
+	
+	//! Opens output file and starts writer thread.
+	//! @param[in] path Output file path.
+	//! @return False if error has occurred.
+	bool open(const char *path);
+	
+	//! Adds data to be written.
+	//! @param[in] data Data to be written.
+	//! @param[in] count Data size, in bytes.
+	void write(const uint8_t *data, size_t count);
+	
+private:
+	//! Single data buffer.
+	struct Buffer {
+		uint8_t *data;												//!< Aligned buffer memory.
+		size_t size;												//!< Filled data size, in bytes.
+	};
+	
+	//! Helper function to allocate new buffer.
+	//! @return Buffer pointer, NULL if error has occurred.
+	Buffer* allocBuf();
+	
+	//! Helper function to hand over current buffer to writer thread and get free one.
+	void handOver();
+	
+	//! Writer thread loop.
+	void proc();
+	
+	//! Helper function to write buffer to file.
+	//! @param[in] buf Buffer to be written.
+	//! @param[in] last True if this is final write, where O_DIRECT is dropped for unaligned size.
+	void writeBuf(const Buffer *buf, bool last);
+	
+	SpscQueue<Buffer*, WRITER_MAX_BUFS> fullBufs;					//!< Buffers to be written.
+	SpscQueue<Buffer*, WRITER_MAX_BUFS> freeBufs;					//!< Buffers written out.
+	std::atomic<uint32_t> pending{0};								//!< Wake up counter for writer thread.
+	std::atomic<uint32_t> freed{0};									//!< Wake up counter for caller.
+	std::atomic<bool> running{false};								//!< Writer thread keeps running if set.
+	std::string path;												//!< Output file path.
+	std::thread thread;												//!< Writer thread.
+	timespec lastSync;												//!< Last fdatasync() time.
+	timespec pendingTs;												//!< Time current buffer got its first data.
+	Buffer *buf;													//!< Buffer being filled by caller.
+	Buffer *bufs[WRITER_MAX_BUFS];									//!< All allocated buffers, for freeing.
+	size_t bufQt;													//!< Allocated buffer count.
+	size_t bufSz;													//!< Buffer size, in bytes.
+	uint32_t syncMs;												//!< Sync period, in ms.
+	int fd;															//!< Output file descriptor.
+	uint8_t syncPolicy;												//!< One of SYNC_* values.
+	bool direct;													//!< O_DIRECT is used if set.
+	bool failed;													//!< Write error has occurred.
+};
+
+#endif
@@ -17,6 +17,68 @@ static_assert(std::endian::native == std::endian::little, "Data format is expect
 #define SAMPLE_PER_READING		4u
 #define TAG_BITS				28u
 
+//! Gap marker sample timestamp, used in \ref ch_sample. Never reached by actual sample.
+#define INTERP_GAP_TS			((1ull << 56u) - 1u)
+//! Consecutive late readings after which interpreter treats them as new tag sequence (e.g. device restarted).
+#define INTERP_RESYNC_COUNT		4u
+
+//! Display decimation modes, used in \ref dec_config.
+#define DEC_MODE_NONE			0u
+#define DEC_MODE_MINMAX			1u
+#define DEC_MODE_LTTB			2u
+
+//! Trigger types, used in \ref trig_config.
+#define TRIG_TYPE_EDGE			0u
+#define TRIG_TYPE_PATTERN		1u
+#define TRIG_TYPE_PULSE			2u
+#define TRIG_TYPE_SEQUENCE		3u
+
+//! Edge trigger polarity bits, used in \ref trig_config.
+#define TRIG_EDGE_RISING		1u
+#define TRIG_EDGE_FALLING		2u
+#define TRIG_EDGE_EITHER		3u
+
+//! Trigger states, used in \ref trig_status.
+#define TRIG_STATE_ARMED		0u
+#define TRIG_STATE_CAPTURING	1u
+#define TRIG_STATE_DONE			2u
+
+//! Bus protocol types, used in \ref proto_config.
+#define PROTO_TYPE_UART			0u
+#define PROTO_TYPE_SPI			1u
+#define PROTO_TYPE_I2C			2u
+
+//! UART parity, used in \ref proto_config.
+#define PROTO_PARITY_NONE		0u
+#define PROTO_PARITY_ODD		1u
+#define PROTO_PARITY_EVEN		2u
+
+//! Decoder option bits, used in \ref proto_config.
+#define PROTO_FLAG_LSB_FIRST	0x01u
+#define PROTO_FLAG_INVERT		0x02u
+
+//! Decoded frame kinds, used in \ref proto_frame.
+#define PROTO_FRAME_DATA		0u
+#define PROTO_FRAME_START		1u
+#define PROTO_FRAME_STOP		2u
+#define PROTO_FRAME_ADDR		3u
+
+//! Decoded frame status bits, used in \ref proto_frame.
+#define PROTO_STATUS_FRAMING	0x01u
+#define PROTO_STATUS_PARITY		0x02u
+#define PROTO_STATUS_NACK		0x04u
+
+//! Used in \ref proto_config.
+#define PROTO_PIN_COUNT			4u
+#define PROTO_PIN_UNUSED		0xFFu
+
+//! Per channel lookahead limit of cross-channel merger, in samples.
+#define MERGE_MAX_LOOKAHEAD		(1u << 16u)
+
+//! Used in \ref trig_config.
+#define TRIG_SEQ_STAGES			4u
+#define TRIG_MAX_PRE			(1u << 20u)
+
 //! Format of data sent to (or received from) USB control endpoint to set (or get) channel config.
 struct ch_config {
 	//! Channel index or endpoint address, depending on direction.
@@ -45,11 +107,115 @@ struct ch_sample {
 	uint64_t ts:56u;
 };
 
+//! Format of channel interpreter tag tracking status.
+struct interp_status {
+	uint64_t dropped;												//!< Lost reading count.
+	uint32_t gaps;													//!< Tag gap occurrence count.
+	uint32_t duplicates;											//!< Duplicated reading count.
+	uint32_t reorders;												//!< Late (out of order) reading count.
+	uint32_t resyncs;												//!< Tag resynchronization count.
+} __attribute__ ((packed));
+
+//! Format of data to set display decimation config of a channel for a client.
+struct dec_config {
+	uint8_t mode;													//!< One of DEC_MODE_* values.
+	uint32_t budget;												//!< Target points per second.
+	uint32_t rate;													//!< Channel sampling rate, in Hz.
+} __attribute__ ((packed));
+
 bool generateData(uint8_t idx, std::deque<uint8_t> &data, size_t maxSz);
 bool getGeneratorConfig(uint8_t idx, ch_config *cfg);
 bool setGeneratorConfig(const ch_config *cfg);
 
+//! Format of data to set channel trigger config.
+struct trig_config {
+	uint8_t type;													//!< One of TRIG_TYPE_* values.
+	//! Pin index within channel (LSB = pin base) for edge and pulse trigger.
+	uint8_t pin;
+	//! Edge trigger: TRIG_EDGE_* bits. Pulse trigger: 1 = high pulse, 0 = low pulse.
+	uint8_t polarity;
+	uint8_t stages;													//!< Sequence trigger stage count.
+	uint8_t rearm;													//!< Non-zero to re-arm after capture.
+	//! Pattern (stage 0 only) or sequence trigger stage match: (level &amp; mask) == value.
+	uint8_t mask[TRIG_SEQ_STAGES];
+	uint8_t value[TRIG_SEQ_STAGES];
+	uint32_t minWidth;												//!< Pulse width lower limit, in samples.
+	uint32_t maxWidth;												//!< Pulse width upper limit, in samples.
+	uint32_t pre;													//!< Pre-trigger sample count.
+	uint32_t post;													//!< Post-trigger sample count.
+} __attribute__ ((packed));
+
+//! Format of data to set channel bus protocol decoder config.
+struct proto_config {
+	uint8_t type;													//!< One of PROTO_TYPE_* values.
+	//! Pin index within channel (LSB = pin base) for each signal. UART: RX. SPI: SCK, MOSI, MISO, CS (latter
+	//! two optional). I2C: SCL, SDA. Unused entry must be \ref PROTO_PIN_UNUSED.
+	uint8_t pins[PROTO_PIN_COUNT];
+	uint8_t mode;													//!< UART: PROTO_PARITY_*. SPI: mode 0-3.
+	uint8_t bits;													//!< UART/SPI data bits, 5-8.
+	uint8_t flags;													//!< PROTO_FLAG_* bits.
+	uint32_t baud;													//!< UART baud rate.
+	uint32_t rate;													//!< Channel sampling rate, in Hz.
+} __attribute__ ((packed));
+
+//! Format of decoded bus protocol frame.
+struct proto_frame {
+	uint64_t ts:56u;												//!< Frame start sample timestamp.
+	uint64_t kind:8u;												//!< One of PROTO_FRAME_* values.
+	uint32_t duration;												//!< Frame length, in samples.
+	uint8_t data;													//!< UART/I2C data, SPI MOSI data.
+	uint8_t data2;													//!< SPI MISO data.
+	uint8_t status;													//!< PROTO_STATUS_* bits.
+	uint8_t reserved;
+};
+
+//! Format of sample after merged across channels.
+struct merge_sample {
+	uint64_t ts;													//!< Sample time since capture start, in ns.
+	uint8_t idx;													//!< Channel index.
+	uint8_t level;													//!< Sample level/value.
+} __attribute__ ((packed));
+
+//! Format of cross-channel merger status.
+struct merge_status {
+	uint64_t late;													//!< Dropped late sample count.
+	//! Sample count emitted before all channels progressed past it, due to lookahead limit.
+	uint64_t forced;
+	uint32_t buffered;												//!< Buffered sample count, all channels.
+	uint8_t channels;												//!< Channel count taking part.
+} __attribute__ ((packed));
+
+//! Format of channel trigger status.
+struct trig_status {
+	uint8_t state;													//!< One of TRIG_STATE_* values.
+	uint32_t fired;													//!< Fired count since config set.
+	uint64_t ts;													//!< Last trigger sample timestamp.
+} __attribute__ ((packed));
+
+bool decodeData(uint8_t idx, const ch_sample *samples, size_t count, std::deque<uint8_t> &data, size_t maxSz);
+bool setDecoderConfig(uint8_t idx, const proto_config *cfg);
+
+bool decimateData(uint8_t idx, uint32_t client, const ch_sample *samples, size_t count,
+	std::deque<uint8_t> &data, size_t maxSz);
+bool flushDecimator(uint8_t idx, uint32_t client, std::deque<uint8_t> &data, size_t maxSz);
+bool removeDecimator(uint8_t idx, uint32_t client);
+bool setDecimatorConfig(uint8_t idx, uint32_t client, const dec_config *cfg);
+
+bool getInterpreterStatus(uint8_t idx, interp_status *status);
 bool interpretData(uint8_t idx, const ch_data *reading, std::deque<uint8_t> &data, size_t maxSz);
 bool resetInterpreter(uint8_t idx);
+bool setInterpreterGapMarker(uint8_t idx, bool enable);
+
+bool flushMerge(std::deque<uint8_t> &data, size_t maxSz);
+bool getMergeStatus(merge_status *status);
+bool mergeData(uint8_t idx, const ch_sample *samples, size_t count, std::deque<uint8_t> &data, size_t maxSz);
+bool removeMergeChannel(uint8_t idx);
+bool resetMerge();
+bool setMergeChannel(uint8_t idx, uint32_t rate);
+
+bool getTriggerStatus(uint8_t idx, trig_status *status);
+bool resetTrigger(uint8_t idx);
+bool setTriggerConfig(uint8_t idx, const trig_config *cfg);
+bool triggerData(uint8_t idx, const ch_sample *samples, size_t count, std::deque<uint8_t> &data, size_t maxSz);
 
 #endif
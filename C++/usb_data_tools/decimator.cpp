@@ -0,0 +1,426 @@
+#include "data_tools.h"
+#include "main.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <new>
+
+//! Single channel (for single client) samples decimator for display, reducing interpreted sample stream to
+//! target points-per-second budget. Bucket state is kept across calls so batches can be split arbitrarily.
+class Decimator {
+	//! Per-bucket tracker for LTTB mode. Only first/last timestamp of every level is kept since triangle area
+	//! is linear on each axis, so memory is bounded regardless of bucket size.
+	struct LttbBucket {
+		std::array<uint64_t, 1u << 8u> firstTs, lastTs;				//!< Level -&gt; first/last timestamp.
+		std::bitset<1u << 8u> levels;								//!< Levels seen within bucket.
+		uint64_t idx;												//!< Bucket index (timestamp / span).
+		uint64_t sumOffset;											//!< Sum of timestamp offset from start.
+		uint64_t sumLevel;
+		uint64_t count;												//!< Sample count. 0 = unused bucket.
+		
+		//! Adds sample into bucket.
+		//! @param[in] smp Sample within bucket span.
+		//! @param[in] span Bucket span, in sample count.
+		void add(const ch_sample &smp, uint64_t span) {
+			if (!levels.test(smp.level)) {
+				levels.set(smp.level);
+				firstTs[smp.level] = smp.ts;
+			}
+			lastTs[smp.level] = smp.ts;
+			
+			sumOffset += (smp.ts - idx * span);
+			sumLevel += smp.level;
+			++count;
+		}
+		
+		//! Getter for latest sample within bucket. Bucket must not be empty.
+		//! @return Sample with largest timestamp.
+		ch_sample last() const {
+			ch_sample smp{};
+			
+			for (uint32_t level = 0u; level < levels.size(); ++level) {
+				if (levels.test(level) && (lastTs[level] >= smp.ts)) {
+					smp.ts = lastTs[level];
+					smp.level = level;
+				}
+			}
+			
+			return smp;
+		}
+		
+		//! Clears bucket and assigns new index to it.
+		//! @param[in] idx New bucket index.
+		void start(uint64_t idx) {
+			levels.reset();
+			this->idx = idx;
+			sumOffset = 0u;
+			sumLevel = 0u;
+			count = 0u;
+		}
+	};
+	
+public:
+	//! Constructor.
+	Decimator() noexcept {
+		cfg.mode = DEC_MODE_NONE;
+		cfg.budget = 0u;
+		cfg.rate = 0u;
+		span = 1u;
+		
+		reset();
+	}
+	
+	//! Destructor.
+	virtual ~Decimator() {}
+	
+	//! Processes interpreted samples into decimated samples. Latest bucket(s) are held back until a sample
+	//! beyond them arrives: 1 bucket for min/max mode, 2 buckets for LTTB mode. Gap marker sample is only passed
+	//! through without decimation, since bucket output would place it out of timestamp order.
+	//! @param[in] samples Interpreted samples, in timestamp order.
+	//! @param[in] count Sample count in \b samples.
+	//! @param[in,out] data Storage to be filled with data.
+	void proc(const ch_sample *samples, size_t count, std::deque<uint8_t> &data) {
+		for (size_t idx = 0u; idx < count; ++idx) {
+			const ch_sample &smp = samples[idx];
+			
+			switch (cfg.mode) {
+			case DEC_MODE_MINMAX:
+				if (smp.ts != INTERP_GAP_TS) [[likely]] {
+					procMinMax(smp, data);
+				}
+				break;
+			case DEC_MODE_LTTB:
+				if (smp.ts != INTERP_GAP_TS) [[likely]] {
+					procLttb(smp, data);
+				}
+				break;
+			default:
+				addSample(smp, data);
+				break;
+			}
+		}
+	}
+	
+	//! Emits held back bucket(s), e.g. when channel stops, then resets bucket tracker. For LTTB mode, next bucket
+	//! average still decides current bucket, and latest sample of last bucket is kept as end point.
+	//! @param[in,out] data Storage to be filled with data. Up to 2 samples are added.
+	void flush(std::deque<uint8_t> &data) {
+		switch (cfg.mode) {
+		case DEC_MODE_MINMAX:
+			if (minMaxCount) {
+				addMinMax(data);
+			}
+			break;
+		case DEC_MODE_LTTB:
+			if (lttbNext.count) {
+				addLttb(data);
+				addSample(lttbNext.last(), data);
+			}
+			else if (lttbCur.count) {
+				addSample(lttbCur.last(), data);
+			}
+			break;
+		default:
+			break;
+		}
+		
+		reset();
+	}
+	
+	//! Resets bucket tracker, dropping held back samples.
+	void reset() {
+		hasFirst = false;
+		minMaxIdx = 0u;
+		minMaxCount = 0u;
+		lttbCur.start(0u);
+		lttbNext.start(0u);
+	}
+	
+	//! Sets decimator config. Always resets tracker.
+	//! @param[in] cfg New decimator config. Must be valid.
+	void setConfig(const dec_config *cfg) {
+		this->cfg = *cfg;
+		
+		if (cfg->mode == DEC_MODE_NONE) {
+			span = 1u;
+		}
+		else {
+			//min/max mode produces 2 points per bucket, LTTB only 1
+			const uint64_t rate = (cfg->mode == DEC_MODE_MINMAX) ? (2ull * cfg->rate) : cfg->rate;
+			span = std::max<uint64_t>(1u, rate / cfg->budget + !!(rate % cfg->budget));
+		}
+		
+		reset();
+	}
+	
+	//! Helper function to validate decimator config.
+	//! @param[in] cfg New decimator config.
+	//! @return True if \b cfg is valid.
+	static bool validateConfig(const dec_config *cfg) noexcept {
+		if (cfg->mode > DEC_MODE_LTTB) {
+			SPDLOG_ERROR("Invalid mode '{}' as decimator config.", cfg->mode);
+			return false;
+		}
+		
+		if ((cfg->mode != DEC_MODE_NONE) && !cfg->budget) {
+			SPDLOG_ERROR("Invalid budget '{}' as decimator config.", cfg->budget);
+			return false;
+		}
+		
+		if ((!cfg->rate) || (cfg->rate > 125'000'000u)) {			//125MHz as per default Pico system clock
+			SPDLOG_ERROR("Invalid rate '{}' as decimator config.", cfg->rate);
+			return false;
+		}
+		
+		return true;
+	}
+	
+private:
+	//! Helper function to add sample to output storage.
+	//! @param[in] smp Sample to be added.
+	//! @param[in,out] data Storage to be filled with data.
+	static void addSample(const ch_sample &smp, std::deque<uint8_t> &data) {
+		const uint8_t *psmp = reinterpret_cast<const uint8_t*>(&smp);
+		data.insert(data.end(), psmp, psmp + sizeof(smp));
+	}
+	
+	//! Helper function to add current min/max bucket samples to output storage, in time order.
+	//! @param[in,out] data Storage to be filled with data.
+	void addMinMax(std::deque<uint8_t> &data) {
+		if (minSmp.ts == maxSmp.ts) {
+			addSample(minSmp, data);
+		}
+		else if (minSmp.ts < maxSmp.ts) {
+			addSample(minSmp, data);
+			addSample(maxSmp, data);
+		}
+		else {
+			addSample(maxSmp, data);
+			addSample(minSmp, data);
+		}
+	}
+	
+	//! Helper function to add sample of current LTTB bucket forming largest triangle with last kept sample and
+	//! next bucket average to output storage. Both buckets must not be empty.
+	//! @param[in,out] data Storage to be filled with data.
+	void addLttb(std::deque<uint8_t> &data) {
+		const double avgTs = static_cast<double>(lttbNext.idx * span - lastKept.ts) +
+			static_cast<double>(lttbNext.sumOffset) / lttbNext.count;
+		const double avgLevel = static_cast<double>(lttbNext.sumLevel) / lttbNext.count -
+			lastKept.level;
+		double maxArea = -1.0;
+		
+		//timestamp is relative to last kept sample to avoid precision loss on large value
+		auto fxCheck = [this, avgTs, avgLevel, &maxArea](uint64_t ts, uint8_t level) {
+			const double area = std::fabs(static_cast<double>(ts - lastKept.ts) * avgLevel -
+				avgTs * (static_cast<double>(level) - lastKept.level));
+			
+			if (area > maxArea) {
+				maxArea = area;
+				selected.ts = ts;
+				selected.level = level;
+			}
+		};
+		
+		for (uint32_t level = 0u; level < lttbCur.levels.size(); ++level) {
+			if (lttbCur.levels.test(level)) {
+				fxCheck(lttbCur.firstTs[level], level);
+				fxCheck(lttbCur.lastTs[level], level);
+			}
+		}
+		
+		addSample(selected, data);
+		lastKept = selected;
+	}
+	
+	//! Min/max mode: keeps lowest and highest level sample of every bucket so short glitches survive.
+	//! @param[in] smp New sample.
+	//! @param[in,out] data Storage to be filled with data.
+	void procMinMax(const ch_sample &smp, std::deque<uint8_t> &data) {
+		const uint64_t bucketIdx = smp.ts / span;
+		
+		if (minMaxCount && (bucketIdx == minMaxIdx)) [[likely]] {
+			if (smp.level < minSmp.level) {
+				minSmp = smp;
+			}
+			else if (smp.level > maxSmp.level) {
+				maxSmp = smp;
+			}
+			++minMaxCount;
+		}
+		else {
+			if (minMaxCount) {										//flush previous bucket in time order
+				addMinMax(data);
+			}
+			
+			minMaxIdx = bucketIdx;
+			minMaxCount = 1u;
+			minSmp = smp;
+			maxSmp = smp;
+		}
+	}
+	
+	//! LTTB (largest triangle three buckets) mode. Very first sample is always kept, then for every bucket the
+	//! sample forming largest triangle with last kept sample and next bucket average is selected.
+	//! @param[in] smp New sample.
+	//! @param[in,out] data Storage to be filled with data.
+	void procLttb(const ch_sample &smp, std::deque<uint8_t> &data) {
+		const uint64_t bucketIdx = smp.ts / span;
+		
+		if (!hasFirst) [[unlikely]] {
+			addSample(smp, data);
+			lastKept = smp;
+			hasFirst = true;
+		}
+		else if (!lttbCur.count) {
+			lttbCur.start(bucketIdx);
+			lttbCur.add(smp, span);
+		}
+		else if (bucketIdx == lttbCur.idx) {
+			lttbCur.add(smp, span);
+		}
+		else if (!lttbNext.count) {
+			lttbNext.start(bucketIdx);
+			lttbNext.add(smp, span);
+		}
+		else if (bucketIdx == lttbNext.idx) [[likely]] {
+			lttbNext.add(smp, span);
+		}
+		else {														//current bucket can be decided now
+			addLttb(data);
+			
+			std::swap(lttbCur, lttbNext);
+			lttbNext.start(bucketIdx);
+			lttbNext.add(smp, span);
+		}
+	}
+	
+	dec_config cfg;
+	uint64_t span;													//!< Bucket span, in sample count.
+	
+	ch_sample minSmp, maxSmp;
+	uint64_t minMaxIdx;												//!< Min/max mode current bucket index.
+	uint64_t minMaxCount;											//!< Min/max mode current bucket count.
+	
+	LttbBucket lttbCur, lttbNext;
+	ch_sample lastKept, selected;
+	bool hasFirst;													//!< Has kept very first sample.
+};
+
+//! (Client ID &lt;&lt; 8 | channel index) -&gt; decimator object.
+static std::map<uint64_t, std::shared_ptr<Decimator>> channels;
+
+//! Helper function to make \ref channels map key.
+//! @param[in] idx Channel index.
+//! @param[in] client Client ID.
+//! @return Map key.
+static inline uint64_t makeKey(uint8_t idx, uint32_t client) {
+	return (static_cast<uint64_t>(client) << 8u) | idx;
+}
+
+//! Decimates interpreted samples for display according to decimator config.
+//! @param[in] idx Target channel index.
+//! @param[in] client Target client ID (e.g. WebSocket client).
+//! @param[in] samples Interpreted samples, in timestamp order.
+//! @param[in] count Sample count in \b samples.
+//! @param[in,out] data Storage to be filled with data.
+//! @param[in] maxSz \b data size won't be larger than this value after filling.
+//! @return True if decimator exists and there's enough space for data.
+bool decimateData(uint8_t idx, uint32_t client, const ch_sample *samples, size_t count,
+std::deque<uint8_t> &data, size_t maxSz) {
+	//every sample may close a bucket holding up to 2 samples, but overall output never exceeds input + 2
+	if ((data.size() > maxSz) || ((maxSz - data.size()) < (sizeof(ch_sample) * (count + 2u)))) {
+		SPDLOG_ERROR("Storage space not enough for channel {} client {} decimator.", idx, client);
+		return false;
+	}
+	
+	auto iter = channels.find(makeKey(idx, client));
+	if (iter == channels.end()) {
+		SPDLOG_ERROR("Channel {} client {} not found for decimator.", idx, client);
+		return false;
+	}
+	
+	std::shared_ptr<Decimator> channel{iter->second};
+	channel->proc(samples, count, data);
+	
+	return true;
+}
+
+//! Emits samples held back by decimator of a channel for a client, e.g. when channel stops, and resets its
+//! tracker.
+//! @param[in] idx Target channel index.
+//! @param[in] client Target client ID.
+//! @param[in,out] data Storage to be filled with data.
+//! @param[in] maxSz \b data size won't be larger than this value after filling.
+//! @return True if decimator exists and there's enough space for data.
+bool flushDecimator(uint8_t idx, uint32_t client, std::deque<uint8_t> &data, size_t maxSz) {
+	if ((data.size() > maxSz) || ((maxSz - data.size()) < (sizeof(ch_sample) * 2u))) {
+		SPDLOG_ERROR("Storage space not enough for channel {} client {} decimator flush.", idx, client);
+		return false;
+	}
+	
+	auto iter = channels.find(makeKey(idx, client));
+	if (iter == channels.end()) {
+		SPDLOG_ERROR("Channel {} client {} not found for decimator flush.", idx, client);
+		return false;
+	}
+	
+	std::shared_ptr<Decimator>{iter->second}->flush(data);
+	
+	return true;
+}
+
+//! Removes decimator of a channel for a client, e.g. when client disconnects.
+//! @param[in] idx Target channel index.
+//! @param[in] client Target client ID.
+//! @return Always true, whether decimator exists or not.
+bool removeDecimator(uint8_t idx, uint32_t client) {
+	if (channels.erase(makeKey(idx, client))) {
+		SPDLOG_INFO("Channel {} client {} decimator removed.", idx, client);
+	}
+	
+	return true;
+}
+
+//! Sets decimator config of a channel for a client. Will add the decimator if not exists, and always resets
+//! its tracker. Will remove existing decimator if \b cfg is not valid.
+//! @param[in] idx Target channel index.
+//! @param[in] client Target client ID.
+//! @param[in] cfg New decimator config.
+//! @return True as long \b cfg is valid.
+bool setDecimatorConfig(uint8_t idx, uint32_t client, const dec_config *cfg) {
+	const uint64_t key = makeKey(idx, client);
+	auto iter = channels.find(key);
+	
+	if (!Decimator::validateConfig(cfg)) {
+		if (iter != channels.end()) {
+			channels.erase(iter);
+		}
+		return false;
+	}
+	
+	if (iter == channels.end()) {
+		auto obj = new(std::nothrow) Decimator();
+		
+		if (obj) {
+			std::shared_ptr<Decimator> channel{obj};
+			iter = channels.emplace(key, channel).first;
+			
+			SPDLOG_INFO("Channel {} client {} decimator added.", idx, client);
+		}
+		else {
+			SPDLOG_ERROR("Error allocating new channel {} client {} decimator object.", idx, client);
+			return false;
+		}
+	}
+	
+	iter->second->setConfig(cfg);
+	SPDLOG_INFO("Channel {} client {} decimator config set - mode:{} budget:{} rate:{}", idx, client, cfg->mode,
+		cfg->budget, cfg->rate);
+	
+	return true;
+}
@@ -0,0 +1,412 @@
+#include "data_tools.h"
+#include "main.h"
+
+#include <map>
+#include <memory>
+#include <new>
+
+//! Single channel bus protocol decoder (UART, SPI or I2C) on interpreted samples. Fixed-size state machine, so
+//! memory use is bounded regardless of sample rate and input size.
+class Decoder {
+public:
+	//! Constructor.
+	Decoder() noexcept {
+		cfg.type = PROTO_TYPE_UART;
+		for (uint8_t idx = 0u; idx < PROTO_PIN_COUNT; ++idx) {
+			cfg.pins[idx] = PROTO_PIN_UNUSED;
+		}
+		cfg.mode = 0u;
+		cfg.bits = 8u;
+		cfg.flags = 0u;
+		cfg.baud = 0u;
+		cfg.rate = 0u;
+		
+		reset();
+	}
+	
+	//! Destructor.
+	virtual ~Decoder() {}
+	
+	//! Processes interpreted samples into decoded frames. Gap marker sample drops partially decoded frame, as
+	//! bits within lost readings can't be recovered.
+	//! @param[in] samples Interpreted samples, in timestamp order.
+	//! @param[in] count Sample count in \b samples.
+	//! @param[in,out] data Storage to be filled with data.
+	void proc(const ch_sample *samples, size_t count, std::deque<uint8_t> &data) {
+		for (size_t idx = 0u; idx < count; ++idx) {
+			const ch_sample &smp = samples[idx];
+			
+			if (smp.ts == INTERP_GAP_TS) [[unlikely]] {
+				reset();
+				continue;
+			}
+			
+			switch (cfg.type) {
+			case PROTO_TYPE_UART:
+				procUart(smp, data);
+				break;
+			case PROTO_TYPE_SPI:
+				procSpi(smp, data);
+				break;
+			case PROTO_TYPE_I2C:
+				procI2c(smp, data);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+	
+	//! Resets state machine, dropping partially decoded frame.
+	void reset() {
+		hasPrev = false;
+		active = false;
+		prevLevel = 0u;
+		bitIdx = 0u;
+		shiftIn = 0u;
+		shiftIn2 = 0u;
+		frameTs = 0u;
+		parity = false;
+		isAddr = false;
+	}
+	
+	//! Sets decoder config. Always resets state machine.
+	//! @param[in] cfg New decoder config. Must be valid.
+	void setConfig(const proto_config *cfg) {
+		this->cfg = *cfg;
+		
+		if (cfg->type == PROTO_TYPE_UART) {
+			samplePerBit = static_cast<double>(cfg->rate) / cfg->baud;
+		}
+		
+		reset();
+	}
+	
+	//! Helper function to validate decoder config.
+	//! @param[in] cfg New decoder config.
+	//! @return True if \b cfg is valid.
+	static bool validateConfig(const proto_config *cfg) noexcept {
+		//minimum required pins for each protocol
+		static constexpr uint8_t pinCounts[] = {1u, 2u, 2u};
+		
+		if (cfg->type > PROTO_TYPE_I2C) {
+			SPDLOG_ERROR("Invalid type '{}' as decoder config.", cfg->type);
+			return false;
+		}
+		
+		for (uint8_t idx = 0u; idx < PROTO_PIN_COUNT; ++idx) {
+			if ((cfg->pins[idx] >= 8u) &&
+			((idx < pinCounts[cfg->type]) || (cfg->pins[idx] != PROTO_PIN_UNUSED))) {
+				SPDLOG_ERROR("Invalid pin '{}' at index {} as decoder config.", cfg->pins[idx], idx);
+				return false;
+			}
+		}
+		
+		//I2C frame is always 8 bits, so bit count is ignored
+		if ((cfg->type != PROTO_TYPE_I2C) && ((cfg->bits < 5u) || (cfg->bits > 8u))) {
+			SPDLOG_ERROR("Invalid bit count '{}' as decoder config.", cfg->bits);
+			return false;
+		}
+		
+		if (cfg->type == PROTO_TYPE_UART) {
+			if (cfg->mode > PROTO_PARITY_EVEN) {
+				SPDLOG_ERROR("Invalid parity '{}' as decoder config.", cfg->mode);
+				return false;
+			}
+			
+			//need at least a few samples per bit to find bit center
+			if ((!cfg->baud) || (!cfg->rate) || ((cfg->rate / cfg->baud) < 3u)) {
+				SPDLOG_ERROR("Invalid baud '{}' for rate '{}' as decoder config.", cfg->baud, cfg->rate);
+				return false;
+			}
+		}
+		else if ((cfg->type == PROTO_TYPE_SPI) && (cfg->mode > 3u)) {
+			SPDLOG_ERROR("Invalid SPI mode '{}' as decoder config.", cfg->mode);
+			return false;
+		}
+		
+		return true;
+	}
+	
+private:
+	//! Helper function to add frame to output storage.
+	//! @param[in] ts Frame start timestamp.
+	//! @param[in] end Frame end timestamp.
+	//! @param[in] kind One of PROTO_FRAME_* values.
+	//! @param[in] value Frame data.
+	//! @param[in] value2 Frame secondary data.
+	//! @param[in] status PROTO_STATUS_* bits.
+	//! @param[in,out] data Storage to be filled with data.
+	static void addFrame(uint64_t ts, uint64_t end, uint8_t kind, uint8_t value, uint8_t value2, uint8_t status,
+	std::deque<uint8_t> &data) {
+		proto_frame obj;
+		const uint8_t *pobj = reinterpret_cast<uint8_t*>(&obj);
+		
+		obj.ts = ts;
+		obj.kind = kind;
+		obj.duration = static_cast<uint32_t>(end - ts);
+		obj.data = value;
+		obj.data2 = value2;
+		obj.status = status;
+		obj.reserved = 0u;
+		
+		data.insert(data.end(), pobj, pobj + sizeof(obj));
+	}
+	
+	//! Helper function to get pin level from sample.
+	//! @param[in] level Sample level.
+	//! @param[in] pin Pin index within channel.
+	//! @return Pin level, inverted if configured so.
+	bool getPin(uint8_t level, uint8_t pin) const {
+		return (!!(level & (1u << pin))) != (!!(cfg.flags & PROTO_FLAG_INVERT));
+	}
+	
+	//! Helper function to shift in a bit as per configured bit order.
+	//! @param[in,out] reg Shift register.
+	//! @param[in] bit New bit.
+	void shiftBit(uint8_t &reg, bool bit) const {
+		if (cfg.flags & PROTO_FLAG_LSB_FIRST) {
+			reg |= (bit << bitIdx);
+		}
+		else {
+			reg = (reg << 1u) | bit;
+		}
+	}
+	
+	//! UART (RX pin = pin 0): start bit on falling edge, then every bit sampled at its center. Pin level is
+	//! held between samples, so bit centers falling in sample gap use previous sample level.
+	//! @param[in] smp New sample.
+	//! @param[in,out] data Storage to be filled with data.
+	void procUart(const ch_sample &smp, std::deque<uint8_t> &data) {
+		const bool rx = getPin(smp.level, cfg.pins[0]);
+		
+		while (active && (((bitIdx + 0.5) * samplePerBit) < static_cast<double>(smp.ts - frameTs))) {
+			takeUartBit(prevLevel, smp.ts, data);
+		}
+		
+		if (!active && hasPrev && prevLevel && !rx) {				//falling edge as start bit
+			active = true;
+			frameTs = smp.ts;
+			bitIdx = 0u;
+			shiftIn = 0u;
+			parity = false;
+		}
+		
+		if (active && (((bitIdx + 0.5) * samplePerBit) <= static_cast<double>(smp.ts - frameTs))) {
+			takeUartBit(rx, smp.ts, data);
+		}
+		
+		hasPrev = true;
+		prevLevel = rx;
+	}
+	
+	//! Helper function to process one UART bit at its center.
+	//! @param[in] bit Bit level.
+	//! @param[in] ts Current sample timestamp.
+	//! @param[in,out] data Storage to be filled with data.
+	void takeUartBit(bool bit, uint64_t ts, std::deque<uint8_t> &data) {
+		const uint8_t parityIdx = cfg.bits + 1u;
+		const uint8_t stopIdx = parityIdx + (cfg.mode != PROTO_PARITY_NONE);
+		
+		if (!bitIdx) {
+			if (bit) {												//glitch instead of start bit
+				active = false;
+				return;
+			}
+		}
+		else if (bitIdx <= cfg.bits) {								//always LSB first
+			shiftIn |= (bit << (bitIdx - 1u));
+			parity ^= bit;
+		}
+		else if (bitIdx < stopIdx) {
+			parity ^= bit;
+		}
+		else {
+			uint8_t status = bit ? 0u : PROTO_STATUS_FRAMING;
+			
+			if ((cfg.mode == PROTO_PARITY_ODD && !parity) || (cfg.mode == PROTO_PARITY_EVEN && parity)) {
+				status |= PROTO_STATUS_PARITY;
+			}
+			
+			addFrame(frameTs, ts, PROTO_FRAME_DATA, shiftIn, 0u, status, data);
+			active = false;
+			return;
+		}
+		
+		++bitIdx;
+	}
+	
+	//! SPI (pin 0 = SCK, 1 = MOSI, 2 = MISO, 3 = CS, latter two optional). Data is sampled on rising clock
+	//! edge for mode 0/3, falling edge for mode 1/2 (leading edge if CPHA = 0, trailing edge if CPHA = 1).
+	//! Without CS, every \ref proto_config::bits bits make a frame.
+	//! @param[in] smp New sample.
+	//! @param[in,out] data Storage to be filled with data.
+	void procSpi(const ch_sample &smp, std::deque<uint8_t> &data) {
+		const bool sck = getPin(smp.level, cfg.pins[0]);
+		const bool hasCs = (cfg.pins[3] != PROTO_PIN_UNUSED);
+		const bool cs = hasCs ? getPin(smp.level, cfg.pins[3]) : false;	//active low
+		
+		if (hasPrev) [[likely]] {
+			const bool prevCs = hasCs && (prevLevel & 0b10u);
+			
+			if (prevCs && !cs) {
+				addFrame(smp.ts, smp.ts, PROTO_FRAME_START, 0u, 0u, 0u, data);
+				bitIdx = 0u;
+			}
+			else if (!prevCs && cs) {
+				addFrame(smp.ts, smp.ts, PROTO_FRAME_STOP, 0u, 0u, bitIdx ? PROTO_STATUS_FRAMING : 0u, data);
+				bitIdx = 0u;
+			}
+			
+			//sample on rising edge if CPOL == CPHA, falling edge otherwise
+			const bool sampleRising = ((cfg.mode >> 1u) & 1u) == (cfg.mode & 1u);
+			const bool prevSck = prevLevel & 0b01u;
+			
+			if (!cs && (prevSck != sck) && (sck == sampleRising)) {
+				if (!bitIdx) {
+					frameTs = smp.ts;
+					shiftIn = 0u;
+					shiftIn2 = 0u;
+				}
+				
+				shiftBit(shiftIn, getPin(smp.level, cfg.pins[1]));
+				if (cfg.pins[2] != PROTO_PIN_UNUSED) {
+					shiftBit(shiftIn2, getPin(smp.level, cfg.pins[2]));
+				}
+				
+				if (++bitIdx >= cfg.bits) {
+					addFrame(frameTs, smp.ts, PROTO_FRAME_DATA, shiftIn, shiftIn2, 0u, data);
+					bitIdx = 0u;
+				}
+			}
+		}
+		
+		hasPrev = true;
+		prevLevel = (cs << 1u) | sck;
+	}
+	
+	//! I2C (pin 0 = SCL, 1 = SDA). START/STOP on SDA change while SCL is high, data sampled on SCL rising edge,
+	//! 8 data bits (MSB first) + ACK bit per frame. First frame after START is address frame.
+	//! @param[in] smp New sample.
+	//! @param[in,out] data Storage to be filled with data.
+	void procI2c(const ch_sample &smp, std::deque<uint8_t> &data) {
+		const bool scl = getPin(smp.level, cfg.pins[0]), sda = getPin(smp.level, cfg.pins[1]);
+		
+		if (hasPrev) [[likely]] {
+			const bool prevScl = prevLevel & 0b01u, prevSda = prevLevel & 0b10u;
+			
+			if (prevScl && scl && (prevSda != sda)) {
+				if (!sda) {											//START or repeated START
+					addFrame(smp.ts, smp.ts, PROTO_FRAME_START, 0u, 0u, 0u, data);
+					active = true;
+					isAddr = true;
+				}
+				else {												//STOP
+					//SCL rising edge right before STOP is always seen as first bit, thus not counted
+					addFrame(smp.ts, smp.ts, PROTO_FRAME_STOP, 0u, 0u,
+						(bitIdx > 1u) ? PROTO_STATUS_FRAMING : 0u, data);
+					active = false;
+				}
+				
+				bitIdx = 0u;
+			}
+			else if (active && !prevScl && scl) {
+				if (!bitIdx) {
+					frameTs = smp.ts;
+					shiftIn = 0u;
+				}
+				
+				if (bitIdx < 8u) {
+					shiftIn = (shiftIn << 1u) | sda;
+					++bitIdx;
+				}
+				else {												//ACK bit, low = ACK
+					addFrame(frameTs, smp.ts, isAddr ? PROTO_FRAME_ADDR : PROTO_FRAME_DATA, shiftIn, 0u,
+						sda ? PROTO_STATUS_NACK : 0u, data);
+					isAddr = false;
+					bitIdx = 0u;
+				}
+			}
+		}
+		
+		hasPrev = true;
+		prevLevel = (sda << 1u) | scl;
+	}
+	
+	proto_config cfg;
+	double samplePerBit;											//!< UART bit width, in samples.
+	uint64_t frameTs;												//!< Current frame start timestamp.
+	uint8_t bitIdx;													//!< Current frame bit index.
+	uint8_t prevLevel;												//!< Previous sample relevant pin levels.
+	uint8_t shiftIn, shiftIn2;										//!< Data shift registers.
+	bool active;													//!< Inside UART frame or I2C transaction.
+	bool hasPrev;													//!< Has seen sample after reset.
+	bool isAddr;													//!< I2C next frame is address frame.
+	bool parity;													//!< UART running parity.
+};
+
+//! Channel index -&gt; decoder object.
+static std::map<uint8_t, std::shared_ptr<Decoder>> channels;
+
+//! Decodes interpreted samples into bus protocol frames.
+//! @param[in] idx Target channel index.
+//! @param[in] samples Interpreted samples, in timestamp order.
+//! @param[in] count Sample count in \b samples.
+//! @param[in,out] data Storage to be filled with \ref proto_frame data.
+//! @param[in] maxSz \b data size won't be larger than this value after filling.
+//! @return True if channel decoder exists and there's enough space for data.
+bool decodeData(uint8_t idx, const ch_sample *samples, size_t count, std::deque<uint8_t> &data, size_t maxSz) {
+	//single sample produces 2 frames at most (e.g. SPI CS edge + last data bit)
+	if ((data.size() > maxSz) || ((maxSz - data.size()) < (sizeof(proto_frame) * 2u * count))) {
+		SPDLOG_ERROR("Storage space not enough for channel {} decoder.", idx);
+		return false;
+	}
+	
+	auto iter = channels.find(idx);
+	if (iter == channels.end()) {
+		SPDLOG_ERROR("Channel {} not found for decoder.", idx);
+		return false;
+	}
+	
+	std::shared_ptr<Decoder> channel{iter->second};
+	channel->proc(samples, count, data);
+	
+	return true;
+}
+
+//! Sets channel decoder config. Will add the channel if not exists, and always resets its state machine. Will
+//! remove existing channel if \b cfg is not valid.
+//! @param[in] idx Target channel index.
+//! @param[in] cfg New decoder config.
+//! @return True as long \b cfg is valid.
+bool setDecoderConfig(uint8_t idx, const proto_config *cfg) {
+	auto iter = channels.find(idx);
+	
+	if (!Decoder::validateConfig(cfg)) {
+		if (iter != channels.end()) {
+			channels.erase(iter);
+		}
+		return false;
+	}
+	
+	if (iter == channels.end()) {
+		auto obj = new(std::nothrow) Decoder();
+		
+		if (obj) {
+			std::shared_ptr<Decoder> channel{obj};
+			iter = channels.emplace(idx, channel).first;
+			
+			SPDLOG_INFO("Channel {} decoder added.", idx);
+		}
+		else {
+			SPDLOG_ERROR("Error allocating new channel {} decoder object.", idx);
+			return false;
+		}
+	}
+	
+	iter->second->setConfig(cfg);
+	SPDLOG_INFO("Channel {} decoder config set - type:{} mode:{} bits:{} baud:{}", idx, cfg->type, cfg->mode,
+		cfg->bits, cfg->baud);
+	
+	return true;
+}
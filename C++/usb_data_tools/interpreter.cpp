@@ -10,10 +10,29 @@ class Interpreter {
 public:
 	//! Constructor.
 	Interpreter() noexcept {
+		gapMark = false;
 		reset();
 	}
 	
-	//! Processes readings data into separate valid sample(s) with timestamp.
+	//! Getter for tag tracking status.
+	//! @param[out] status Interpreter status object.
+	void getStatus(interp_status *status) const {
+		status->dropped = dropped;
+		status->gaps = gaps;
+		status->duplicates = duplicates;
+		status->reorders = reorders;
+		status->resyncs = resyncs;
+	}
+	
+	//! Getter for gap marker state.
+	//! @return True if gap marker is enabled.
+	bool hasGapMarker() const {
+		return gapMark;
+	}
+	
+	//! Processes readings data into separate valid sample(s) with timestamp. Duplicated or reordered reading
+	//! (tag not ahead of last seen tag) is discarded as timestamp can't go backward, unless
+	//! \ref INTERP_RESYNC_COUNT of them arrive in a row, in which case tracking restarts from that tag.
 	//! @param[in] reading Channel reading object.
 	//! @param[in,out] data Storage to be filled with data.
 	void proc(const ch_data *reading, std::deque<uint8_t> &data) {
@@ -23,15 +42,45 @@ public:
 		const uint8_t *pobj = reinterpret_cast<uint8_t*>(&obj);
 		
 		if (hasSeen) [[likely]] {
-			if (lastTag < reading->tag) [[likely]] {				//normal progression
-				ts += ((reading->tag - lastTag) * SAMPLE_PER_READING);
+			constexpr uint32_t tagMask = (1u << TAG_BITS) - 1u;
+			//tag distance with overflow to 0 accounted
+			const uint32_t diff = (reading->tag - lastTag) & tagMask;
+			
+			if (diff == 1u) [[likely]] {							//normal progression
+				ts += SAMPLE_PER_READING;
 			}
-			else if (lastTag > reading->tag) {						//tag has overflowed
-				constexpr uint64_t maxTag = 1u << TAG_BITS;
-				ts += ((maxTag - lastTag + reading->tag) * SAMPLE_PER_READING);
+			else if (diff == 0u) {
+				++duplicates;
+				return;
+			}
+			else if (diff > (tagMask >> 1u)) {						//behind last seen tag, arrived late
+				if (++behind < INTERP_RESYNC_COUNT) {
+					++reorders;
+					return;
+				}
+				
+				//too many in a row to be reordering, tag sequence jumped backward instead
+				++resyncs;
+				ts += SAMPLE_PER_READING;
+				SPDLOG_WARN("Tag resync {}->{} after {} late reading(s).", lastTag, (uint32_t) reading->tag,
+					behind);
+			}
+			else {													//readings lost in between
+				dropped += diff - 1u;
+				++gaps;
+				ts += diff * SAMPLE_PER_READING;
+				SPDLOG_DEBUG("Tag gap {}->{}, {} reading(s) lost.", lastTag, (uint32_t) reading->tag,
+					diff - 1u);
+				
+				if (gapMark) {
+					obj.level = 0u;
+					obj.ts = INTERP_GAP_TS;
+					data.insert(data.end(), pobj, pobj + sizeof(obj));
+				}
 			}
 		}
 		lastTag = reading->tag;
+		behind = 0u;
 		
 		for (uint8_t idx = 0u; idx < SAMPLE_PER_READING; ++idx) {
 			if (valid & (0b1000u >> idx)) {
@@ -44,23 +93,59 @@ public:
 		}
 	}
 	
-	//! Resets timestamp and tracker to 0.
+	//! Resets timestamp, tracker and loss counters to 0.
 	void reset() {
 		hasSeen = false;
 		lastTag = 0u;
 		ts = 0ull;
+		dropped = 0ull;
+		gaps = 0u;
+		duplicates = 0u;
+		reorders = 0u;
+		resyncs = 0u;
+		behind = 0u;
+	}
+	
+	//! Enables or disables gap marker sample emitted before first sample after lost reading(s).
+	//! @param[in] enable True to enable.
+	void setGapMarker(bool enable) {
+		gapMark = enable;
 	}
 	
 private:
 	//! Monotonically increasing base timestamp for current tag (1 tag = \ref SAMPLE_PER_READING samples).
 	uint64_t ts;
+	uint64_t dropped;												//!< Lost reading count.
+	uint32_t gaps;													//!< Tag gap occurrence count.
+	uint32_t duplicates;											//!< Duplicated reading count.
+	uint32_t reorders;												//!< Late (out of order) reading count.
+	uint32_t resyncs;												//!< Tag resynchronization count.
+	uint32_t behind;												//!< Consecutive late reading count.
 	uint32_t lastTag;												//!< Tracks last seen tag.
+	bool gapMark;													//!< Emits gap marker sample if set.
 	bool hasSeen;													//!< Has seen valid sample after reset.
 };
 
 //! Channel index -&gt; interpreter object.
 static std::map<uint8_t, std::shared_ptr<Interpreter>> channels;
 
+//! Gets channel tag tracking status, i.e. lost, duplicated, reordered reading and resync counts since reset.
+//! @param[in] idx Target channel index.
+//! @param[out] status Interpreter status object.
+//! @return True if target channel is found.
+bool getInterpreterStatus(uint8_t idx, interp_status *status) {
+	auto iter = channels.find(idx);
+	
+	if (iter == channels.end()) {
+		SPDLOG_ERROR("Channel {} not found to get interpreter status.", idx);
+		return false;
+	}
+	
+	std::shared_ptr<Interpreter>{iter->second}->getStatus(status);
+	
+	return true;
+}
+
 //! Interprets readings data into separate samples with associated timestamp.
 //! @param[in] idx Target channel index.
 //! @param[in] reading Channel reading object.
@@ -73,11 +158,6 @@ bool interpretData(uint8_t idx, const ch_data *reading, std::deque<uint8_t> &dat
 		return true;
 	}
 	
-	if ((maxSz - data.size()) < (sizeof(ch_sample) * SAMPLE_PER_READING)) {
-		SPDLOG_ERROR("Storage space not enough for channel {} data interpreter.", idx);
-		return false;
-	}
-	
 	auto iter = channels.find(idx);
 	if (iter == channels.end()) {
 		SPDLOG_ERROR("Channel {} not found for data interpreter.", idx);
@@ -85,12 +165,20 @@ bool interpretData(uint8_t idx, const ch_data *reading, std::deque<uint8_t> &dat
 	}
 	
 	std::shared_ptr<Interpreter> channel{iter->second};
+	
+	//gap marker may precede samples
+	const size_t count = SAMPLE_PER_READING + (channel->hasGapMarker() ? 1u : 0u);
+	if ((maxSz - data.size()) < (sizeof(ch_sample) * count)) {
+		SPDLOG_ERROR("Storage space not enough for channel {} data interpreter.", idx);
+		return false;
+	}
+	
 	channel->proc(reading, data);
 	
 	return true;
 }
 
-//! Resets existing channel tag tracking (timestamp to 0). Will add the channel if not exists.
+//! Resets existing channel tag tracking (timestamp and loss counters to 0). Will add the channel if not exists.
 //! @param[in] idx Target channel index.
 //! @return False if channel object can't be allocated when needed, true otherwise.
 bool resetInterpreter(uint8_t idx) {
@@ -117,3 +205,22 @@ bool resetInterpreter(uint8_t idx) {
 	
 	return true;
 }
+
+//! Enables or disables channel gap marker. Once enabled, sample with \ref INTERP_GAP_TS timestamp is emitted
+//! before first sample following lost reading(s), and has to be filtered out by consumer.
+//! @param[in] idx Target channel index.
+//! @param[in] enable True to enable.
+//! @return True if target channel is found.
+bool setInterpreterGapMarker(uint8_t idx, bool enable) {
+	auto iter = channels.find(idx);
+	
+	if (iter == channels.end()) {
+		SPDLOG_ERROR("Channel {} not found to set interpreter gap marker.", idx);
+		return false;
+	}
+	
+	iter->second->setGapMarker(enable);
+	SPDLOG_INFO("Channel {} gap marker {}.", idx, enable ? "enabled" : "disabled");
+	
+	return true;
+}
@@ -0,0 +1,368 @@
+#include "data_tools.h"
+#include "main.h"
+
+#include <deque>
+#include <map>
+#include <numeric>
+#include <queue>
+#include <vector>
+
+//! Cross-channel sample merger. Converts per-channel sample timestamps into common nanosecond time base and
+//! produces single time-ordered stream across channels. All channels are expected to share same timestamp
+//! origin, i.e. interpreters reset at same time.
+class Merger {
+public:
+	//! Constructor.
+	Merger() noexcept {
+		emittedCh = nullptr;
+		emittedTs = 0u;
+		late = 0u;
+		forced = 0u;
+		buffered = 0u;
+		hasEmitted = false;
+	}
+	
+	//! Drops all buffered samples of all channels.
+	//! @param[in] keepStats False to also reset statistics.
+	void clear(bool keepStats) {
+		for (auto &[idx, channel] : channels) {
+			channel.buffer.clear();
+			channel.hasLast = false;
+			channel.lastTs = 0u;
+		}
+		
+		heap = decltype(heap){};
+		buffered = 0u;
+		hasEmitted = false;
+		
+		if (!keepStats) {
+			late = 0u;
+			forced = 0u;
+		}
+	}
+	
+	//! Emits all buffered samples regardless of other channels progress.
+	//! @param[in,out] data Storage to be filled with data.
+	void flush(std::deque<uint8_t> &data) {
+		while (!heap.empty()) {
+			emitTop(data);
+		}
+	}
+	
+	//! Getter for samples count currently buffered across channels.
+	//! @return Sample count.
+	size_t getBuffered() const {
+		return buffered;
+	}
+	
+	//! Getter for merger status.
+	//! @param[out] status Merger status object.
+	void getStatus(merge_status *status) const {
+		status->late = late;
+		status->forced = forced;
+		status->buffered = buffered;
+		status->channels = channels.size();
+	}
+	
+	//! Checks if channel takes part in merging.
+	//! @param[in] idx Target channel index.
+	//! @return True if channel exists.
+	bool hasChannel(uint8_t idx) const {
+		return channels.contains(idx);
+	}
+	
+	//! Buffers channel samples and emits merged samples that can no longer be preceded by other channels. Gap
+	//! marker sample is dropped.
+	//! @param[in] idx Target channel index. Must exist.
+	//! @param[in] samples Interpreted samples, in timestamp order.
+	//! @param[in] count Sample count in \b samples.
+	//! @param[in,out] data Storage to be filled with data.
+	void proc(uint8_t idx, const ch_sample *samples, size_t count, std::deque<uint8_t> &data) {
+		Channel &channel = channels.find(idx)->second;
+		const bool wasEmpty = channel.buffer.empty();
+		
+		for (size_t smpIdx = 0u; smpIdx < count; ++smpIdx) {
+			const ch_sample &smp = samples[smpIdx];
+			
+			if (smp.ts == INTERP_GAP_TS) [[unlikely]] {			//gap marker, not an actual sample
+				continue;
+			}
+			
+			//older than what has been emitted already, most likely after forced emission
+			if (hasEmitted && (compare(channel, smp.ts, *emittedCh, emittedTs) < 0)) [[unlikely]] {
+				++late;
+				continue;
+			}
+			
+			channel.buffer.push_back(smp);
+			channel.hasLast = true;
+			channel.lastTs = smp.ts;
+			++buffered;
+		}
+		
+		if (wasEmpty && !channel.buffer.empty()) {
+			heap.push(&channel);
+		}
+		
+		if (!channel.buffer.empty() && (channel.buffer.size() > MERGE_MAX_LOOKAHEAD)) [[unlikely]] {
+			SPDLOG_WARN("Channel {} exceeds merge lookahead, lagging channel samples will be dropped.", idx);
+		}
+		
+		//watermark is earliest last-seen sample among channels, nothing earlier than that can still arrive
+		const Channel *mark = nullptr;
+		for (const auto &[chIdx, other] : channels) {
+			if (!other.hasLast) {
+				mark = nullptr;
+				break;
+			}
+			if ((!mark) || (compare(other, other.lastTs, *mark, mark->lastTs) < 0)) {
+				mark = &other;
+			}
+		}
+		
+		while (!heap.empty()) {
+			const Channel *top = heap.top();
+			
+			if (mark && (compare(*top, top->buffer.front().ts, *mark, mark->lastTs) <= 0)) {
+				emitTop(data);
+			}
+			else if (overLimit()) {									//lagging channel, stop waiting
+				++forced;
+				emitTop(data);
+			}
+			else {
+				break;
+			}
+		}
+	}
+	
+	//! Removes channel from merging. Its buffered samples are dropped.
+	//! @param[in] idx Target channel index.
+	//! @return True if channel exists.
+	bool removeChannel(uint8_t idx) {
+		auto iter = channels.find(idx);
+		
+		if (iter == channels.end()) {
+			return false;
+		}
+		
+		buffered -= iter->second.buffer.size();
+		if (hasEmitted && (emittedCh == &iter->second)) {
+			hasEmitted = false;
+		}
+		channels.erase(iter);
+		rebuildHeap();
+		
+		return true;
+	}
+	
+	//! Adds channel to merging or updates its sampling rate. Existing channel buffered samples are dropped.
+	//! @param[in] idx Target channel index.
+	//! @param[in] rate Channel sampling rate, in Hz. Must be non-zero.
+	void setChannel(uint8_t idx, uint32_t rate) {
+		//channel objects are referred by heap, map nodes are stable so only contents are touched here
+		Channel &channel = channels[idx];
+		const uint64_t div = std::gcd<uint64_t, uint64_t>(NS_PER_SEC, rate);
+		
+		buffered -= channel.buffer.size();
+		channel.buffer.clear();
+		channel.idx = idx;
+		channel.num = NS_PER_SEC / div;
+		channel.den = rate / div;
+		channel.hasLast = false;
+		channel.lastTs = 0u;
+		
+		if (hasEmitted && (emittedCh == &channel)) {
+			hasEmitted = false;
+		}
+		rebuildHeap();
+	}
+	
+private:
+	static constexpr uint64_t NS_PER_SEC = 1000000000u;
+	
+	//! Per channel merge state.
+	struct Channel {
+		std::deque<ch_sample> buffer;								//!< Lookahead samples, not emitted yet.
+		uint64_t num;												//!< Nanosecond per sample numerator.
+		uint64_t den;												//!< Nanosecond per sample denominator.
+		uint64_t lastTs;											//!< Last buffered sample timestamp.
+		uint8_t idx;												//!< Channel index.
+		bool hasLast;												//!< Has buffered sample since reset.
+	};
+	
+	//! Heap ordering, earliest front sample on top. Ties are broken by channel index to keep output stable.
+	struct Later {
+		bool operator()(const Channel *lhs, const Channel *rhs) const {
+			const int cmp = compare(*lhs, lhs->buffer.front().ts, *rhs, rhs->buffer.front().ts);
+			return (cmp > 0) || ((cmp == 0) && (lhs->idx > rhs->idx));
+		}
+	};
+	
+	//! Compares sample time of 2 channels exactly, i.e. lts * lnum / lden vs rts * rnum / rden.
+	//! @param[in] lhs Left channel.
+	//! @param[in] lts Left sample timestamp.
+	//! @param[in] rhs Right channel.
+	//! @param[in] rts Right sample timestamp.
+	//! @return Negative, zero or positive if left time is earlier, same or later respectively.
+	static int compare(const Channel &lhs, uint64_t lts, const Channel &rhs, uint64_t rts) {
+		//56-bit timestamp * 30-bit numerator * 32-bit denominator still fits
+		const unsigned __int128 lval = static_cast<unsigned __int128>(lts) * lhs.num * rhs.den;
+		const unsigned __int128 rval = static_cast<unsigned __int128>(rts) * rhs.num * lhs.den;
+		
+		return (lval < rval) ? -1 : ((lval > rval) ? 1 : 0);
+	}
+	
+	//! Helper function to move earliest buffered sample to output storage.
+	//! @param[in,out] data Storage to be filled with data.
+	void emitTop(std::deque<uint8_t> &data) {
+		Channel *channel = heap.top();
+		const ch_sample smp = channel->buffer.front();
+		
+		heap.pop();
+		channel->buffer.pop_front();
+		--buffered;
+		
+		merge_sample obj;
+		obj.ts = static_cast<unsigned __int128>(smp.ts) * channel->num / channel->den;
+		obj.idx = channel->idx;
+		obj.level = smp.level;
+		
+		const uint8_t *pobj = reinterpret_cast<const uint8_t*>(&obj);
+		data.insert(data.end(), pobj, pobj + sizeof(obj));
+		
+		hasEmitted = true;
+		emittedCh = channel;
+		emittedTs = smp.ts;
+		
+		if (!channel->buffer.empty()) {
+			heap.push(channel);
+		}
+	}
+	
+	//! Checks if any channel holds more samples than lookahead limit.
+	//! @return True if limit is exceeded.
+	bool overLimit() const {
+		for (const auto &[idx, channel] : channels) {
+			if (channel.buffer.size() > MERGE_MAX_LOOKAHEAD) {
+				return true;
+			}
+		}
+		return false;
+	}
+	
+	//! Helper function to rebuild heap after channel is added, updated or removed.
+	void rebuildHeap() {
+		heap = decltype(heap){};
+		
+		for (auto &[idx, channel] : channels) {
+			if (!channel.buffer.empty()) {
+				heap.push(&channel);
+			}
+		}
+	}
+	
+	std::map<uint8_t, Channel> channels;							//!< Channel index -&gt; merge state.
+	//! Channels with buffered samples, ordered by front sample time.
+	std::priority_queue<Channel*, std::vector<Channel*>, Later> heap;
+	const Channel *emittedCh;										//!< Last emitted sample channel.
+	uint64_t emittedTs;												//!< Last emitted sample timestamp.
+	uint64_t late;													//!< Dropped late sample count.
+	uint64_t forced;												//!< Sample count emitted past watermark.
+	size_t buffered;												//!< Buffered sample count, all channels.
+	bool hasEmitted;												//!< Has emitted sample since reset.
+};
+
+//! Single merger across all channels.
+static Merger merger;
+
+//! Emits all samples still buffered in merger, e.g. at end of capture.
+//! @param[in,out] data Storage to be filled with data.
+//! @param[in] maxSz \b data size won't be larger than this value after filling.
+//! @return True if there's enough space for data.
+bool flushMerge(std::deque<uint8_t> &data, size_t maxSz) {
+	const size_t needSz = sizeof(merge_sample) * merger.getBuffered();
+	if ((data.size() > maxSz) || ((maxSz - data.size()) < needSz)) {
+		SPDLOG_ERROR("Storage space not enough for merger flush.");
+		return false;
+	}
+	
+	merger.flush(data);
+	
+	return true;
+}
+
+//! Gets merger status.
+//! @param[out] status Merger status object.
+//! @return Always true.
+bool getMergeStatus(merge_status *status) {
+	merger.getStatus(status);
+	return true;
+}
+
+//! Buffers channel samples for merging and emits time-ordered samples across channels. Sample is only emitted
+//! once every channel has progressed past it, or once any channel exceeds \ref MERGE_MAX_LOOKAHEAD buffered
+//! samples. In latter case, samples arriving afterwards that are older than emitted ones are dropped.
+//! @param[in] idx Target channel index.
+//! @param[in] samples Interpreted samples, in timestamp order.
+//! @param[in] count Sample count in \b samples.
+//! @param[in,out] data Storage to be filled with data.
+//! @param[in] maxSz \b data size won't be larger than this value after filling.
+//! @return True if channel takes part in merging and there's enough space for data.
+bool mergeData(uint8_t idx, const ch_sample *samples, size_t count, std::deque<uint8_t> &data, size_t maxSz) {
+	if (!merger.hasChannel(idx)) {
+		SPDLOG_ERROR("Channel {} not found for merger.", idx);
+		return false;
+	}
+	
+	//all buffered samples may be released at once
+	const size_t needSz = sizeof(merge_sample) * (count + merger.getBuffered());
+	if ((data.size() > maxSz) || ((maxSz - data.size()) < needSz)) {
+		SPDLOG_ERROR("Storage space not enough for channel {} merger.", idx);
+		return false;
+	}
+	
+	merger.proc(idx, samples, count, data);
+	
+	return true;
+}
+
+//! Removes channel from merging. Its buffered samples are dropped.
+//! @param[in] idx Target channel index.
+//! @return True if target channel is found.
+bool removeMergeChannel(uint8_t idx) {
+	if (!merger.removeChannel(idx)) {
+		SPDLOG_ERROR("Channel {} not found for merger removal.", idx);
+		return false;
+	}
+	
+	SPDLOG_INFO("Channel {} merger removed.", idx);
+	
+	return true;
+}
+
+//! Drops all buffered samples and resets merger statistics, e.g. when interpreters are reset. Channels are
+//! kept.
+//! @return Always true.
+bool resetMerge() {
+	merger.clear(false);
+	SPDLOG_INFO("Merger reset.");
+	
+	return true;
+}
+
+//! Adds channel to merging or updates its sampling rate. Existing channel buffered samples are dropped.
+//! @param[in] idx Target channel index.
+//! @param[in] rate Channel sampling rate, in Hz.
+//! @return True as long \b rate is valid.
+bool setMergeChannel(uint8_t idx, uint32_t rate) {
+	if (!rate) {
+		SPDLOG_ERROR("Invalid rate '{}' for channel {} merger.", rate, idx);
+		return false;
+	}
+	
+	merger.setChannel(idx, rate);
+	SPDLOG_INFO("Channel {} merger set - rate:{}", idx, rate);
+	
+	return true;
+}
@@ -0,0 +1,355 @@
+#include "data_tools.h"
+#include "main.h"
+
+#include <map>
+#include <memory>
+#include <new>
+#include <vector>
+
+//! Single channel trigger engine on interpreted samples. Keeps ring buffer of pre-trigger samples and only lets
+//! window of pre- and post-trigger samples through once trigger condition is met.
+class Trigger {
+public:
+	//! Constructor.
+	Trigger() noexcept {
+		cfg.type = TRIG_TYPE_EDGE;
+		cfg.pin = 0u;
+		cfg.polarity = TRIG_EDGE_RISING;
+		cfg.stages = 1u;
+		cfg.rearm = 0u;
+		cfg.minWidth = 0u;
+		cfg.maxWidth = 0u;
+		cfg.pre = 0u;
+		cfg.post = 0u;
+		
+		for (uint8_t idx = 0u; idx < TRIG_SEQ_STAGES; ++idx) {
+			cfg.mask[idx] = 0u;
+			cfg.value[idx] = 0u;
+		}
+		
+		fired = 0u;
+		firedTs = 0u;
+		reset();
+	}
+	
+	//! Destructor.
+	virtual ~Trigger() {}
+	
+	//! Getter for pre-trigger sample count currently held.
+	//! @return Sample count.
+	size_t getPreCount() const {
+		return ringQt;
+	}
+	
+	//! Getter for trigger status.
+	//! @param[out] status Trigger status object.
+	void getStatus(trig_status *status) const {
+		status->state = state;
+		status->fired = fired;
+		status->ts = firedTs;
+	}
+	
+	//! Processes interpreted samples, evaluating trigger condition and filling output with capture window. Gap
+	//! marker sample is skipped.
+	//! @param[in] samples Interpreted samples, in timestamp order.
+	//! @param[in] count Sample count in \b samples.
+	//! @param[in,out] data Storage to be filled with data.
+	void proc(const ch_sample *samples, size_t count, std::deque<uint8_t> &data) {
+		for (size_t idx = 0u; (idx < count) && (state != TRIG_STATE_DONE); ++idx) {
+			const ch_sample &smp = samples[idx];
+			
+			if (smp.ts == INTERP_GAP_TS) [[unlikely]] {			//gap marker, not an actual sample
+				continue;
+			}
+			
+			if (state == TRIG_STATE_CAPTURING) {
+				check(smp);											//only to keep condition tracking current
+				addSample(smp, data);
+				
+				if (!--postLeft) {
+					if (cfg.rearm) {
+						arm();
+					}
+					else {
+						state = TRIG_STATE_DONE;
+						SPDLOG_DEBUG("Trigger capture done at {}.", (uint64_t) smp.ts);
+					}
+				}
+			}
+			else if (check(smp)) {
+				//pre-trigger samples, oldest first
+				for (size_t ringIdx = 0u; ringIdx < ringQt; ++ringIdx) {
+					addSample(ring[(ringHead + ringIdx) % ring.size()], data);
+				}
+				addSample(smp, data);
+				
+				++fired;
+				firedTs = smp.ts;
+				ringQt = 0u;
+				
+				if (cfg.post) {
+					state = TRIG_STATE_CAPTURING;
+					postLeft = cfg.post;
+				}
+				else if (cfg.rearm) {
+					arm();
+				}
+				else {
+					state = TRIG_STATE_DONE;
+				}
+			}
+			else if (!ring.empty()) {
+				if (ringQt < ring.size()) {
+					ring[(ringHead + ringQt) % ring.size()] = smp;
+					++ringQt;
+				}
+				else {												//overwrite oldest
+					ring[ringHead] = smp;
+					ringHead = (ringHead + 1u) % ring.size();
+				}
+			}
+		}
+	}
+	
+	//! Re-arms trigger, dropping pre-trigger samples and condition tracking. Fired count is kept.
+	void reset() {
+		ring.assign(cfg.pre, ch_sample{});
+		hasPrev = false;
+		matched = false;
+		stage = 0u;
+		arm();
+	}
+	
+	//! Sets trigger config. Always re-arms trigger and resets fired count.
+	//! @param[in] cfg New trigger config. Must be valid.
+	void setConfig(const trig_config *cfg) {
+		this->cfg = *cfg;
+		fired = 0u;
+		firedTs = 0u;
+		reset();
+	}
+	
+	//! Helper function to validate trigger config.
+	//! @param[in] cfg New trigger config.
+	//! @return True if \b cfg is valid.
+	static bool validateConfig(const trig_config *cfg) noexcept {
+		if (cfg->type > TRIG_TYPE_SEQUENCE) {
+			SPDLOG_ERROR("Invalid type '{}' as trigger config.", cfg->type);
+			return false;
+		}
+		
+		if (cfg->pin >= 8u) {										//sample level has 8 bits at most
+			SPDLOG_ERROR("Invalid pin '{}' as trigger config.", cfg->pin);
+			return false;
+		}
+		
+		if ((cfg->type == TRIG_TYPE_EDGE) &&
+		((cfg->polarity < TRIG_EDGE_RISING) || (cfg->polarity > TRIG_EDGE_EITHER))) {
+			SPDLOG_ERROR("Invalid edge polarity '{}' as trigger config.", cfg->polarity);
+			return false;
+		}
+		
+		if ((cfg->type == TRIG_TYPE_PULSE) && ((!cfg->maxWidth) || (cfg->minWidth > cfg->maxWidth))) {
+			SPDLOG_ERROR("Invalid pulse width '{}-{}' as trigger config.", cfg->minWidth, cfg->maxWidth);
+			return false;
+		}
+		
+		if ((cfg->type == TRIG_TYPE_SEQUENCE) && ((!cfg->stages) || (cfg->stages > TRIG_SEQ_STAGES))) {
+			SPDLOG_ERROR("Invalid stage count '{}' as trigger config.", cfg->stages);
+			return false;
+		}
+		
+		if (cfg->pre > TRIG_MAX_PRE) {
+			SPDLOG_ERROR("Invalid pre-trigger count '{}' as trigger config.", cfg->pre);
+			return false;
+		}
+		
+		return true;
+	}
+	
+private:
+	//! Helper function to add sample to output storage.
+	//! @param[in] smp Sample to be added.
+	//! @param[in,out] data Storage to be filled with data.
+	static void addSample(const ch_sample &smp, std::deque<uint8_t> &data) {
+		const uint8_t *psmp = reinterpret_cast<const uint8_t*>(&smp);
+		data.insert(data.end(), psmp, psmp + sizeof(smp));
+	}
+	
+	//! Helper function to (re)start waiting for trigger condition. Condition tracking is kept so that
+	//! level-based trigger won't fire again until its condition is left and re-entered.
+	void arm() {
+		state = TRIG_STATE_ARMED;
+		ringHead = 0u;
+		ringQt = 0u;
+		postLeft = 0u;
+	}
+	
+	//! Evaluates trigger condition with new sample.
+	//! @param[in] smp New sample.
+	//! @return True if trigger fires at this sample.
+	bool check(const ch_sample &smp) {
+		const bool pinLevel = smp.level & (1u << cfg.pin);
+		bool result = false;
+		
+		switch (cfg.type) {
+		case TRIG_TYPE_EDGE:
+			if (hasPrev && (pinLevel != prevPin)) {
+				result = (cfg.polarity & (pinLevel ? TRIG_EDGE_RISING : TRIG_EDGE_FALLING));
+			}
+			break;
+		case TRIG_TYPE_PATTERN:										//fires on entering pattern only
+			{
+				const bool match = ((smp.level & cfg.mask[0]) == cfg.value[0]);
+				result = match && !matched;
+				matched = match;
+			}
+			break;
+		case TRIG_TYPE_PULSE:										//fires at end of pulse
+			if (hasPrev && (pinLevel != prevPin)) {
+				if (pinLevel == !!cfg.polarity) {					//pulse starts
+					pulseTs = smp.ts;
+					matched = true;
+				}
+				else if (matched) {									//pulse ends
+					const uint64_t width = smp.ts - pulseTs;
+					result = (width >= cfg.minWidth) && (width <= cfg.maxWidth);
+					matched = false;
+				}
+			}
+			break;
+		case TRIG_TYPE_SEQUENCE:									//one stage advance per sample at most
+			if ((smp.level & cfg.mask[stage]) == cfg.value[stage]) {
+				if (++stage >= cfg.stages) {
+					result = true;
+					stage = 0u;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+		
+		hasPrev = true;
+		prevPin = pinLevel;
+		
+		return result;
+	}
+	
+	trig_config cfg;
+	std::vector<ch_sample> ring;									//!< Pre-trigger samples ring buffer.
+	size_t ringHead;												//!< Oldest sample index in \ref ring.
+	size_t ringQt;													//!< Sample count in \ref ring.
+	uint64_t firedTs;												//!< Last trigger sample timestamp.
+	uint64_t pulseTs;												//!< Pulse start timestamp.
+	uint32_t fired;													//!< Fired count since config set.
+	uint32_t postLeft;												//!< Remaining post-trigger samples.
+	uint8_t stage;													//!< Sequence trigger current stage.
+	uint8_t state;													//!< One of TRIG_STATE_* values.
+	bool hasPrev;													//!< Has seen sample after arming.
+	bool matched;													//!< Pattern matched or pulse started.
+	bool prevPin;													//!< Previous sample pin level.
+};
+
+//! Channel index -&gt; trigger object.
+static std::map<uint8_t, std::shared_ptr<Trigger>> channels;
+
+//! Gets channel trigger status.
+//! @param[in] idx Target channel index.
+//! @param[out] status Trigger status object.
+//! @return True if target channel is found.
+bool getTriggerStatus(uint8_t idx, trig_status *status) {
+	auto iter = channels.find(idx);
+	
+	if (iter == channels.end()) {
+		SPDLOG_ERROR("Channel {} not found to get trigger status.", idx);
+		return false;
+	}
+	
+	std::shared_ptr<Trigger>{iter->second}->getStatus(status);
+	
+	return true;
+}
+
+//! Re-arms existing channel trigger, e.g. after single-shot capture is done.
+//! @param[in] idx Target channel index.
+//! @return True if target channel is found.
+bool resetTrigger(uint8_t idx) {
+	auto iter = channels.find(idx);
+	
+	if (iter == channels.end()) {
+		SPDLOG_ERROR("Channel {} not found for trigger reset.", idx);
+		return false;
+	}
+	
+	iter->second->reset();
+	SPDLOG_INFO("Channel {} trigger re-armed.", idx);
+	
+	return true;
+}
+
+//! Sets channel trigger config. Will add the channel if not exists. Will remove existing channel if \b cfg is
+//! not valid.
+//! @param[in] idx Target channel index.
+//! @param[in] cfg New trigger config.
+//! @return True as long \b cfg is valid.
+bool setTriggerConfig(uint8_t idx, const trig_config *cfg) {
+	auto iter = channels.find(idx);
+	
+	if (!Trigger::validateConfig(cfg)) {
+		if (iter != channels.end()) {
+			channels.erase(iter);
+		}
+		return false;
+	}
+	
+	if (iter == channels.end()) {
+		auto obj = new(std::nothrow) Trigger();
+		
+		if (obj) {
+			std::shared_ptr<Trigger> channel{obj};
+			iter = channels.emplace(idx, channel).first;
+			
+			SPDLOG_INFO("Channel {} trigger added.", idx);
+		}
+		else {
+			SPDLOG_ERROR("Error allocating new channel {} trigger object.", idx);
+			return false;
+		}
+	}
+	
+	iter->second->setConfig(cfg);
+	SPDLOG_INFO("Channel {} trigger config set - type:{} pin:{} pre:{} post:{}", idx, cfg->type, cfg->pin,
+		cfg->pre, cfg->post);
+	
+	return true;
+}
+
+//! Passes interpreted samples through channel trigger, keeping only pre- and post-trigger capture window.
+//! @param[in] idx Target channel index.
+//! @param[in] samples Interpreted samples, in timestamp order.
+//! @param[in] count Sample count in \b samples.
+//! @param[in,out] data Storage to be filled with data.
+//! @param[in] maxSz \b data size won't be larger than this value after filling.
+//! @return True if channel trigger exists and there's enough space for data.
+bool triggerData(uint8_t idx, const ch_sample *samples, size_t count, std::deque<uint8_t> &data,
+size_t maxSz) {
+	auto iter = channels.find(idx);
+	if (iter == channels.end()) {
+		SPDLOG_ERROR("Channel {} not found for trigger.", idx);
+		return false;
+	}
+	
+	std::shared_ptr<Trigger> channel{iter->second};
+	
+	//every trigger flushes pre-trigger samples collected since last capture, so output never exceeds this
+	const size_t needSz = sizeof(ch_sample) * (count + channel->getPreCount());
+	if ((data.size() > maxSz) || ((maxSz - data.size()) < needSz)) {
+		SPDLOG_ERROR("Storage space not enough for channel {} trigger.", idx);
+		return false;
+	}
+	
+	channel->proc(samples, count, data);
+	
+	return true;
+}
@@ -0,0 +1,34 @@
+#ifndef HOST_HARDWARE_DMA_H
+#define HOST_HARDWARE_DMA_H
+
+//! Host stand-in for Pico SDK header, only what logic analyser uses. Transfer from PIO RX FIFO is simulated in
+//! full when waited for.
+
+#include <pico/types.h>
+
+#define NUM_DMA_CHANNELS 12u
+
+enum dma_channel_transfer_size {
+	DMA_SIZE_8 = 0u,
+	DMA_SIZE_16 = 1u,
+	DMA_SIZE_32 = 2u
+};
+
+typedef struct {
+	uint dreq;
+	enum dma_channel_transfer_size size;
+	bool read_increment;
+	bool write_increment;
+} dma_channel_config;
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+int dma_claim_unused_channel(bool required);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+	const volatile void *read_addr, uint transfer_count, bool trigger);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+
+#endif
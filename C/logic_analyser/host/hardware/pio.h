@@ -0,0 +1,68 @@
+#ifndef HOST_HARDWARE_PIO_H
+#define HOST_HARDWARE_PIO_H
+
+//! Host stand-in for Pico SDK header, only what logic analyser uses. State machine only models "in" instruction
+//! with autopush, fed by \ref host_sim_gpio.
+
+#include <pico/types.h>
+
+#define NUM_PIO_STATE_MACHINES	4u
+#define PIO_INSTRUCTION_COUNT	32u
+
+typedef struct {
+	volatile uint32_t rxf[NUM_PIO_STATE_MACHINES];					//!< RX FIFO, per state machine.
+	uint32_t used_instr;											//!< Used instruction memory slot count.
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t host_pio0, host_pio1;
+#define pio0 (&host_pio0)
+#define pio1 (&host_pio1)
+
+enum pio_src_dest {
+	pio_pins = 0u
+};
+
+enum pio_fifo_join {
+	PIO_FIFO_JOIN_NONE = 0u,
+	PIO_FIFO_JOIN_TX = 1u,
+	PIO_FIFO_JOIN_RX = 2u
+};
+
+struct pio_program {
+	const uint16_t *instructions;
+	uint8_t length;
+	int8_t origin;
+};
+
+typedef struct {
+	float clkdiv;
+	uint in_base;
+	uint wrap_target;
+	uint wrap;
+	uint push_threshold;
+	bool in_shift_right;
+	bool autopush;
+	enum pio_fifo_join join;
+} pio_sm_config;
+
+//! Same encoding as hardware, bit count 32 is encoded as 0.
+static inline uint pio_encode_in(enum pio_src_dest src, uint count) {
+	return 0x4000u | ((uint) src << 5u) | (count & 0x1Fu);
+}
+
+uint pio_add_program(PIO pio, const struct pio_program *program);
+bool pio_can_add_program(PIO pio, const struct pio_program *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+pio_sm_config pio_get_default_sm_config();
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void sm_config_set_clkdiv(pio_sm_config *c, float div);
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join);
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base);
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold);
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap);
+
+#endif
@@ -0,0 +1,242 @@
+#include "host_sim.h"
+
+#include <hardware/dma.h>
+#include <hardware/pio.h>
+#include <pico/multicore.h>
+
+#include <stdio.h>
+#include <string.h>
+
+//! Simulated state machine.
+typedef struct {
+	pio_sm_config cfg;
+	uint32_t cycle;													//!< Sample index since enabled.
+	uint pc;														//!< Program counter, fixed for 1 instruction wrap.
+	bool claimed;
+	bool enabled;
+} host_sm;
+
+//! Simulated DMA channel.
+typedef struct {
+	dma_channel_config cfg;
+	volatile uint8_t *write_addr;
+	const volatile void *read_addr;
+	uint transfer_count;
+	bool claimed;
+} host_dma;
+
+pio_hw_t host_pio0, host_pio1;
+host_sim_gpio_fn host_sim_gpio = NULL;
+
+static uint16_t pio_instr[2][PIO_INSTRUCTION_COUNT];
+static host_sm pio_sms[2][NUM_PIO_STATE_MACHINES];
+static host_dma dma_channels[NUM_DMA_CHANNELS];
+
+//! Helper function to get PIO instance index.
+static uint pio_idx(PIO pio) {
+	return (pio == pio0) ? 0u : 1u;
+}
+
+//! Helper function to run state machine until next autopush.
+//! @return Pushed ISR value.
+static uint32_t run_sm(PIO pio, uint sm) {
+	host_sm *const state = pio_sms[pio_idx(pio)] + sm;
+	const uint16_t instr = pio_instr[pio_idx(pio)][state->pc];
+	const uint bit_count = (instr & 0x1Fu) ? (instr & 0x1Fu) : 32u;
+	const uint64_t mask = (1ull << bit_count) - 1u;
+	uint64_t isr = 0u;
+	uint shift_count = 0u;
+	
+	do {
+		const uint32_t gpio = host_sim_gpio ? host_sim_gpio(state->cfg.in_base, state->cycle) : 0u;
+		const uint64_t data = (((uint64_t) gpio | ((uint64_t) gpio << 32u)) >> state->cfg.in_base) & mask;
+		
+		++state->cycle;
+		isr = state->cfg.in_shift_right ? ((isr >> bit_count) | (data << (32u - bit_count))) :
+			((isr << bit_count) | data);
+		shift_count += bit_count;
+	} while (shift_count < state->cfg.push_threshold);
+	
+	return (uint32_t) isr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+	c->dreq = dreq;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+	c->read_increment = incr;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+	c->size = size;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+	c->write_increment = incr;
+}
+
+int dma_claim_unused_channel(bool required) {
+	for (uint channel = 0u; channel < NUM_DMA_CHANNELS; ++channel) {
+		if (!dma_channels[channel].claimed) {
+			dma_channels[channel].claimed = true;
+			return channel;
+		}
+	}
+	
+	if (required) {
+		printf("No free DMA channel is required.\n");
+	}
+	
+	return -1;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+const volatile void *read_addr, uint transfer_count, bool trigger) {
+	(void) trigger;
+	
+	dma_channels[channel].cfg = *config;
+	dma_channels[channel].write_addr = write_addr;
+	dma_channels[channel].read_addr = read_addr;
+	dma_channels[channel].transfer_count = transfer_count;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+	(void) channel;
+	
+	const dma_channel_config result = {
+		.dreq = 0x3Fu,
+		.size = DMA_SIZE_32,
+		.read_increment = true,
+		.write_increment = false
+	};
+	
+	return result;
+}
+
+//! Only transfer from PIO RX FIFO is simulated, in little-endian byte lanes as on hardware.
+void dma_channel_wait_for_finish_blocking(uint channel) {
+	host_dma *const dma = dma_channels + channel;
+	const uint size = 1u << dma->cfg.size;
+	PIO pio = NULL;
+	uint sm = 0u;
+	
+	for (uint idx = 0u; idx < 2u; ++idx) {
+		PIO candidate = idx ? pio1 : pio0;
+		
+		for (uint candidate_sm = 0u; candidate_sm < NUM_PIO_STATE_MACHINES; ++candidate_sm) {
+			if (dma->read_addr == (const volatile void*) (candidate->rxf + candidate_sm)) {
+				pio = candidate;
+				sm = candidate_sm;
+			}
+		}
+	}
+	
+	if (!pio || !pio_sms[pio_idx(pio)][sm].enabled || !pio_sms[pio_idx(pio)][sm].cfg.autopush) {
+		printf("DMA channel %u source is not simulated, would block forever.\n", channel);
+		return;
+	}
+	
+	for (uint transfer = 0u; transfer < dma->transfer_count; ++transfer) {
+		const uint32_t val = run_sm(pio, sm);
+		
+		memcpy((void*) dma->write_addr, &val, size);
+		if (dma->cfg.write_increment) {
+			dma->write_addr += size;
+		}
+	}
+	dma->transfer_count = 0u;
+}
+
+void host_sim_reset() {
+	memset(&host_pio0, 0, sizeof(host_pio0));
+	memset(&host_pio1, 0, sizeof(host_pio1));
+	memset(pio_instr, 0, sizeof(pio_instr));
+	memset(pio_sms, 0, sizeof(pio_sms));
+	memset(dma_channels, 0, sizeof(dma_channels));
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+	entry();
+}
+
+uint pio_add_program(PIO pio, const struct pio_program *program) {
+	const uint offset = pio->used_instr;
+	
+	memcpy(pio_instr[pio_idx(pio)] + offset, program->instructions, program->length * sizeof(uint16_t));
+	pio->used_instr += program->length;
+	
+	return offset;
+}
+
+bool pio_can_add_program(PIO pio, const struct pio_program *program) {
+	return (pio->used_instr + program->length) <= PIO_INSTRUCTION_COUNT;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+	for (uint sm = 0u; sm < NUM_PIO_STATE_MACHINES; ++sm) {
+		if (!pio_sms[pio_idx(pio)][sm].claimed) {
+			pio_sms[pio_idx(pio)][sm].claimed = true;
+			return sm;
+		}
+	}
+	
+	if (required) {
+		printf("No free state machine is required.\n");
+	}
+	
+	return -1;
+}
+
+pio_sm_config pio_get_default_sm_config() {
+	const pio_sm_config result = {
+		.clkdiv = 1.0f,
+		.in_base = 0u,
+		.wrap_target = 0u,
+		.wrap = PIO_INSTRUCTION_COUNT - 1u,
+		.push_threshold = 32u,
+		.in_shift_right = true,
+		.autopush = false,
+		.join = PIO_FIFO_JOIN_NONE
+	};
+	
+	return result;
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) {
+	return (pio_idx(pio) * 8u) + (is_tx ? 0u : 4u) + sm;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+	pio_sms[pio_idx(pio)][sm].cfg = *config;
+	pio_sms[pio_idx(pio)][sm].pc = initial_pc;
+	pio_sms[pio_idx(pio)][sm].cycle = 0u;
+	pio_sms[pio_idx(pio)][sm].enabled = false;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+	pio_sms[pio_idx(pio)][sm].enabled = enabled;
+}
+
+void sm_config_set_clkdiv(pio_sm_config *c, float div) {
+	c->clkdiv = div;
+}
+
+void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) {
+	c->join = join;
+}
+
+void sm_config_set_in_pins(pio_sm_config *c, uint in_base) {
+	c->in_base = in_base;
+}
+
+void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold) {
+	c->in_shift_right = shift_right;
+	c->autopush = autopush;
+	c->push_threshold = push_threshold ? push_threshold : 32u;
+}
+
+void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap) {
+	c->wrap_target = wrap_target;
+	c->wrap = wrap;
+}
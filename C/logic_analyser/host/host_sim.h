@@ -0,0 +1,16 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <pico/types.h>
+
+//! Synthetic GPIO source for simulated state machines.
+//! @param[in] in_base State machine "in" base pin, to tell pin groups apart.
+//! @param[in] cycle State machine sample index, since it was enabled.
+//! @return All GPIO levels, 1 bit per pin.
+typedef uint32_t (*host_sim_gpio_fn)(uint in_base, uint32_t cycle);
+
+extern host_sim_gpio_fn host_sim_gpio;
+
+void host_sim_reset();
+
+#endif
@@ -0,0 +1,239 @@
+#include "host_sim.h"
+#include "logic_analyser.h"
+#include "utilities.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//! Simulated system clock, in Hz.
+#define SYS_CLOCK		125000000.0f
+
+//! Samples unpacked at a time in benchmark.
+#define BENCH_CHUNK_SZ	4096u
+
+capture_pin_group_config capture_pin_group_cfgs[] = {
+	{
+		.buf = NULL,
+		.rate = 400000u,
+		.sample_count = 1048576u,
+		.pin_base = 25u,
+		.pin_count = 1u
+	},
+	{
+		.buf = NULL,
+		.rate = 500u,
+		.sample_count = 2500u,
+		.pin_base = 6u,
+		.pin_count = 2u
+	},
+	{
+		.buf = NULL,
+		.rate = 1000000u,
+		.sample_count = 100003u,
+		.pin_base = 30u,												//wraps around to pin 1
+		.pin_count = 4u
+	}
+};
+
+uint32_t bench_count = 1u << 24u;
+
+//! Synthetic GPIO levels, with both long static periods and bursts of toggling.
+uint32_t gpio_pattern(uint in_base, uint32_t cycle) {
+	uint32_t hash = ((cycle >> 4u) ^ (in_base * 0x9E3779B9u)) * 0x85EBCA6Bu;
+	hash ^= hash >> 13u;
+	
+	if (hash & 0x300u) {											//static most of the time
+		return 0x0F0F0F0Fu << (in_base & 3u);
+	}
+	
+	return hash * (cycle | 1u);
+}
+
+//! Helper function to get expected sample, as seen by pin group.
+uint8_t expected_sample(const capture_pin_group_config *capture_cfg, uint32_t sample_idx) {
+	const uint32_t gpio = gpio_pattern(capture_cfg->pin_base, sample_idx);
+	const uint64_t pins = ((uint64_t) gpio | ((uint64_t) gpio << 32u)) >> capture_cfg->pin_base;
+	
+	return pins & ((1u << capture_cfg->pin_count) - 1u);
+}
+
+//! Helper function to parse command-line arguments.
+bool parse_args(int argc, char **args) {
+	int opt;
+	bool result = true;
+	
+	while ((opt = getopt(argc, args, "b:")) != -1) {
+		switch (opt) {
+			case 'b':
+				bench_count = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				result = false;
+				break;
+		}
+	}
+	
+	if (!result) {
+		printf("Usage:\t%s [-b benchmark sample count per pin count, 0 to skip (default %u)]\n", args[0],
+			1u << 24u);
+		printf("Simulated capture is printed into buffer and checked against synthetic pin data.\n");
+	}
+	
+	return result;
+}
+
+//! Helper function to check printed result against synthetic pin data.
+//! @param[in] text Printed result, as received over UART (7-bit).
+//! @param[in] size Printed result size, in bytes.
+//! @return True if every section matches.
+bool check_result(const char *text, size_t size) {
+	size_t pos = 0u;
+	
+	for (size_t cfg_idx = 0u; cfg_idx < (sizeof(capture_pin_group_cfgs) / sizeof(*capture_pin_group_cfgs));
+	++cfg_idx) {
+		const capture_pin_group_config *const capture_cfg = capture_pin_group_cfgs + cfg_idx;
+		unsigned vals[4];
+		int len = 0;
+		uint32_t run = 0u, sample_idx = 0u;
+		uint8_t run_shift = 0u, last = 0u;
+		const size_t start = pos;
+		
+		if ((sscanf(text + pos, "{base:%u count:%u sample:%u rate:%u rle}%n", &vals[0], &vals[1], &vals[2],
+		&vals[3], &len) != 4) || !len || (vals[0] != capture_cfg->pin_base) ||
+		(vals[1] != capture_cfg->pin_count) || (vals[2] != capture_cfg->sample_count) ||
+		(vals[3] != capture_cfg->rate)) {
+			printf("Section %zu start marker is missing.\n", cfg_idx);
+			return false;
+		}
+		pos += len;
+		
+		while (sample_idx < capture_cfg->sample_count) {
+			if (pos >= size) {
+				printf("Section %zu is cut short at sample %u.\n", cfg_idx, sample_idx);
+				return false;
+			}
+			
+			const uint8_t val = text[pos++];
+			
+			if (!(val & RLE_RUN_FLAG)) {
+				last = val;
+				run = 1u;
+			}
+			else {
+				run |= (uint32_t) (val & ((1u << RLE_RUN_BITS) - 1u)) << run_shift;
+				run_shift += RLE_RUN_BITS;
+				if (val & RLE_RUN_MORE) {
+					continue;
+				}
+				run_shift = 0u;
+			}
+			
+			for (; run && (sample_idx < capture_cfg->sample_count); --run, ++sample_idx) {
+				if (last != expected_sample(capture_cfg, sample_idx)) {
+					printf("Section %zu sample %u is %u instead of %u.\n", cfg_idx, sample_idx, last,
+						expected_sample(capture_cfg, sample_idx));
+					return false;
+				}
+			}
+		}
+		
+		len = 0;
+		if ((sscanf(text + pos, "{base:%*u count:%*u sample:%*u rate:%*u end}%n", &len) != 0) || !len) {
+			printf("Section %zu end marker is missing.\n", cfg_idx);
+			return false;
+		}
+		pos += len;
+		
+		printf("Section %zu: %u sample(s) in %zu byte(s), matched.\n", cfg_idx, capture_cfg->sample_count,
+			pos - start);
+	}
+	
+	return true;
+}
+
+//! Benchmarks unpacking loop, for every valid pin count.
+void run_benchmark() {
+	static const uint8_t pin_counts[] = {1u, 2u, 4u};
+	uint8_t samples[BENCH_CHUNK_SZ];
+	
+	for (size_t count_idx = 0u; count_idx < sizeof(pin_counts); ++count_idx) {
+		capture_pin_group_config capture_cfg = {
+			.rate = 1u,
+			.sample_count = bench_count,
+			.pin_count = pin_counts[count_idx]
+		};
+		const uint32_t bit_count = capture_cfg.sample_count * capture_cfg.pin_count;
+		uint32_t checksum = 0u;
+		struct timespec from, to;
+		
+		capture_cfg.buf_sz = (bit_count / 8u) + (bool)(bit_count % 8);
+		capture_cfg.buf = malloc(capture_cfg.buf_sz);
+		if (!capture_cfg.buf) {
+			printf("Error allocating benchmark buffer.\n");
+			return;
+		}
+		for (size_t idx = 0u; idx < capture_cfg.buf_sz; ++idx) {
+			capture_cfg.buf[idx] = rand();
+		}
+		
+		clock_gettime(CLOCK_MONOTONIC, &from);
+		for (uint32_t sample_idx = 0u; sample_idx < capture_cfg.sample_count; sample_idx += BENCH_CHUNK_SZ) {
+			const uint32_t chunk = ((capture_cfg.sample_count - sample_idx) < BENCH_CHUNK_SZ) ?
+				(capture_cfg.sample_count - sample_idx) : BENCH_CHUNK_SZ;
+			
+			unpack_logic_analyser_result(&capture_cfg, sample_idx, chunk, samples);
+			checksum += samples[chunk - 1u];							//keeps result alive
+		}
+		clock_gettime(CLOCK_MONOTONIC, &to);
+		
+		const double sec = (to.tv_sec - from.tv_sec) + (to.tv_nsec - from.tv_nsec) * 1e-9;
+		printf("Unpacking pin count %u: %u sample(s) in %.3f s, %.1f Msample/s (checksum %u).\n",
+			capture_cfg.pin_count, capture_cfg.sample_count, sec, capture_cfg.sample_count / sec * 1e-6,
+			checksum);
+		
+		free(capture_cfg.buf);
+	}
+}
+
+int main(int argc, char **args) {
+	if (!parse_args(argc, args)) {
+		return -1;
+	}
+	
+	host_sim_reset();
+	host_sim_gpio = gpio_pattern;
+	start_logic_analyser(capture_pin_group_cfgs,
+		sizeof(capture_pin_group_cfgs) / sizeof(*capture_pin_group_cfgs), pio0, SYS_CLOCK);
+	
+	//printed result goes into buffer instead of UART
+	char *out = NULL;
+	size_t out_sz = 0u;
+	FILE *console = stdout;
+	
+	stdout = open_memstream(&out, &out_sz);
+	if (!stdout) {
+		stdout = console;
+		printf("Error opening print buffer.\n");
+		return -1;
+	}
+	const bool printed = print_logic_analyser_result();
+	fclose(stdout);
+	stdout = console;
+	
+	//undo send_data() adjustment for serial UART, as receiver does
+	for (size_t idx = 0u; idx < out_sz; ++idx) {
+		out[idx] = (out[idx] >> 1u) & 0x7F;
+	}
+	
+	const bool result = printed && check_result(out, out_sz);
+	free(out);
+	
+	if (result && bench_count) {
+		run_benchmark();
+	}
+	
+	return result ? 0 : -1;
+}
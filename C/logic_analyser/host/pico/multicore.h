@@ -0,0 +1,11 @@
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+//! Host stand-in for Pico SDK header, only what logic analyser uses.
+
+#include <pico/types.h>
+
+//! Runs entry to completion on caller thread, as core 1 has nothing to race with in simulation.
+void multicore_launch_core1(void (*entry)(void));
+
+#endif
@@ -7,6 +7,9 @@
 #include <assert.h>
 #include <stdlib.h>
 
+//! Samples unpacked at a time for printing.
+#define UNPACK_CHUNK_SZ 64u
+
 capture_pin_group_config *own_cfgs = NULL;
 PIO own_pio = NULL;
 size_t own_cfg_count = 0u;
@@ -110,7 +113,7 @@ bool is_logic_analyser_started() {
 	return logic_analyser_started;
 }
 
-//! Prints logic analyser result as binary data.
+//! Prints logic analyser result as run-length encoded binary data.
 //! @return True if logic analyser has started before this and not active (has finished running).
 bool print_logic_analyser_result() {
 	bool result;
@@ -126,26 +129,33 @@ bool print_logic_analyser_result() {
 	else {
 		for (size_t cfg_idx = 0u; cfg_idx < own_cfg_count; ++cfg_idx) {
 			capture_pin_group_config *const capture_cfg = own_cfgs + cfg_idx;
-			size_t idx = 0u;
-			uint8_t mask = 0u, mask_shift = 0u;
-			
-			for (uint8_t pin = 0u; pin < capture_cfg->pin_count; ++pin) {
-				mask |= (1u << pin);
-			}
+			uint32_t chunk;
+			size_t symbol_count;
+			uint8_t samples[UNPACK_CHUNK_SZ], symbols[RLE_MAX_SYMBOLS];
+			rle_state rle;
 			
-			send_string("{base:%u count:%u sample:%u rate:%u start}", capture_cfg->pin_base,
+			//"rle" instead of "start": payload is run-length encoded, "sample" is still decoded sample count
+			rle_init(&rle);
+			send_string("{base:%u count:%u sample:%u rate:%u rle}", capture_cfg->pin_base,
 				capture_cfg->pin_count, capture_cfg->sample_count, capture_cfg->rate);
-			for (uint32_t sample_idx = 0u; sample_idx < capture_cfg->sample_count; ++sample_idx) {
-				assert(idx < capture_cfg->buf_sz);
-				
-				send_data((capture_cfg->buf[idx] & (mask << mask_shift)) >> mask_shift);
+			for (uint32_t sample_idx = 0u; sample_idx < capture_cfg->sample_count; sample_idx += chunk) {
+				chunk = capture_cfg->sample_count - sample_idx;
+				if (chunk > UNPACK_CHUNK_SZ) {
+					chunk = UNPACK_CHUNK_SZ;
+				}
 				
-				mask_shift += capture_cfg->pin_count;
-				if (mask_shift >= 8u) {
-					++idx;
-					mask_shift = 0u;
+				unpack_logic_analyser_result(capture_cfg, sample_idx, chunk, samples);
+				for (uint32_t idx = 0u; idx < chunk; ++idx) {
+					symbol_count = rle_encode(&rle, samples[idx], symbols);
+					for (size_t symbol_idx = 0u; symbol_idx < symbol_count; ++symbol_idx) {
+						send_data(symbols[symbol_idx]);
+					}
 				}
 			}
+			symbol_count = rle_finish(&rle, symbols);
+			for (size_t symbol_idx = 0u; symbol_idx < symbol_count; ++symbol_idx) {
+				send_data(symbols[symbol_idx]);
+			}
 			send_string("{base:%u count:%u sample:%u rate:%u end}", capture_cfg->pin_base,
 				capture_cfg->pin_count, capture_cfg->sample_count, capture_cfg->rate);
 		}
@@ -165,3 +175,32 @@ void start_logic_analyser(capture_pin_group_config *cfgs, size_t cfg_count, PIO
 	
 	multicore_launch_core1(core1_entry);
 }
+
+//! Unpacks captured samples, 1 byte per sample.
+//! @param[in] capture_cfg Config of finished capture.
+//! @param[in] first First sample index.
+//! @param[in] count Sample count, must be \b first + \b count &le; \b sample_count.
+//! @param[out] out Unpacked samples. Must be x &ge; \b count.
+void unpack_logic_analyser_result(const capture_pin_group_config *capture_cfg, uint32_t first, uint32_t count,
+uint8_t *out) {
+	const uint8_t per_byte = 8u / capture_cfg->pin_count;
+	size_t idx = first / per_byte;
+	uint8_t mask = 0u, mask_shift = (first % per_byte) * capture_cfg->pin_count;
+	
+	for (uint8_t pin = 0u; pin < capture_cfg->pin_count; ++pin) {
+		mask |= (1u << pin);
+	}
+	
+	for (uint32_t sample_idx = 0u; sample_idx < count; ++sample_idx) {
+		assert(idx < capture_cfg->buf_sz);
+		
+		//ISR shifts left, so earlier sample is in higher bits
+		out[sample_idx] = (capture_cfg->buf[idx] >> (8u - capture_cfg->pin_count - mask_shift)) & mask;
+		
+		mask_shift += capture_cfg->pin_count;
+		if (mask_shift >= 8u) {
+			++idx;
+			mask_shift = 0u;
+		}
+	}
+}
@@ -19,5 +19,7 @@ bool is_logic_analyser_active();
 bool is_logic_analyser_started();
 bool print_logic_analyser_result();
 void start_logic_analyser(capture_pin_group_config *cfgs, size_t cfg_count, PIO pio, float sys_clock);
+void unpack_logic_analyser_result(const capture_pin_group_config *capture_cfg, uint32_t first, uint32_t count,
+	uint8_t *out);
 
 #endif
@@ -2,9 +2,27 @@ import re
 
 samplingFile = 'sampling.bin'
 
+# Expands run-length encoded payload (see rle_encode() in utilities.c) back to 1 byte per sample.
+def decodeRle(payload):
+	result = bytearray()
+	run = shift = 0
+	
+	for val in payload:
+		if not (val & 0x40):
+			result.append(val & 0x3F)
+		else:
+			run |= (val & 0x1F) << shift
+			shift += 5
+			
+			if not (val & 0x20):
+				result.extend(result[-1:] * run)
+				run = shift = 0
+	
+	return bytes(result)
+
 with open(samplingFile, 'rb') as fp:
 	data = str(fp.read(),'ascii')
-	rgx = re.compile('{base:(\d+) count:(\d+) sample:(\d+) rate:(\d+) (start|end)}')
+	rgx = re.compile('{base:(\d+) count:(\d+) sample:(\d+) rate:(\d+) (start|rle|end)}')
 	
 	mtc = rgx.search(data)
 	offset = 0
@@ -13,13 +31,15 @@ with open(samplingFile, 'rb') as fp:
 	while mtc:
 		print(f"offset:{offset} inSect:{inSect} mtc:{mtc.group(5)}")
 		
-		if mtc.group(5) == 'start':
+		if mtc.group(5) in ('start', 'rle'):
 			inSect = True
+			isRle = mtc.group(5) == 'rle'
 		elif mtc.group(5) == 'end':
 			if inSect:
 				with open(f"sampling_{mtc.group(1)}_{mtc.group(2)}_{mtc.group(3)}_{mtc.group(4)}.bin", 'wb') \
 				as ofp:
-					ofp.write(data[offset:offset + mtc.start(0)].encode('ascii'))
+					payload = data[offset:offset + mtc.start(0)].encode('ascii')
+					ofp.write(decodeRle(payload) if isRle else payload)
 			
 				inSect = False
 			
@@ -37,3 +37,60 @@ void convert_to_hex(const uint8_t *data, uint32_t length, char *buf) {
 	}
 	buf[length * 2u] = '\0';
 }
+
+//! Helper function to write pending run as run symbols.
+//! @param[in,out] state Encoder state, pending run is cleared.
+//! @param[out] out Output symbols.
+//! @return Output symbol count.
+static size_t rle_put_run(rle_state *state, uint8_t *out) {
+	size_t len = 0u;
+	
+	while (state->run) {
+		const uint8_t digit = state->run & ((1u << RLE_RUN_BITS) - 1u);
+		
+		state->run >>= RLE_RUN_BITS;
+		out[len++] = RLE_RUN_FLAG | (state->run ? RLE_RUN_MORE : 0u) | digit;
+	}
+	
+	return len;
+}
+
+//! Resets run-length encoder, before each encoded stream.
+//! @param[out] state Encoder state.
+void rle_init(rle_state *state) {
+	state->run = 0u;
+	state->last = 0u;
+	state->has_last = false;
+}
+
+//! Adds sample to run-length encoded stream.
+//! @param[in,out] state Encoder state.
+//! @param[in] sample Sample value, must be x &le; \ref RLE_MAX_SAMPLE.
+//! @param[out] out Output symbols. Must be x &ge; \ref RLE_MAX_SYMBOLS.
+//! @return Output symbol count, 0 if sample is held as part of run.
+size_t rle_encode(rle_state *state, uint8_t sample, uint8_t *out) {
+	if (state->has_last && (sample == state->last)) {
+		++state->run;
+		return 0u;
+	}
+	
+	const size_t len = rle_put_run(state, out);
+	
+	state->last = sample;
+	state->has_last = true;
+	out[len] = sample & RLE_MAX_SAMPLE;
+	
+	return len + 1u;
+}
+
+//! Ends run-length encoded stream, with pending run.
+//! @param[in,out] state Encoder state.
+//! @param[out] out Output symbols. Must be x &ge; \ref RLE_MAX_SYMBOLS.
+//! @return Output symbol count.
+size_t rle_finish(rle_state *state, uint8_t *out) {
+	const size_t len = rle_put_run(state, out);
+	
+	rle_init(state);
+	
+	return len;
+}
@@ -2,8 +2,29 @@
 #define UTILITIES_H
 
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+//! Run-length encoded symbols, all 7-bit to be sent with \ref send_data().
+#define RLE_RUN_FLAG		0x40u									//!< Set: run symbol, clear: literal sample.
+#define RLE_RUN_MORE		0x20u									//!< Set: more run symbols follow.
+#define RLE_RUN_BITS		5u										//!< Run length bits per run symbol.
+#define RLE_MAX_SAMPLE		0x3Fu									//!< Largest sample value as literal.
+#define RLE_MAX_SYMBOLS		8u										//!< Max symbols per \ref rle_encode() call.
+
+//! Run-length encoder state. Repeats of last sample are counted, and sent as run length (LSB first, 5 bits per
+//! run symbol) right before next different sample.
+typedef struct {
+	uint32_t run;													//!< Pending repeat count of last sample.
+	uint8_t last;													//!< Last literal sample.
+	bool has_last;													//!< \b last is valid.
+} rle_state;
+
+void rle_init(rle_state *state);
+size_t rle_encode(rle_state *state, uint8_t sample, uint8_t *out);
+size_t rle_finish(rle_state *state, uint8_t *out);
+
 void send_data(char c);
 void send_string(const char *fmt, ...);
 
@@ -40,15 +40,42 @@ app.use((err, req, res, nextIgnored) => {
 const server = http.createServer(app);
 const serverWs = new ws.WebSocketServer({ server });
 
+let clientIdNext = 0;
+
 serverWs.on('connection', (client, req) => {
 	console.log(`WebSocket @${req.socket.remoteAddress} connected.`);
 	
+	client.id = clientIdNext;										//used as per-client WASM state key
+	client.decimation = null;
+	clientIdNext = (clientIdNext + 1) >>> 0;
+	
 	client.on('close', (code, reason) => {
 		console.log(`WebSocket @${req.socket.remoteAddress} disconnected: ${code} - ${reason}`);
+		logicAnalyser.removeClient(client.id);
 	});
 	client.on('error', console.error);
 	client.on('message', (data, isBinary) => {
 		console.log(`WebSocket @${req.socket.remoteAddress} binary:${isBinary}\n${data.toString()}.`);
+		
+		//e.g. {"decimation":{"mode":"lttb","budget":2000}}
+		if (!isBinary) {
+			let msg;
+			
+			try {
+				msg = JSON.parse(data.toString());
+			}
+			catch (err) {
+				console.warn(`WebSocket @${req.socket.remoteAddress} message not JSON: ${err}`);
+				return;
+			}
+			
+			if ((typeof(msg) === 'object') && (msg !== null) && ('decimation' in msg)) {
+				const err = logicAnalyser.setClientDecimation(client, msg.decimation);
+				if (err instanceof Error) {
+					console.warn(`WebSocket @${req.socket.remoteAddress} decimation error: ${err.message}`);
+				}
+			}
+		}
 	});
 });
 serverWs.on('error', err => console.error(`WebSocket server error: ${err}`));
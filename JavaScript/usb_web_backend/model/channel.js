@@ -10,8 +10,9 @@ const path = await import('node:path');
 import {argv} from 'node:process';
 const timers = await import('node:timers');
 
+//single reading yields gap marker sample at most on top of its samples
 const CH_DATA_SIZE = wasmIntf.ChData.SIZE_IN_BYTES * 16,
-	CH_SAMPLE_SIZE = wasmIntf.ChSample.SIZE_IN_BYTES * wasmIntf.ChData.SAMPLE_PER_READING;
+	CH_SAMPLE_SIZE = wasmIntf.ChSample.SIZE_IN_BYTES * (wasmIntf.ChData.SAMPLE_PER_READING + 1);
 const USE_DUMMY_DATA = argv.includes('useDummyData');
 
 if (USE_DUMMY_DATA) {
@@ -24,7 +25,10 @@ else {
 class Channel {
 	#buf;
 	#cfg;
+	#decClients;
 	#id;
+	#procStatus;
+	#serverWs;
 	#timer;
 	#timerFd;
 	#wasmMemData;
@@ -35,7 +39,10 @@ class Channel {
 	constructor(id) {
 		this.#buf = null;
 		this.#cfg = {pinbase: 0, pincount: 0, rate: 0};
+		this.#decClients = new Map();
 		this.#id = id;
+		this.#procStatus = null;
+		this.#serverWs = null;
 		this.#timer = null;
 		this.#timerFd = null;
 		this.#wasmMemData = null;
@@ -54,12 +61,26 @@ class Channel {
 		return this.#id;
 	}
 	
+	/** Getter for channel interpreter tag tracking status since sampling started.
+	 * @return {InterpStatus|undefined} Interpreter status object or none if there's error. */
+	get procStatus() {
+		return wasmIntf.getProcStatus(this.#id);
+	}
+	
 	/** Getter for channel sampling operation status based on timer existence.
 	 * @return {boolean} Operation status. */
 	get running() {
 		return (this.#timer !== null);
 	}
 	
+	/** Removes sample decimator of a client, possibly due to client disconnection.
+	 * @param {number} clientId Client ID. */
+	removeClient(clientId) {
+		if (this.#decClients.delete(clientId)) {
+			wasmIntf.removeDec(this.#id, clientId);
+		}
+	}
+	
 	/** Sets channel config. Will stop sampling before channel reconfiguration is done.
 	 * @param {ChConfig} cfg Config object, possibly from REST API request.
 	 * @param {string} pathSysfs sysfs-based configuration directory path. Must be valid.
@@ -142,6 +163,7 @@ class Channel {
 		if (!wasmIntf.resetProc(this.#id)) {
 			return new Error(` Error resetting channel ${this.#id} channel interpreter.`);
 		}
+		this.#procStatus = null;
 		//******************************************************************************
 		
 		if (!USE_DUMMY_DATA) {
@@ -175,6 +197,7 @@ class Channel {
 			//**************************************************************************
 		}
 		
+		this.#serverWs = serverWs;
 		this.#timer = timers.setInterval(async () => {
 			let dataQt;
 			
@@ -202,20 +225,28 @@ class Channel {
 			if (dataQt) {
 				const chSmps = wasmIntf.procData(this.#id, this.#wasmMemData, dataQt, this.#wasmMemSmp,
 					CH_SAMPLE_SIZE);
-				const strs = [];
+				this.#reportLoss();
+				let strAll = null;									//shared by clients without decimation
 				
-				chSmps.forEach(elem => {
-					strs.push(`${elem.ts}-${elem.level}`);
-				});
-				if (strs.length) {
-					const str = `${this.#id}:${strs.join(',')}`;
-				
-					serverWs.clients.forEach(client => {				//broadcast data
-						if (client.readyState === ws.WebSocket.OPEN) {
+				serverWs.clients.forEach(client => {					//broadcast data
+					if (client.readyState === ws.WebSocket.OPEN) {
+						let str;
+						
+						if (client.decimation) {
+							str = this.#toMessage(this.#decimate(client, chSmps));
+						}
+						else {
+							if (strAll === null) {
+								strAll = this.#toMessage(chSmps);
+							}
+							str = strAll;
+						}
+						
+						if (str.length) {
 							client.send(str);
 						}
-					});
-				}
+					}
+				});
 			}
 		}, 3000);
 		
@@ -236,7 +267,23 @@ class Channel {
 			this.#timerFd = null;
 		}
 		
+		this.#reportLoss();
+		
 		this.#buf = null;
+		for (const clientId of this.#decClients.keys()) {
+			const str = this.#toMessage(wasmIntf.flushDec(this.#id, clientId) ?? []);
+			
+			if (str.length) {										//samples held back in decimator buckets
+				this.#serverWs.clients.forEach(client => {
+					if ((client.id === clientId) && (client.readyState === ws.WebSocket.OPEN)) {
+						client.send(str);
+					}
+				});
+			}
+			wasmIntf.removeDec(this.#id, clientId);
+		}
+		this.#decClients.clear();
+		this.#serverWs = null;
 		if (this.#wasmMemData) {
 			wasmIntf.freeMem(this.#wasmMemData);
 			this.#wasmMemData = null;
@@ -248,6 +295,62 @@ class Channel {
 		
 		console.log(`Channel ${this.#id} stopped.`);
 	}
+	
+	/** Helper function to decimate samples for a client as per its decimation setting. Client decimator is
+	 * (re)configured whenever its setting or channel rate changes.
+	 * @param {Object} client WebSocket client with 'id' and 'decimation' properties.
+	 * @param {ChSample[]} chSmps Channel samples.
+	 * @return {ChSample[]} Decimated samples, or empty array if there's error. */
+	#decimate(client, chSmps) {
+		const {mode, budget} = client.decimation;
+		const key = `${mode}:${budget}:${this.#cfg.rate}`;
+		
+		if (this.#decClients.get(client.id) !== key) {
+			const cfg = new wasmIntf.DecConfig(mode, budget, this.#cfg.rate);
+			
+			if (!wasmIntf.setDecConfig(this.#id, client.id, cfg)) {
+				console.warn(`Channel ${this.#id} error setting client ${client.id} decimator config.`);
+				this.#decClients.delete(client.id);
+				return [];
+			}
+			
+			this.#decClients.set(client.id, key);
+		}
+		
+		const result = wasmIntf.decData(this.#id, client.id, chSmps);
+		if (result === undefined) {
+			console.warn(`Channel ${this.#id} error decimating samples for client ${client.id}.`);
+			return [];
+		}
+		
+		return result;
+	}
+	
+	/** Helper function to log interpreter counters whenever they change, so loss shows up while sampling
+	 * rather than only when channel stops. */
+	#reportLoss() {
+		const status = wasmIntf.getProcStatus(this.#id);
+		const prev = this.#procStatus;
+		
+		if (!status) {
+			return;
+		}
+		
+		if ((status.dropped !== (prev ? prev.dropped : 0n)) ||
+		(status.duplicates !== (prev ? prev.duplicates : 0)) ||
+		(status.reorders !== (prev ? prev.reorders : 0)) || (status.resyncs !== (prev ? prev.resyncs : 0))) {
+			console.warn(`Channel ${this.#id} readings lost:${status.dropped} gaps:${status.gaps} ` +
+				`duplicates:${status.duplicates} reorders:${status.reorders} resyncs:${status.resyncs}`);
+		}
+		this.#procStatus = status;
+	}
+	
+	/** Helper function to format samples as WebSocket message.
+	 * @param {ChSample[]} chSmps Channel samples.
+	 * @return {string} Message, or empty string if there's no sample. */
+	#toMessage(chSmps) {
+		return chSmps.length ? `${this.#id}:${chSmps.map(elem => `${elem.ts}-${elem.level}`).join(',')}` : '';
+	}
 }
 
 export default Channel;
\ No newline at end of file
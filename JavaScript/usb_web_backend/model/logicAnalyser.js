@@ -8,6 +8,7 @@
 
 import Channel from './channel.js';
 const utils = await import('../utils.js');
+const wasmIntf = await import('../wasm_cpp/interface.js');
 
 const fs = await import('node:fs/promises');
 const path = await import('node:path');
@@ -62,6 +63,14 @@ class LogicAnalyser {
 		return this.#channels[chId].cfg;
 	}
 	
+	/** Removes all per-client channel state, possibly due to client disconnection.
+	 * @param {number} clientId Client ID. */
+	removeClient(clientId) {
+		for (const channel of this.#channels) {
+			channel.removeClient(clientId);
+		}
+	}
+	
 	/** Restarts currently running channels, possibly due to cdev path reconfiguration.
 	 * @return {Object|undefined} Error object if there's error in starting channel(s). */
 	async restartChannels() {
@@ -196,6 +205,45 @@ class LogicAnalyser {
 		}
 	}
 	
+	/** Sets display decimation for samples broadcast to a client, applied to all channels.
+	 * @param {Object} client WebSocket client with 'id' property.
+	 * @param {Object} decimation Decimation setting object, possibly from WebSocket message. 'mode' is either
+	 *							  'none', 'minmax' or 'lttb', 'budget' is target points per second.
+	 * @return {Object|undefined} Error instance if there's error. */
+	setClientDecimation(client, decimation) {
+		if (typeof(decimation) !== 'object' || decimation === null) {
+			return new TypeError('Invalid decimation setting.');
+		}
+		
+		let mode;
+		switch (decimation.mode) {
+			case 'none':
+				mode = wasmIntf.DecConfig.MODE_NONE;
+				break;
+			case 'minmax':
+				mode = wasmIntf.DecConfig.MODE_MINMAX;
+				break;
+			case 'lttb':
+				mode = wasmIntf.DecConfig.MODE_LTTB;
+				break;
+			default:
+				return new RangeError(`Invalid decimation mode '${decimation.mode}'.`);
+		}
+		
+		if ((mode !== wasmIntf.DecConfig.MODE_NONE) &&
+		(!Number.isInteger(decimation.budget) || (decimation.budget <= 0))) {
+			return new RangeError('Decimation budget must be positive integer.');
+		}
+		
+		if (mode === wasmIntf.DecConfig.MODE_NONE) {
+			client.decimation = null;
+			this.removeClient(client.id);
+		}
+		else {
+			client.decimation = {mode: mode, budget: decimation.budget};
+		}
+	}
+	
 	/** Setter for directory containing character device files.
 	 * @param {CdevPath} pathCdev Path object, possibly from REST API request. Must have expected properties.
 	 * @return {Object|undefined} Error instance if there's error. */
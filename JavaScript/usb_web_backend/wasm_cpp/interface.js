@@ -135,7 +135,529 @@ export class ChData {
 	}
 }
 
+/** Channel display decimation config object, per channel per client.
+ * @typedef {Object} DecConfig
+ * @property {number} mode Decimation mode. Value must be either MODE_NONE, MODE_MINMAX or MODE_LTTB.
+ * @property {number} budget Target points per second. Ignored for MODE_NONE.
+ * @property {number} rate Channel sampling rate, in Hz. 1 <= x <= 125,000,000. */
+export class DecConfig {
+	static MODE_NONE = 0;
+	static MODE_MINMAX = 1;
+	static MODE_LTTB = 2;
+	static SIZE_IN_BYTES = 9;
+	
+	#mode;
+	#budget;
+	#rate;
+	
+	constructor(mode, budget, rate) {
+		this.#mode = mode;
+		this.#budget = budget;
+		this.#rate = rate;
+	}
+	
+	/** Getter for decimation mode. */
+	get mode() {
+		return this.#mode;
+	}
+	
+	/** Getter for target points per second. */
+	get budget() {
+		return this.#budget;
+	}
+	
+	/** Getter for channel sampling rate. */
+	get rate() {
+		return this.#rate;
+	}
+	
+	/** Gets current config to fill raw buffer.
+	 * @param {Object} dv DataView object for raw buffer. */
+	getToRaw(dv) {
+		dv.setUint8(0, this.#mode);
+		dv.setUint32(1, this.#budget, true);
+		dv.setUint32(5, this.#rate, true);
+	}
+}
+
+/** Channel interpreter tag tracking status object.
+ * @typedef {Object} InterpStatus
+ * @property {bigint} dropped Lost reading count.
+ * @property {number} gaps Tag gap occurrence count.
+ * @property {number} duplicates Duplicated reading count.
+ * @property {number} reorders Late (out of order) reading count.
+ * @property {number} resyncs Tag resynchronization count. */
+export class InterpStatus {
+	static SIZE_IN_BYTES = 24;
+	
+	#dropped;
+	#gaps;
+	#duplicates;
+	#reorders;
+	#resyncs;
+	
+	/** Constructor. */
+	constructor() {
+		this.#dropped = 0n;
+		this.#gaps = 0;
+		this.#duplicates = 0;
+		this.#reorders = 0;
+		this.#resyncs = 0;
+	}
+	
+	/** Getter for lost reading count. */
+	get dropped() {
+		return this.#dropped;
+	}
+	
+	/** Getter for tag gap occurrence count. */
+	get gaps() {
+		return this.#gaps;
+	}
+	
+	/** Getter for duplicated reading count. */
+	get duplicates() {
+		return this.#duplicates;
+	}
+	
+	/** Getter for late (out of order) reading count. */
+	get reorders() {
+		return this.#reorders;
+	}
+	
+	/** Getter for tag resynchronization count. */
+	get resyncs() {
+		return this.#resyncs;
+	}
+	
+	/** Sets current object from raw buffer.
+	 * @param {Object} dv DataView object for raw buffer. */
+	setFromRaw(dv) {
+		this.#dropped = dv.getBigUint64(0, true);
+		this.#gaps = dv.getUint32(8, true);
+		this.#duplicates = dv.getUint32(12, true);
+		this.#reorders = dv.getUint32(16, true);
+		this.#resyncs = dv.getUint32(20, true);
+	}
+}
+
+/** Sample merged across channels, on common time base. */
+export class MergeSample {
+	static SIZE_IN_BYTES = 10;
+	
+	#id;
+	#level;
+	#ts;
+	
+	/** Constructor. */
+	constructor() {
+		this.#id = 0;
+		this.#level = 0x00;
+		this.#ts = 0n;
+	}
+	
+	/** Getter for channel ID. */
+	get id() {
+		return this.#id;
+	}
+	
+	/** Getter for sample level. */
+	get level() {
+		return this.#level;
+	}
+	
+	/** Getter for sample time since capture start, in ns. */
+	get ts() {
+		return this.#ts;
+	}
+	
+	/** Sets current object from raw buffer.
+	 * @param {Object} dv DataView object for raw buffer.
+	 * @param {number} offset Raw buffer offset for current data. */
+	setFromRaw(dv, offset) {
+		this.#ts = dv.getBigUint64(offset, true);
+		this.#id = dv.getUint8(offset + 8);
+		this.#level = dv.getUint8(offset + 9);
+	}
+}
+
+/** Cross-channel merger status object.
+ * @typedef {Object} MergeStatus
+ * @property {bigint} late Dropped late sample count.
+ * @property {bigint} forced Sample count emitted before all channels progressed past it.
+ * @property {number} buffered Buffered sample count, all channels.
+ * @property {number} channels Channel count taking part. */
+export class MergeStatus {
+	static SIZE_IN_BYTES = 21;
+	
+	#late;
+	#forced;
+	#buffered;
+	#channels;
+	
+	/** Constructor. */
+	constructor() {
+		this.#late = 0n;
+		this.#forced = 0n;
+		this.#buffered = 0;
+		this.#channels = 0;
+	}
+	
+	/** Getter for dropped late sample count. */
+	get late() {
+		return this.#late;
+	}
+	
+	/** Getter for sample count emitted before all channels progressed past it. */
+	get forced() {
+		return this.#forced;
+	}
+	
+	/** Getter for buffered sample count. */
+	get buffered() {
+		return this.#buffered;
+	}
+	
+	/** Getter for channel count taking part. */
+	get channels() {
+		return this.#channels;
+	}
+	
+	/** Sets current object from raw buffer.
+	 * @param {Object} dv DataView object for raw buffer. */
+	setFromRaw(dv) {
+		this.#late = dv.getBigUint64(0, true);
+		this.#forced = dv.getBigUint64(8, true);
+		this.#buffered = dv.getUint32(16, true);
+		this.#channels = dv.getUint8(20);
+	}
+}
+
+/** Channel bus protocol decoder config object.
+ * @typedef {Object} ProtoConfig
+ * @property {number} type Protocol type. Either TYPE_UART, TYPE_SPI or TYPE_I2C.
+ * @property {number[]} pins Pin index within channel (0 = pin base) for each signal, up to PIN_COUNT entries.
+ *							 UART: RX. SPI: SCK, MOSI, MISO, CS (latter two optional). I2C: SCL, SDA.
+ * @property {number} mode UART: PARITY_NONE, PARITY_ODD or PARITY_EVEN. SPI: mode 0-3.
+ * @property {number} bits UART/SPI data bits, 5-8.
+ * @property {number} flags FLAG_LSB_FIRST and/or FLAG_INVERT bits.
+ * @property {number} baud UART baud rate.
+ * @property {number} rate Channel sampling rate, in Hz. */
+export class ProtoConfig {
+	static TYPE_UART = 0;
+	static TYPE_SPI = 1;
+	static TYPE_I2C = 2;
+	static PARITY_NONE = 0;
+	static PARITY_ODD = 1;
+	static PARITY_EVEN = 2;
+	static FLAG_LSB_FIRST = 0x01;
+	static FLAG_INVERT = 0x02;
+	static PIN_COUNT = 4;
+	static PIN_UNUSED = 0xFF;
+	static SIZE_IN_BYTES = 16;
+	
+	#type;
+	#pins;
+	#mode;
+	#bits;
+	#flags;
+	#baud;
+	#rate;
+	
+	constructor(type, pins, mode, bits, flags, baud, rate) {
+		this.#type = type;
+		this.#pins = pins;
+		this.#mode = mode;
+		this.#bits = bits;
+		this.#flags = flags;
+		this.#baud = baud;
+		this.#rate = rate;
+	}
+	
+	/** Getter for protocol type. */
+	get type() {
+		return this.#type;
+	}
+	
+	/** Getter for signal pin indexes. */
+	get pins() {
+		return this.#pins;
+	}
+	
+	/** Getter for UART parity or SPI mode. */
+	get mode() {
+		return this.#mode;
+	}
+	
+	/** Getter for data bits. */
+	get bits() {
+		return this.#bits;
+	}
+	
+	/** Getter for option bits. */
+	get flags() {
+		return this.#flags;
+	}
+	
+	/** Getter for UART baud rate. */
+	get baud() {
+		return this.#baud;
+	}
+	
+	/** Getter for channel sampling rate. */
+	get rate() {
+		return this.#rate;
+	}
+	
+	/** Gets current config to fill raw buffer.
+	 * @param {Object} dv DataView object for raw buffer. */
+	getToRaw(dv) {
+		dv.setUint8(0, this.#type);
+		
+		for (let idx = 0; idx < ProtoConfig.PIN_COUNT; ++idx) {
+			dv.setUint8(1 + idx, (idx < this.#pins.length) ? this.#pins[idx] : ProtoConfig.PIN_UNUSED);
+		}
+		
+		dv.setUint8(5, this.#mode);
+		dv.setUint8(6, this.#bits);
+		dv.setUint8(7, this.#flags);
+		dv.setUint32(8, this.#baud, true);
+		dv.setUint32(12, this.#rate, true);
+	}
+}
+
+/** Decoded bus protocol frame object. */
+export class ProtoFrame {
+	static KIND_DATA = 0;
+	static KIND_START = 1;
+	static KIND_STOP = 2;
+	static KIND_ADDR = 3;
+	static STATUS_FRAMING = 0x01;
+	static STATUS_PARITY = 0x02;
+	static STATUS_NACK = 0x04;
+	static SIZE_IN_BYTES = 16;
+	
+	#data;
+	#data2;
+	#duration;
+	#kind;
+	#status;
+	#ts;
+	
+	/** Constructor. */
+	constructor() {
+		this.#data = 0;
+		this.#data2 = 0;
+		this.#duration = 0;
+		this.#kind = ProtoFrame.KIND_DATA;
+		this.#status = 0;
+		this.#ts = 0n;
+	}
+	
+	/** Getter for UART/I2C data or SPI MOSI data. */
+	get data() {
+		return this.#data;
+	}
+	
+	/** Getter for SPI MISO data. */
+	get data2() {
+		return this.#data2;
+	}
+	
+	/** Getter for frame length, in samples. */
+	get duration() {
+		return this.#duration;
+	}
+	
+	/** Getter for frame kind. */
+	get kind() {
+		return this.#kind;
+	}
+	
+	/** Getter for frame status bits. */
+	get status() {
+		return this.#status;
+	}
+	
+	/** Getter for frame start sample timestamp. */
+	get ts() {
+		return this.#ts;
+	}
+	
+	/** Sets current object from raw buffer.
+	 * @param {Object} dv DataView object for raw buffer.
+	 * @param {number} offset Raw buffer offset for current data. */
+	setFromRaw(dv, offset) {
+		const prop = dv.getBigUint64(offset, true);
+		this.#ts = BigInt.asUintN(56, prop);						//rightmost 56 bits
+		this.#kind = Number(prop / 0x0100000000000000n);			//leftmost 8 bits
+		this.#duration = dv.getUint32(offset + 8, true);
+		this.#data = dv.getUint8(offset + 12);
+		this.#data2 = dv.getUint8(offset + 13);
+		this.#status = dv.getUint8(offset + 14);
+	}
+}
+
+/** Channel trigger config object.
+ * @typedef {Object} TrigConfig
+ * @property {number} type Trigger type. Either TYPE_EDGE, TYPE_PATTERN, TYPE_PULSE or TYPE_SEQUENCE.
+ * @property {number} pin Pin index within channel (0 = pin base) for edge and pulse trigger.
+ * @property {number} polarity Edge trigger: EDGE_RISING, EDGE_FALLING or EDGE_EITHER. Pulse trigger: 1 = high
+ *							   pulse, 0 = low pulse.
+ * @property {Array} stages Array of {mask, value} objects, up to MAX_STAGES. Pattern trigger uses first entry.
+ * @property {number} minWidth Pulse width lower limit, in samples.
+ * @property {number} maxWidth Pulse width upper limit, in samples.
+ * @property {number} pre Pre-trigger sample count.
+ * @property {number} post Post-trigger sample count.
+ * @property {boolean} rearm Whether to re-arm after capture. */
+export class TrigConfig {
+	static TYPE_EDGE = 0;
+	static TYPE_PATTERN = 1;
+	static TYPE_PULSE = 2;
+	static TYPE_SEQUENCE = 3;
+	static EDGE_RISING = 1;
+	static EDGE_FALLING = 2;
+	static EDGE_EITHER = 3;
+	static MAX_STAGES = 4;
+	static SIZE_IN_BYTES = 29;
+	
+	#type;
+	#pin;
+	#polarity;
+	#stages;
+	#minWidth;
+	#maxWidth;
+	#pre;
+	#post;
+	#rearm;
+	
+	constructor(type, pin, polarity, stages, minWidth, maxWidth, pre, post, rearm) {
+		this.#type = type;
+		this.#pin = pin;
+		this.#polarity = polarity;
+		this.#stages = stages;
+		this.#minWidth = minWidth;
+		this.#maxWidth = maxWidth;
+		this.#pre = pre;
+		this.#post = post;
+		this.#rearm = rearm;
+	}
+	
+	/** Getter for trigger type. */
+	get type() {
+		return this.#type;
+	}
+	
+	/** Getter for trigger pin index within channel. */
+	get pin() {
+		return this.#pin;
+	}
+	
+	/** Getter for edge/pulse trigger polarity. */
+	get polarity() {
+		return this.#polarity;
+	}
+	
+	/** Getter for pattern/sequence trigger stages. */
+	get stages() {
+		return this.#stages;
+	}
+	
+	/** Getter for pulse width lower limit. */
+	get minWidth() {
+		return this.#minWidth;
+	}
+	
+	/** Getter for pulse width upper limit. */
+	get maxWidth() {
+		return this.#maxWidth;
+	}
+	
+	/** Getter for pre-trigger sample count. */
+	get pre() {
+		return this.#pre;
+	}
+	
+	/** Getter for post-trigger sample count. */
+	get post() {
+		return this.#post;
+	}
+	
+	/** Getter for re-arm after capture flag. */
+	get rearm() {
+		return this.#rearm;
+	}
+	
+	/** Gets current config to fill raw buffer.
+	 * @param {Object} dv DataView object for raw buffer. */
+	getToRaw(dv) {
+		dv.setUint8(0, this.#type);
+		dv.setUint8(1, this.#pin);
+		dv.setUint8(2, this.#polarity);
+		dv.setUint8(3, this.#stages.length);
+		dv.setUint8(4, this.#rearm ? 1 : 0);
+		
+		for (let idx = 0; idx < TrigConfig.MAX_STAGES; ++idx) {
+			const stage = this.#stages[idx];
+			dv.setUint8(5 + idx, stage ? stage.mask : 0);
+			dv.setUint8(5 + TrigConfig.MAX_STAGES + idx, stage ? stage.value : 0);
+		}
+		
+		dv.setUint32(13, this.#minWidth, true);
+		dv.setUint32(17, this.#maxWidth, true);
+		dv.setUint32(21, this.#pre, true);
+		dv.setUint32(25, this.#post, true);
+	}
+}
+
+/** Channel trigger status object.
+ * @typedef {Object} TrigStatus
+ * @property {number} state Trigger state. Either STATE_ARMED, STATE_CAPTURING or STATE_DONE.
+ * @property {number} fired Fired count since config set.
+ * @property {bigint} ts Last trigger sample timestamp. */
+export class TrigStatus {
+	static STATE_ARMED = 0;
+	static STATE_CAPTURING = 1;
+	static STATE_DONE = 2;
+	static SIZE_IN_BYTES = 13;
+	
+	#state;
+	#fired;
+	#ts;
+	
+	/** Constructor. */
+	constructor() {
+		this.#state = TrigStatus.STATE_ARMED;
+		this.#fired = 0;
+		this.#ts = 0n;
+	}
+	
+	/** Getter for trigger state. */
+	get state() {
+		return this.#state;
+	}
+	
+	/** Getter for fired count since config set. */
+	get fired() {
+		return this.#fired;
+	}
+	
+	/** Getter for last trigger sample timestamp. */
+	get ts() {
+		return this.#ts;
+	}
+	
+	/** Sets current object from raw buffer.
+	 * @param {Object} dv DataView object for raw buffer. */
+	setFromRaw(dv) {
+		this.#state = dv.getUint8(0);
+		this.#fired = dv.getUint32(1, true);
+		this.#ts = dv.getBigUint64(5, true);
+	}
+}
+
 export class ChSample {
+	static GAP_TS = 0xFFFFFFFFFFFFFFn;
 	static SIZE_IN_BYTES = 8;
 	
 	#level;
@@ -157,6 +679,13 @@ export class ChSample {
 		return this.#ts;
 	}
 	
+	/** Gets current object to fill raw buffer.
+	 * @param {Object} dv DataView object for raw buffer.
+	 * @param {number} offset Raw buffer offset for current data. */
+	getToRaw(dv, offset) {
+		dv.setBigUint64(offset, (this.#ts * 0x0100n) | BigInt(this.#level), true);
+	}
+	
 	/** Sets current object from raw buffer.
 	 * @param {Object} dv DataView object for raw buffer.
 	 * @param {number} offset Raw buffer offset for current data. */
@@ -182,6 +711,64 @@ export function copyToMem(arr, raw) {
 	mod.HEAPU8.set(arr, raw);
 }
 
+/** Decimates channel samples for display, as per decimator config set for channel and client.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {number} client Client ID.
+ * @param {ChSample[]} chSmps Channel samples, in timestamp order.
+ * @return {Array|undefined} Array containing decimated ChSample objects or none if there's error. */
+export function decData(id, client, chSmps) {
+	//decimated samples never exceed input samples + 2 (held back from previous call)
+	const smpSz = ChSample.SIZE_IN_BYTES * chSmps.length, decSz = ChSample.SIZE_IN_BYTES * (chSmps.length + 2);
+	const rawSmp = mod._malloc(smpSz + decSz);
+	
+	if (rawSmp) {
+		const chSmpV = new DataView(mod.HEAPU8.buffer, rawSmp, smpSz + decSz);
+		let result = [];
+		
+		chSmps.forEach((elem, idx) => elem.getToRaw(chSmpV, ChSample.SIZE_IN_BYTES * idx));
+		
+		const decQt = mod.ccall('decData', 'number',
+			['number', 'number', 'number', 'number', 'number', 'number'],
+			[id, client, rawSmp, smpSz, rawSmp + smpSz, decSz]);
+		
+		if (decQt >= 0) {
+			for (let idx = 0; idx < decQt / ChSample.SIZE_IN_BYTES; ++idx) {
+				const chSmp = new ChSample();
+				chSmp.setFromRaw(chSmpV, smpSz + ChSample.SIZE_IN_BYTES * idx);
+				result.push(chSmp);
+			}
+		}
+		else {
+			console.error("Error decimating channel samples.");
+			result = undefined;
+		}
+		
+		mod._free(rawSmp);
+		
+		return result;
+	}
+	else {
+		console.error("Error allocating memory for channel sample decimation.");
+	}
+}
+
+/** Helper function to fetch merged samples from raw buffer.
+ * @param {Object} dv DataView object for raw buffer.
+ * @param {number} offset Raw buffer offset for first sample.
+ * @param {number} size Merged samples size, in bytes.
+ * @return {MergeSample[]} Array containing MergeSample objects. */
+function getMergeSamples(dv, offset, size) {
+	let result = [];
+	
+	for (let idx = 0; idx < size / MergeSample.SIZE_IN_BYTES; ++idx) {
+		const smp = new MergeSample();
+		smp.setFromRaw(dv, offset + MergeSample.SIZE_IN_BYTES * idx);
+		result.push(smp);
+	}
+	
+	return result;
+}
+
 /** Shuts down overall interface system. */
 export function exitSys() {
 	mod.ccall('exitSys', null);
@@ -193,6 +780,77 @@ export function freeMem(raw) {
 	mod._free(raw);
 }
 
+/** Emits samples held back by channel sample decimator for specific client, e.g. when channel stops.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {number} client Client ID.
+ * @return {Array|undefined} Array containing decimated ChSample objects or none if there's error. */
+export function flushDec(id, client) {
+	//at most 2 samples held back (min/max pair or LTTB pending buckets)
+	const decSz = ChSample.SIZE_IN_BYTES * 2;
+	const rawSmp = mod._malloc(decSz);
+	
+	if (rawSmp) {
+		const decQt = mod.ccall('flushDec', 'number', ['number', 'number', 'number', 'number'],
+			[id, client, rawSmp, decSz]);
+		let result = [];
+		
+		if (decQt >= 0) {
+			const chSmpV = new DataView(mod.HEAPU8.buffer, rawSmp, decSz);
+			
+			for (let idx = 0; idx < decQt / ChSample.SIZE_IN_BYTES; ++idx) {
+				const chSmp = new ChSample();
+				chSmp.setFromRaw(chSmpV, ChSample.SIZE_IN_BYTES * idx);
+				result.push(chSmp);
+			}
+		}
+		else {
+			console.error("Error flushing decimated channel samples.");
+			result = undefined;
+		}
+		
+		mod._free(rawSmp);
+		
+		return result;
+	}
+	else {
+		console.error("Error allocating memory for channel sample decimation flush.");
+	}
+}
+
+/** Emits all samples still buffered in merger, e.g. at end of capture.
+ * @return {MergeSample[]|undefined} Array containing MergeSample objects or none if there's error. */
+export function flushMrg() {
+	const status = getMrgStatus();
+	
+	if (status && !status.buffered) {								//nothing to flush
+		return [];
+	}
+	
+	if (status) {
+		const mrgSz = MergeSample.SIZE_IN_BYTES * status.buffered;
+		const rawMrg = mod._malloc(mrgSz);
+		
+		if (rawMrg) {
+			const mrgQt = mod.ccall('flushMrg', 'number', ['number', 'number'], [rawMrg, mrgSz]);
+			let result;
+			
+			if (mrgQt >= 0) {
+				result = getMergeSamples(new DataView(mod.HEAPU8.buffer, rawMrg, mrgSz), 0, mrgQt);
+			}
+			else {
+				console.error("Error flushing merged samples.");
+			}
+			
+			mod._free(rawMrg);
+			
+			return result;
+		}
+		else {
+			console.error("Error allocating memory for merged samples.");
+		}
+	}
+}
+
 /** Gets generator config for specific channel.
  * @param {number} id Channel ID. Valid value is 0-14.
  * @return {ChConfig|undefined} Channel config object or none if there's error. */
@@ -230,6 +888,85 @@ export function getData(id, raw, rawSz) {
 	return mod.ccall('getData', 'number', ['number', 'number', 'number'], [id, raw, rawSz]);
 }
 
+/** Gets cross-channel merger status.
+ * @return {MergeStatus|undefined} Merger status object or none if there's error. */
+export function getMrgStatus() {
+	const statusR = mod._malloc(MergeStatus.SIZE_IN_BYTES);
+	
+	if (statusR) {
+		let status = new MergeStatus();
+		
+		if (mod.ccall('getMrgStatus', 'boolean', ['number', 'number'], [statusR, MergeStatus.SIZE_IN_BYTES])) {
+			status.setFromRaw(new DataView(mod.HEAPU8.buffer, statusR, MergeStatus.SIZE_IN_BYTES));
+		}
+		else {
+			console.error("Error getting merger status.");
+			status = undefined;
+		}
+		
+		mod._free(statusR);
+		
+		return status;
+	}
+	else {
+		console.error("Error allocating memory for merger status.");
+	}
+}
+
+/** Gets interpreter tag tracking status for specific channel.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @return {InterpStatus|undefined} Interpreter status object or none if there's error. */
+export function getProcStatus(id) {
+	const statusR = mod._malloc(InterpStatus.SIZE_IN_BYTES);
+	
+	if (statusR) {
+		let status = new InterpStatus();
+		
+		if (mod.ccall('getProcStatus', 'boolean', ['number', 'number', 'number'],
+		[id, statusR, InterpStatus.SIZE_IN_BYTES])) {
+			status.setFromRaw(new DataView(mod.HEAPU8.buffer, statusR, InterpStatus.SIZE_IN_BYTES));
+		}
+		else {
+			console.error("Error getting channel interpreter status.");
+			status = undefined;
+		}
+		
+		mod._free(statusR);
+		
+		return status;
+	}
+	else {
+		console.error("Error allocating memory for channel interpreter status.");
+	}
+}
+
+/** Gets trigger status for specific channel.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @return {TrigStatus|undefined} Trigger status object or none if there's error. */
+export function getTrigStatus(id) {
+	const statusR = mod._malloc(TrigStatus.SIZE_IN_BYTES);
+	
+	if (statusR) {
+		let status = new TrigStatus();
+		
+		if (mod.ccall('getTrigStatus', 'boolean', ['number', 'number', 'number'],
+		[id, statusR, TrigStatus.SIZE_IN_BYTES])) {
+			status.setFromRaw(new DataView(mod.HEAPU8.buffer, statusR, TrigStatus.SIZE_IN_BYTES));
+		}
+		else {
+			console.error("Error getting channel trigger status.");
+			status = undefined;
+		}
+		
+		mod._free(statusR);
+		
+		return status;
+	}
+	else {
+		console.error("Error allocating memory for channel trigger status.");
+	}
+}
+
 /** Initialises overall interface system.
  * @return {boolean} False if there's error. */
 export function initSys() {
@@ -260,7 +997,8 @@ export function interpretRawData(raw, dataQt) {
  * @param {number} dataQt Size of valid data in channel data memory, in bytes.
  * @param {number} rawSmp Pointer to allocated memory for channel sample.
  * @param {number} rawSmpSz Size of allocated memory for channel sample, in bytes.
- *							Should be >= (ChSample.SIZE_IN_BYTES * ChData.SAMPLE_PER_READING).
+ *							Should be >= (ChSample.SIZE_IN_BYTES * ChData.SAMPLE_PER_READING), plus
+ *							another ChSample.SIZE_IN_BYTES if gap marker is enabled.
  * @return {Array} Array containing ChSample objects. */
 export function procData(id, rawData, dataQt, rawSmp, rawSmpSz) {
 	const chSmpV = new DataView(mod.HEAPU8.buffer, rawSmp, rawSmpSz);
@@ -280,7 +1018,7 @@ export function procData(id, rawData, dataQt, rawSmp, rawSmpSz) {
 				result.push(chSmp);
 			}
 		}
-		else {
+		else if (dataSmpQt < 0) {								//0 for discarded duplicate/late reading
 			console.warn("Error processing channel data into samples.");
 		}
 		
@@ -291,6 +1029,101 @@ export function procData(id, rawData, dataQt, rawSmp, rawSmpSz) {
 	return result;
 }
 
+/** Merges channel samples with other channels into single time-ordered stream on ns time base. Samples are
+ * only released once every channel has progressed past them, so result may be empty.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {ChSample[]} chSmps Channel samples, in timestamp order.
+ * @return {MergeSample[]|undefined} Array containing MergeSample objects or none if there's error. */
+export function mrgData(id, chSmps) {
+	const status = getMrgStatus();
+	
+	if (status) {
+		//all buffered samples may be released at once
+		const smpSz = ChSample.SIZE_IN_BYTES * chSmps.length;
+		const mrgSz = MergeSample.SIZE_IN_BYTES * (chSmps.length + status.buffered);
+		const rawSmp = mod._malloc(smpSz + mrgSz);
+		
+		if (rawSmp) {
+			const chSmpV = new DataView(mod.HEAPU8.buffer, rawSmp, smpSz + mrgSz);
+			let result;
+			
+			chSmps.forEach((elem, idx) => elem.getToRaw(chSmpV, ChSample.SIZE_IN_BYTES * idx));
+			
+			const mrgQt = mod.ccall('mrgData', 'number', ['number', 'number', 'number', 'number', 'number'],
+				[id, rawSmp, smpSz, rawSmp + smpSz, mrgSz]);
+			
+			if (mrgQt >= 0) {
+				result = getMergeSamples(chSmpV, smpSz, mrgQt);
+			}
+			else {
+				console.error("Error merging channel samples.");
+			}
+			
+			mod._free(rawSmp);
+			
+			return result;
+		}
+		else {
+			console.error("Error allocating memory for channel sample merging.");
+		}
+	}
+}
+
+/** Decodes channel samples into bus protocol frames, as per decoder config set for channel.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {ChSample[]} chSmps Channel samples, in timestamp order.
+ * @return {Array|undefined} Array containing ProtoFrame objects or none if there's error. */
+export function protoData(id, chSmps) {
+	//single sample produces 2 frames at most
+	const smpSz = ChSample.SIZE_IN_BYTES * chSmps.length;
+	const frameSz = ProtoFrame.SIZE_IN_BYTES * 2 * chSmps.length;
+	const rawSmp = mod._malloc(smpSz + frameSz);
+	
+	if (rawSmp) {
+		const chSmpV = new DataView(mod.HEAPU8.buffer, rawSmp, smpSz + frameSz);
+		let result = [];
+		
+		chSmps.forEach((elem, idx) => elem.getToRaw(chSmpV, ChSample.SIZE_IN_BYTES * idx));
+		
+		const frameQt = mod.ccall('protoData', 'number', ['number', 'number', 'number', 'number', 'number'],
+			[id, rawSmp, smpSz, rawSmp + smpSz, frameSz]);
+		
+		if (frameQt >= 0) {
+			for (let idx = 0; idx < frameQt / ProtoFrame.SIZE_IN_BYTES; ++idx) {
+				const frame = new ProtoFrame();
+				frame.setFromRaw(chSmpV, smpSz + ProtoFrame.SIZE_IN_BYTES * idx);
+				result.push(frame);
+			}
+		}
+		else {
+			console.error("Error decoding channel samples.");
+			result = undefined;
+		}
+		
+		mod._free(rawSmp);
+		
+		return result;
+	}
+	else {
+		console.error("Error allocating memory for channel sample decoding.");
+	}
+}
+
+/** Removes channel sample decimator for specific client, e.g. when client disconnects.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {number} client Client ID.
+ * @return {boolean} Always true. */
+export function removeDec(id, client) {
+	return mod.ccall('removeDec', 'boolean', ['number', 'number'], [id, client]);
+}
+
+/** Removes channel from cross-channel merger. Its buffered samples are dropped.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @return {boolean} True if channel is removed successfully. */
+export function removeMrgCh(id) {
+	return mod.ccall('removeMrgCh', 'boolean', ['number'], [id]);
+}
+
 /** Resets/Initialises channel data processor.
  * @param {number} id Channel ID. Valid value is 0-14.
  * @return {boolean} True if processor is reset successfully. */
@@ -298,6 +1131,19 @@ export function resetProc(id) {
 	return mod.ccall('resetProc', 'boolean', ['number'], [id]);
 }
 
+/** Drops all samples buffered in cross-channel merger and resets its statistics. Channels are kept.
+ * @return {boolean} Always true. */
+export function resetMrg() {
+	return mod.ccall('resetMrg', 'boolean');
+}
+
+/** Re-arms trigger for specific channel, e.g. after single-shot capture is done.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @return {boolean} True if trigger is re-armed successfully. */
+export function resetTrig(id) {
+	return mod.ccall('resetTrig', 'boolean', ['number'], [id]);
+}
+
 /** Sets generator config for specific channel.
  * @param {ChConfig} cfg Config object, possibly from REST API request.
  * @return {boolean} True if config is set successfully. */
@@ -320,3 +1166,136 @@ export function setConfig(cfg) {
 	
 	return result;
 }
+
+/** Sets/Resets channel sample decimator config for specific client. Decimator is added if not exists yet.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {number} client Client ID.
+ * @param {DecConfig} cfg Config object.
+ * @return {boolean} True if config is set successfully. */
+export function setDecConfig(id, client, cfg) {
+	const decConfigR = mod._malloc(DecConfig.SIZE_IN_BYTES);
+	let result;
+	
+	if (decConfigR) {
+		const decConfigV = new DataView(mod.HEAPU8.buffer, decConfigR, DecConfig.SIZE_IN_BYTES);
+		
+		cfg.getToRaw(decConfigV);
+		result = mod.ccall('setDecConfig', 'boolean', ['number', 'number', 'number', 'number'],
+			[id, client, decConfigR, DecConfig.SIZE_IN_BYTES]);
+		
+		mod._free(decConfigR);
+	}
+	else {
+		console.error("Error allocating memory for channel decimator config.");
+		result = false;
+	}
+	
+	return result;
+}
+
+/** Enables or disables gap marker sample for specific channel. Marker sample has GAP_TS timestamp and is
+ * emitted before first sample following lost reading(s).
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {boolean} enable True to enable.
+ * @return {boolean} True if gap marker is set successfully. */
+export function setProcGapMark(id, enable) {
+	return mod.ccall('setProcGapMark', 'boolean', ['number', 'boolean'], [id, enable]);
+}
+
+/** Adds channel to cross-channel merger or updates its sampling rate.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {number} rate Channel sampling rate, in Hz.
+ * @return {boolean} True if channel is set successfully. */
+export function setMrgCh(id, rate) {
+	return mod.ccall('setMrgCh', 'boolean', ['number', 'number'], [id, rate]);
+}
+
+/** Sets/Resets bus protocol decoder config for specific channel. Decoder is added if not exists yet.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {ProtoConfig} cfg Config object.
+ * @return {boolean} True if config is set successfully. */
+export function setProtoConfig(id, cfg) {
+	const protoConfigR = mod._malloc(ProtoConfig.SIZE_IN_BYTES);
+	let result;
+	
+	if (protoConfigR) {
+		const protoConfigV = new DataView(mod.HEAPU8.buffer, protoConfigR, ProtoConfig.SIZE_IN_BYTES);
+		
+		cfg.getToRaw(protoConfigV);
+		result = mod.ccall('setProtoConfig', 'boolean', ['number', 'number', 'number'],
+			[id, protoConfigR, ProtoConfig.SIZE_IN_BYTES]);
+		
+		mod._free(protoConfigR);
+	}
+	else {
+		console.error("Error allocating memory for channel decoder config.");
+		result = false;
+	}
+	
+	return result;
+}
+
+/** Sets/Re-arms trigger config for specific channel. Trigger is added if not exists yet.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {TrigConfig} cfg Config object.
+ * @return {boolean} True if config is set successfully. */
+export function setTrigConfig(id, cfg) {
+	const trigConfigR = mod._malloc(TrigConfig.SIZE_IN_BYTES);
+	let result;
+	
+	if (trigConfigR) {
+		const trigConfigV = new DataView(mod.HEAPU8.buffer, trigConfigR, TrigConfig.SIZE_IN_BYTES);
+		
+		cfg.getToRaw(trigConfigV);
+		result = mod.ccall('setTrigConfig', 'boolean', ['number', 'number', 'number'],
+			[id, trigConfigR, TrigConfig.SIZE_IN_BYTES]);
+		
+		mod._free(trigConfigR);
+	}
+	else {
+		console.error("Error allocating memory for channel trigger config.");
+		result = false;
+	}
+	
+	return result;
+}
+
+/** Passes channel samples through channel trigger, keeping only pre- and post-trigger capture window.
+ * @param {number} id Channel ID. Valid value is 0-14.
+ * @param {ChSample[]} chSmps Channel samples, in timestamp order.
+ * @param {number} pre Pre-trigger sample count as per trigger config, for output sizing.
+ * @return {Array|undefined} Array containing captured ChSample objects or none if there's error. */
+export function trigData(id, chSmps, pre) {
+	const smpSz = ChSample.SIZE_IN_BYTES * chSmps.length;
+	const capSz = ChSample.SIZE_IN_BYTES * (chSmps.length + pre);
+	const rawSmp = mod._malloc(smpSz + capSz);
+	
+	if (rawSmp) {
+		const chSmpV = new DataView(mod.HEAPU8.buffer, rawSmp, smpSz + capSz);
+		let result = [];
+		
+		chSmps.forEach((elem, idx) => elem.getToRaw(chSmpV, ChSample.SIZE_IN_BYTES * idx));
+		
+		const capQt = mod.ccall('trigData', 'number', ['number', 'number', 'number', 'number', 'number'],
+			[id, rawSmp, smpSz, rawSmp + smpSz, capSz]);
+		
+		if (capQt >= 0) {
+			for (let idx = 0; idx < capQt / ChSample.SIZE_IN_BYTES; ++idx) {
+				const chSmp = new ChSample();
+				chSmp.setFromRaw(chSmpV, smpSz + ChSample.SIZE_IN_BYTES * idx);
+				result.push(chSmp);
+			}
+		}
+		else {
+			console.error("Error passing channel samples through trigger.");
+			result = undefined;
+		}
+		
+		mod._free(rawSmp);
+		
+		return result;
+	}
+	else {
+		console.error("Error allocating memory for channel sample trigger.");
+	}
+}
@@ -14,10 +14,11 @@
 #include <vector>
 
 //! Helper function to validate 'cfg' data size.
-//! @param[in] cfgSz Channel configuration data size, in bytes.
-//! @return True if \b cfgSz matches \ref ch_config size.
-bool validateCfgSize(size_t cfgSz) {
-	if (cfgSz != sizeof(ch_config)) {
+//! @tparam T Configuration data type, \ref ch_config by default.
+//! @param[in] cfgSz Configuration data size, in bytes.
+//! @return True if \b cfgSz matches \b T size.
+template<class T = ch_config> bool validateCfgSize(size_t cfgSz) {
+	if (cfgSz != sizeof(T)) {
 		SPDLOG_ERROR("Data size '{}' byte(s) mismatch.", cfgSz);
 		return false;
 	}
@@ -52,6 +53,84 @@ extern "C" {
 		spdlog::shutdown();
 	}
 	
+	//! Glue function for \ref decimateData().
+	//! @param[in] idx Target channel index.
+	//! @param[in] client Target client ID.
+	//! @param[in] samples Channel sample data.
+	//! @param[in] samplesSz Channel sample data size, in bytes.
+	//! @param[out] data Decimated channel sample data.
+	//! @param[in] dataSz Decimated channel sample data size, in bytes.
+	//! @return Decimated sample count, in bytes. -1 if error has occurred.
+	EMSCRIPTEN_KEEPALIVE int32_t decData(uint8_t idx, uint32_t client, const ch_sample *samples,
+	size_t samplesSz, uint8_t *data, size_t dataSz) {
+		std::deque<uint8_t> dataTmp;
+		
+		if (samplesSz % sizeof(ch_sample)) [[unlikely]] {
+			SPDLOG_ERROR("Sample data size '{}' byte(s) mismatch.", samplesSz);
+		}
+		else if (decimateData(idx, client, samples, samplesSz / sizeof(ch_sample), dataTmp,
+		dataSz)) [[likely]] {
+			std::copy(dataTmp.cbegin(), dataTmp.cend(), data);
+			return dataTmp.size();
+		}
+		
+		return -1;
+	}
+	
+	//! Glue function for \ref decodeData().
+	//! @param[in] idx Target channel index.
+	//! @param[in] samples Channel sample data.
+	//! @param[in] samplesSz Channel sample data size, in bytes.
+	//! @param[out] data Decoded frame data.
+	//! @param[in] dataSz Decoded frame data size, in bytes.
+	//! @return Decoded frame count, in bytes. -1 if error has occurred.
+	EMSCRIPTEN_KEEPALIVE int32_t protoData(uint8_t idx, const ch_sample *samples, size_t samplesSz,
+	uint8_t *data, size_t dataSz) {
+		std::deque<uint8_t> dataTmp;
+		
+		if (samplesSz % sizeof(ch_sample)) [[unlikely]] {
+			SPDLOG_ERROR("Sample data size '{}' byte(s) mismatch.", samplesSz);
+		}
+		else if (decodeData(idx, samples, samplesSz / sizeof(ch_sample), dataTmp, dataSz)) [[likely]] {
+			std::copy(dataTmp.cbegin(), dataTmp.cend(), data);
+			return dataTmp.size();
+		}
+		
+		return -1;
+	}
+	
+	//! Glue function for \ref flushDecimator().
+	//! @param[in] idx Target channel index.
+	//! @param[in] client Target client ID.
+	//! @param[out] data Decimated channel sample data.
+	//! @param[in] dataSz Decimated channel sample data size, in bytes.
+	//! @return Decimated sample count, in bytes. -1 if error has occurred.
+	EMSCRIPTEN_KEEPALIVE int32_t flushDec(uint8_t idx, uint32_t client, uint8_t *data, size_t dataSz) {
+		std::deque<uint8_t> dataTmp;
+		
+		if (flushDecimator(idx, client, dataTmp, dataSz)) [[likely]] {
+			std::copy(dataTmp.cbegin(), dataTmp.cend(), data);
+			return dataTmp.size();
+		}
+		
+		return -1;
+	}
+	
+	//! Glue function for \ref flushMerge().
+	//! @param[out] data Merged sample data.
+	//! @param[in] dataSz Merged sample data size, in bytes.
+	//! @return Merged sample count, in bytes. -1 if error has occurred.
+	EMSCRIPTEN_KEEPALIVE int32_t flushMrg(uint8_t *data, size_t dataSz) {
+		std::deque<uint8_t> dataTmp;
+		
+		if (flushMerge(dataTmp, dataSz)) [[likely]] {
+			std::copy(dataTmp.cbegin(), dataTmp.cend(), data);
+			return dataTmp.size();
+		}
+		
+		return -1;
+	}
+	
 	//! Glue function for \ref getGeneratorConfig().
 	//! @param[in] idx Target channel index.
 	//! @param[out] cfg Channel configuration data.
@@ -77,6 +156,32 @@ extern "C" {
 		return -1;
 	}
 	
+	//! Glue function for \ref getMergeStatus().
+	//! @param[out] status Merger status data.
+	//! @param[in] statusSz Merger status data size, in bytes.
+	//! @return False if \b statusSz doesn't match \ref merge_status size. Else, as per target function.
+	EMSCRIPTEN_KEEPALIVE bool getMrgStatus(merge_status *status, size_t statusSz) {
+		return validateCfgSize<merge_status>(statusSz) ? getMergeStatus(status) : false;
+	}
+	
+	//! Glue function for \ref getInterpreterStatus().
+	//! @param[in] idx Target channel index.
+	//! @param[out] status Interpreter status data.
+	//! @param[in] statusSz Interpreter status data size, in bytes.
+	//! @return False if \b statusSz doesn't match \ref interp_status size. Else, as per target function.
+	EMSCRIPTEN_KEEPALIVE bool getProcStatus(uint8_t idx, interp_status *status, size_t statusSz) {
+		return validateCfgSize<interp_status>(statusSz) ? getInterpreterStatus(idx, status) : false;
+	}
+	
+	//! Glue function for \ref getTriggerStatus().
+	//! @param[in] idx Target channel index.
+	//! @param[out] status Trigger status data.
+	//! @param[in] statusSz Trigger status data size, in bytes.
+	//! @return False if \b statusSz doesn't match \ref trig_status size. Else, as per target function.
+	EMSCRIPTEN_KEEPALIVE bool getTrigStatus(uint8_t idx, trig_status *status, size_t statusSz) {
+		return validateCfgSize<trig_status>(statusSz) ? getTriggerStatus(idx, status) : false;
+	}
+	
 	//! Glue function for \ref interpretData().
 	//! @param[in] idx Target channel index.
 	//! @param[in] reading Channel reading object.
@@ -94,6 +199,43 @@ extern "C" {
 		return -1;
 	}
 	
+	//! Glue function for \ref mergeData().
+	//! @param[in] idx Target channel index.
+	//! @param[in] samples Channel sample data.
+	//! @param[in] samplesSz Channel sample data size, in bytes.
+	//! @param[out] data Merged sample data.
+	//! @param[in] dataSz Merged sample data size, in bytes.
+	//! @return Merged sample count, in bytes. -1 if error has occurred.
+	EMSCRIPTEN_KEEPALIVE int32_t mrgData(uint8_t idx, const ch_sample *samples, size_t samplesSz,
+	uint8_t *data, size_t dataSz) {
+		std::deque<uint8_t> dataTmp;
+		
+		if (samplesSz % sizeof(ch_sample)) [[unlikely]] {
+			SPDLOG_ERROR("Sample data size '{}' byte(s) mismatch.", samplesSz);
+		}
+		else if (mergeData(idx, samples, samplesSz / sizeof(ch_sample), dataTmp, dataSz)) [[likely]] {
+			std::copy(dataTmp.cbegin(), dataTmp.cend(), data);
+			return dataTmp.size();
+		}
+		
+		return -1;
+	}
+	
+	//! Glue function for \ref removeDecimator().
+	//! @param[in] idx Target channel index.
+	//! @param[in] client Target client ID.
+	//! @return \ref removeDecimator() return value.
+	EMSCRIPTEN_KEEPALIVE bool removeDec(uint8_t idx, uint32_t client) {
+		return removeDecimator(idx, client);
+	}
+	
+	//! Glue function for \ref removeMergeChannel().
+	//! @param[in] idx Target channel index.
+	//! @return \ref removeMergeChannel() return value.
+	EMSCRIPTEN_KEEPALIVE bool removeMrgCh(uint8_t idx) {
+		return removeMergeChannel(idx);
+	}
+	
 	//! Glue function for \ref resetInterpreter().
 	//! @param[in] idx Target channel index.
 	//! @return \ref resetInterpreter() return value.
@@ -101,6 +243,19 @@ extern "C" {
 		return resetInterpreter(idx);
 	}
 	
+	//! Glue function for \ref resetMerge().
+	//! @return \ref resetMerge() return value.
+	EMSCRIPTEN_KEEPALIVE bool resetMrg() {
+		return resetMerge();
+	}
+	
+	//! Glue function for \ref resetTrigger().
+	//! @param[in] idx Target channel index.
+	//! @return \ref resetTrigger() return value.
+	EMSCRIPTEN_KEEPALIVE bool resetTrig(uint8_t idx) {
+		return resetTrigger(idx);
+	}
+	
 	//! Glue function for \ref setGeneratorConfig().
 	//! @param[out] cfg Channel configuration data.
 	//! @param[in] cfgSz Channel configuration data size, in bytes.
@@ -108,4 +263,70 @@ extern "C" {
 	EMSCRIPTEN_KEEPALIVE bool setConfig(const ch_config *cfg, size_t cfgSz) {
 		return validateCfgSize(cfgSz) ? setGeneratorConfig(cfg) : false;
 	}
+	
+	//! Glue function for \ref setDecimatorConfig().
+	//! @param[in] idx Target channel index.
+	//! @param[in] client Target client ID.
+	//! @param[in] cfg Decimator configuration data.
+	//! @param[in] cfgSz Decimator configuration data size, in bytes.
+	//! @return False if \b cfgSz doesn't match \ref dec_config size. Else, as per target function.
+	EMSCRIPTEN_KEEPALIVE bool setDecConfig(uint8_t idx, uint32_t client, const dec_config *cfg, size_t cfgSz) {
+		return validateCfgSize<dec_config>(cfgSz) ? setDecimatorConfig(idx, client, cfg) : false;
+	}
+	
+	//! Glue function for \ref setInterpreterGapMarker().
+	//! @param[in] idx Target channel index.
+	//! @param[in] enable True to enable.
+	//! @return \ref setInterpreterGapMarker() return value.
+	EMSCRIPTEN_KEEPALIVE bool setProcGapMark(uint8_t idx, bool enable) {
+		return setInterpreterGapMarker(idx, enable);
+	}
+	
+	//! Glue function for \ref setMergeChannel().
+	//! @param[in] idx Target channel index.
+	//! @param[in] rate Channel sampling rate, in Hz.
+	//! @return \ref setMergeChannel() return value.
+	EMSCRIPTEN_KEEPALIVE bool setMrgCh(uint8_t idx, uint32_t rate) {
+		return setMergeChannel(idx, rate);
+	}
+	
+	//! Glue function for \ref setDecoderConfig().
+	//! @param[in] idx Target channel index.
+	//! @param[in] cfg Decoder configuration data.
+	//! @param[in] cfgSz Decoder configuration data size, in bytes.
+	//! @return False if \b cfgSz doesn't match \ref proto_config size. Else, as per target function.
+	EMSCRIPTEN_KEEPALIVE bool setProtoConfig(uint8_t idx, const proto_config *cfg, size_t cfgSz) {
+		return validateCfgSize<proto_config>(cfgSz) ? setDecoderConfig(idx, cfg) : false;
+	}
+	
+	//! Glue function for \ref setTriggerConfig().
+	//! @param[in] idx Target channel index.
+	//! @param[in] cfg Trigger configuration data.
+	//! @param[in] cfgSz Trigger configuration data size, in bytes.
+	//! @return False if \b cfgSz doesn't match \ref trig_config size. Else, as per target function.
+	EMSCRIPTEN_KEEPALIVE bool setTrigConfig(uint8_t idx, const trig_config *cfg, size_t cfgSz) {
+		return validateCfgSize<trig_config>(cfgSz) ? setTriggerConfig(idx, cfg) : false;
+	}
+	
+	//! Glue function for \ref triggerData().
+	//! @param[in] idx Target channel index.
+	//! @param[in] samples Channel sample data.
+	//! @param[in] samplesSz Channel sample data size, in bytes.
+	//! @param[out] data Captured channel sample data.
+	//! @param[in] dataSz Captured channel sample data size, in bytes.
+	//! @return Captured sample count, in bytes. -1 if error has occurred.
+	EMSCRIPTEN_KEEPALIVE int32_t trigData(uint8_t idx, const ch_sample *samples, size_t samplesSz,
+	uint8_t *data, size_t dataSz) {
+		std::deque<uint8_t> dataTmp;
+		
+		if (samplesSz % sizeof(ch_sample)) [[unlikely]] {
+			SPDLOG_ERROR("Sample data size '{}' byte(s) mismatch.", samplesSz);
+		}
+		else if (triggerData(idx, samples, samplesSz / sizeof(ch_sample), dataTmp, dataSz)) [[likely]] {
+			std::copy(dataTmp.cbegin(), dataTmp.cend(), data);
+			return dataTmp.size();
+		}
+		
+		return -1;
+	}
 }